@@ -0,0 +1,235 @@
+/*
+ * epoll-producers:
+ *
+ * Many-producer epoll benchmark.  A number of producer threads write to
+ * eventfds, each producer to its own set of them, and all eventfds are
+ * watched by a single epoll instance.  A number of consumer threads wait
+ * in epoll_wait() on that instance and read the eventfds that are
+ * reported ready, like a looper thread pool watching binder, socket and
+ * eventfd descriptors.
+ *
+ * At the end the program reports the eventfd writes and delivered events
+ * per second, the average number of events returned by an epoll_wait()
+ * call, how many reported events had already been consumed by another
+ * thread, and the average and maximum latency from the first write to an
+ * idle eventfd to a consumer reading it.  Run it with fs.epoll.batch_wakeups
+ * set to 0 and to 1 to compare per-event and batched wakeups.
+ *
+ * Usage: epoll-producers [-p producers] [-f fds per producer]
+ *			  [-c consumers] [-t seconds]
+ *
+ * The defaults are 8 producers with 16 eventfds each, 4 consumers and
+ * 10 seconds.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define MAX_EVENTS	64
+
+struct source {
+	int fd;
+	/* time of the first write since the last read, 0 when idle */
+	uint64_t sent;
+};
+
+struct producer {
+	pthread_t thread;
+	struct source *src;
+	unsigned long writes;
+};
+
+struct consumer {
+	pthread_t thread;
+	unsigned long waits;
+	unsigned long events;
+	unsigned long stale;
+	uint64_t latency;
+	uint64_t max_latency;
+};
+
+static int epfd, nr_fds = 16;
+static volatile int stop;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *producer(void *data)
+{
+	struct producer *p = data;
+	unsigned int seed = (uintptr_t)p;
+	uint64_t one = 1;
+	struct source *s;
+
+	while (!stop) {
+		s = &p->src[rand_r(&seed) % nr_fds];
+		__sync_bool_compare_and_swap(&s->sent, 0, now_ns());
+		if (write(s->fd, &one, sizeof(one)) != sizeof(one)) {
+			perror("write");
+			break;
+		}
+		p->writes++;
+	}
+	return NULL;
+}
+
+static void *consumer(void *data)
+{
+	struct consumer *c = data;
+	struct epoll_event ev[MAX_EVENTS];
+	struct source *s;
+	uint64_t val, sent, lat;
+	int i, n;
+
+	while (!stop) {
+		n = epoll_wait(epfd, ev, MAX_EVENTS, 100);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("epoll_wait");
+			break;
+		}
+		c->waits++;
+		for (i = 0; i < n; i++) {
+			s = ev[i].data.ptr;
+			if (read(s->fd, &val, sizeof(val)) != sizeof(val)) {
+				/* another consumer got there first */
+				c->stale++;
+				continue;
+			}
+			sent = __sync_lock_test_and_set(&s->sent, 0);
+			c->events++;
+			if (!sent)
+				continue;
+			lat = now_ns() - sent;
+			c->latency += lat;
+			if (lat > c->max_latency)
+				c->max_latency = lat;
+		}
+	}
+	return NULL;
+}
+
+static int read_sysctl(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	int val = -1;
+
+	if (f) {
+		if (fscanf(f, "%d", &val) != 1)
+			val = -1;
+		fclose(f);
+	}
+	return val;
+}
+
+int main(int argc, char **argv)
+{
+	int nr_producers = 8, nr_consumers = 4, seconds = 10;
+	unsigned long writes = 0, waits = 0, events = 0, stale = 0;
+	uint64_t latency = 0, max_latency = 0, start;
+	struct producer *p;
+	struct consumer *c;
+	struct source *src;
+	struct epoll_event ev;
+	double elapsed;
+	int i, opt;
+
+	while ((opt = getopt(argc, argv, "p:f:c:t:")) != -1) {
+		switch (opt) {
+		case 'p':
+			nr_producers = atoi(optarg);
+			break;
+		case 'f':
+			nr_fds = atoi(optarg);
+			break;
+		case 'c':
+			nr_consumers = atoi(optarg);
+			break;
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-p producers] "
+				"[-f fds per producer] [-c consumers] "
+				"[-t seconds]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (nr_producers < 1 || nr_fds < 1 || nr_consumers < 1 ||
+	    seconds < 1) {
+		fprintf(stderr, "Invalid arguments\n");
+		return 1;
+	}
+
+	epfd = epoll_create1(0);
+	p = calloc(nr_producers, sizeof(*p));
+	c = calloc(nr_consumers, sizeof(*c));
+	src = calloc(nr_producers * nr_fds, sizeof(*src));
+	if (epfd < 0 || !p || !c || !src) {
+		perror("setup");
+		return 1;
+	}
+	for (i = 0; i < nr_producers * nr_fds; i++) {
+		src[i].fd = eventfd(0, EFD_NONBLOCK);
+		ev.events = EPOLLIN;
+		ev.data.ptr = &src[i];
+		if (src[i].fd < 0 ||
+		    epoll_ctl(epfd, EPOLL_CTL_ADD, src[i].fd, &ev) < 0) {
+			perror("eventfd");
+			return 1;
+		}
+	}
+
+	start = now_ns();
+	for (i = 0; i < nr_consumers; i++)
+		pthread_create(&c[i].thread, NULL, consumer, &c[i]);
+	for (i = 0; i < nr_producers; i++) {
+		p[i].src = &src[i * nr_fds];
+		pthread_create(&p[i].thread, NULL, producer, &p[i]);
+	}
+	sleep(seconds);
+	stop = 1;
+	for (i = 0; i < nr_producers; i++) {
+		pthread_join(p[i].thread, NULL);
+		writes += p[i].writes;
+	}
+	for (i = 0; i < nr_consumers; i++) {
+		pthread_join(c[i].thread, NULL);
+		waits += c[i].waits;
+		events += c[i].events;
+		stale += c[i].stale;
+		latency += c[i].latency;
+		if (c[i].max_latency > max_latency)
+			max_latency = c[i].max_latency;
+	}
+	elapsed = (now_ns() - start) / 1e9;
+
+	printf("%d producers x %d eventfds, %d consumers", nr_producers,
+	       nr_fds, nr_consumers);
+	i = read_sysctl("/proc/sys/fs/epoll/batch_wakeups");
+	if (i >= 0)
+		printf(", batch_wakeups %d", i);
+	printf("\n");
+	printf("writes %.0f/s, events %.0f/s, epoll_wait %.0f/s, "
+	       "%.1f events/wait, %lu stale\n", writes / elapsed,
+	       events / elapsed, waits / elapsed,
+	       waits ? (double)(events + stale) / waits : 0.0, stale);
+	printf("latency avg %.1f us, max %.1f us\n",
+	       events ? latency / 1e3 / events : 0.0, max_latency / 1e3);
+	return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * f2fs-randread:
+ *
+ * Reads random 4KB blocks of a large file and reports the read rate and
+ * the extent cache hit ratio that f2fs exports in its debugfs status file
+ * ("Extent Hit Ratio", split into largest extent and rbtree hits).
+ *
+ * Every read that misses the extent cache has to look the block address
+ * up in the node pages of the file.  The file is written in a few large
+ * sequential runs separated by small overwrites, so it is made of several
+ * extents and not only of the single largest one.
+ *
+ * Usage: f2fs-randread <file on f2fs> [size in MB] [reads]
+ *
+ * The size defaults to 1024 MB and the number of reads to 100000.  Run it
+ * as root with debugfs mounted on /sys/kernel/debug, so that the page cache
+ * can be dropped before reading and the hit ratio can be reported.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define BLOCK	4096
+#define CHUNK	(1024 * 1024)
+#define STATUS	"/sys/kernel/debug/f2fs/status"
+
+struct extent_stat {
+	unsigned long long hit;
+	unsigned long long total;
+	unsigned long long largest;
+	unsigned long long rbtree;
+};
+
+/* Sums the extent counters over all mounted f2fs instances */
+static int read_extent_stat(struct extent_stat *st)
+{
+	char line[256];
+	unsigned long long a, b;
+	FILE *f = fopen(STATUS, "r");
+
+	memset(st, 0, sizeof(*st));
+	if (!f)
+		return -1;
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "Extent Hit Ratio: %llu / %llu", &a, &b) == 2) {
+			st->hit += a;
+			st->total += b;
+		} else if (sscanf(line, " - largest : %llu", &a) == 1)
+			st->largest += a;
+		else if (sscanf(line, " - rbtree : %llu", &a) == 1)
+			st->rbtree += a;
+	}
+	fclose(f);
+	return 0;
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void fill(int fd, unsigned long long size, char *buf)
+{
+	unsigned long long off;
+	struct stat st;
+
+	if (fstat(fd, &st) < 0) {
+		perror("fstat");
+		exit(1);
+	}
+	if ((unsigned long long)st.st_size >= size)
+		return;
+
+	printf("Filling %llu MB\n", size >> 20);
+	memset(buf, 0x5a, CHUNK);
+	for (off = 0; off < size; off += CHUNK) {
+		if (pwrite(fd, buf, CHUNK, off) != CHUNK) {
+			perror("pwrite");
+			exit(1);
+		}
+	}
+	fsync(fd);
+
+	/* Break the file up: overwritten blocks move out of place */
+	for (off = 0; off < size; off += 64 * CHUNK) {
+		if (pwrite(fd, buf, BLOCK, off + CHUNK / 2) != BLOCK) {
+			perror("pwrite");
+			exit(1);
+		}
+	}
+	fsync(fd);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long size = 1024ULL << 20, nr_blocks, off;
+	struct extent_stat before, after;
+	unsigned long i, reads = 100000;
+	double start, elapsed;
+	char *buf;
+	int fd;
+	FILE *f;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <file> [size in MB] [reads]\n",
+			argv[0]);
+		return 1;
+	}
+	if (argc > 2)
+		size = strtoull(argv[2], NULL, 10) << 20;
+	if (argc > 3)
+		reads = strtoul(argv[3], NULL, 10);
+	size &= ~(unsigned long long)(CHUNK - 1);
+	if (!size || !reads) {
+		fprintf(stderr, "Invalid size or number of reads\n");
+		return 1;
+	}
+
+	buf = malloc(CHUNK);
+	fd = open(argv[1], O_RDWR | O_CREAT, 0644);
+	if (!buf || fd < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+	fill(fd, size, buf);
+
+	sync();
+	f = fopen("/proc/sys/vm/drop_caches", "w");
+	if (f) {
+		fputs("3\n", f);
+		fclose(f);
+	}
+
+	nr_blocks = size / BLOCK;
+	srandom(getpid());
+	if (read_extent_stat(&before) < 0)
+		fprintf(stderr, "%s not available, no hit ratio\n", STATUS);
+
+	start = now();
+	for (i = 0; i < reads; i++) {
+		off = ((unsigned long long)random() << 16 ^ random()) %
+			nr_blocks * BLOCK;
+		if (pread(fd, buf, BLOCK, off) != BLOCK) {
+			perror("pread");
+			return 1;
+		}
+	}
+	elapsed = now() - start;
+	read_extent_stat(&after);
+
+	printf("%lu random reads of %llu MB in %.2fs: %.0f reads/s\n",
+	       reads, size >> 20, elapsed, reads / elapsed);
+	if (after.total > before.total)
+		printf("extent cache: %llu / %llu hits (%llu%%), "
+		       "largest %llu, rbtree %llu\n",
+		       after.hit - before.hit, after.total - before.total,
+		       (after.hit - before.hit) * 100 /
+		       (after.total - before.total),
+		       after.largest - before.largest,
+		       after.rbtree - before.rbtree);
+
+	close(fd);
+	free(buf);
+	return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * fsync-batch:
+ *
+ * Measures how well concurrent fsyncs on a journalling filesystem are
+ * batched into shared commits.  Each of a number of threads appends small
+ * records to its own file in the given directory and fsyncs it after each
+ * one, like many processes committing tiny SQLite transactions at once.
+ * For 1, 2, 4, ... up to the given number of threads the program reports
+ * fsyncs per second and the average and maximum fsync latency.
+ *
+ * On ext4 the jbd2 statistics of the journal the directory lives on
+ * (/proc/fs/jbd2/<dev>-8/info) are printed after the run, including the
+ * sync waiters per synchronous commit and the batching hold time.
+ *
+ * Usage: fsync-batch <directory> [max threads] [seconds per step]
+ *
+ * The defaults are 16 threads and 5 seconds per step.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#define RECORD	512
+
+struct worker {
+	pthread_t thread;
+	char path[PATH_MAX];
+	unsigned long nr;
+	double total;
+	double max;
+};
+
+static volatile int stop;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *worker(void *data)
+{
+	struct worker *w = data;
+	char buf[RECORD];
+	double start, lat;
+	int fd;
+
+	fd = open(w->path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+	if (fd < 0) {
+		perror(w->path);
+		return NULL;
+	}
+	memset(buf, 0x5a, sizeof(buf));
+	while (!stop) {
+		if (write(fd, buf, sizeof(buf)) != sizeof(buf)) {
+			perror("write");
+			break;
+		}
+		start = now();
+		if (fsync(fd) < 0) {
+			perror("fsync");
+			break;
+		}
+		lat = now() - start;
+		w->total += lat;
+		if (lat > w->max)
+			w->max = lat;
+		w->nr++;
+	}
+	close(fd);
+	unlink(w->path);
+	return NULL;
+}
+
+static void run(const char *dir, int threads, int seconds)
+{
+	struct worker *w = calloc(threads, sizeof(*w));
+	unsigned long nr = 0;
+	double total = 0, max = 0, elapsed;
+	int i;
+
+	if (!w)
+		exit(1);
+	stop = 0;
+	elapsed = now();
+	for (i = 0; i < threads; i++) {
+		snprintf(w[i].path, sizeof(w[i].path), "%s/fsync-batch.%d",
+			 dir, i);
+		pthread_create(&w[i].thread, NULL, worker, &w[i]);
+	}
+	sleep(seconds);
+	stop = 1;
+	for (i = 0; i < threads; i++) {
+		pthread_join(w[i].thread, NULL);
+		nr += w[i].nr;
+		total += w[i].total;
+		if (w[i].max > max)
+			max = w[i].max;
+	}
+	elapsed = now() - elapsed;
+
+	printf("%3d threads: %8.0f fsyncs/s, avg %7.3f ms, max %7.3f ms\n",
+	       threads, nr / elapsed, nr ? total * 1000 / nr : 0.0,
+	       max * 1000);
+	free(w);
+}
+
+/* Print the jbd2 statistics of the journal of the filesystem of dir */
+static void print_journal_info(const char *dir)
+{
+	char link[PATH_MAX], target[PATH_MAX], path[PATH_MAX], line[256];
+	struct dirent *de;
+	struct stat st;
+	char *name;
+	ssize_t len;
+	size_t n;
+	DIR *d;
+	FILE *f;
+
+	if (stat(dir, &st) < 0)
+		return;
+	snprintf(link, sizeof(link), "/sys/dev/block/%u:%u",
+		 major(st.st_dev), minor(st.st_dev));
+	len = readlink(link, target, sizeof(target) - 1);
+	if (len < 0)
+		return;
+	target[len] = '\0';
+	name = basename(target);
+	n = strlen(name);
+
+	d = opendir("/proc/fs/jbd2");
+	if (!d)
+		return;
+	while ((de = readdir(d))) {
+		if (strncmp(de->d_name, name, n) ||
+		    de->d_name[n] != '-')
+			continue;
+		snprintf(path, sizeof(path), "/proc/fs/jbd2/%s/info",
+			 de->d_name);
+		f = fopen(path, "r");
+		if (!f)
+			continue;
+		printf("\n%s:\n", path);
+		while (fgets(line, sizeof(line), f))
+			fputs(line, stdout);
+		fclose(f);
+	}
+	closedir(d);
+}
+
+int main(int argc, char **argv)
+{
+	int threads, max_threads = 16, seconds = 5;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <directory> [max threads] "
+			"[seconds per step]\n", argv[0]);
+		return 1;
+	}
+	if (argc > 2)
+		max_threads = atoi(argv[2]);
+	if (argc > 3)
+		seconds = atoi(argv[3]);
+	if (max_threads < 1 || seconds < 1) {
+		fprintf(stderr, "Invalid arguments\n");
+		return 1;
+	}
+
+	for (threads = 1; threads <= max_threads; threads *= 2)
+		run(argv[1], threads, seconds);
+	print_journal_info(argv[1]);
+	return 0;
+}
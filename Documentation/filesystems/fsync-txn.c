@@ -0,0 +1,196 @@
+/*
+ * fsync-txn:
+ *
+ * Runs small transactions the way SQLite does in its rollback journal
+ * mode and reports transactions per second and fsync latency.  Each
+ * transaction
+ *
+ *  - appends the original contents of the pages it changes to <db>-journal
+ *    and fsyncs the journal,
+ *  - overwrites those pages in place in the database file and fsyncs it,
+ *  - truncates the journal and fsyncs it again.
+ *
+ * This is the pattern the f2fs in-place-update policies and write bio
+ * merging are meant for.  When the f2fs debugfs status file is available,
+ * the in-place updated blocks and the number of write bios and pages per
+ * type issued during the run are printed as well.
+ *
+ * Usage: fsync-txn <database file> [transactions] [pages per transaction]
+ *
+ * The database is 16 MB; the defaults are 1000 transactions changing
+ * 4 pages each.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+
+#define PAGE		4096
+#define DB_PAGES	4096
+#define STATUS		"/sys/kernel/debug/f2fs/status"
+
+struct f2fs_stat {
+	unsigned long long ipu;
+	unsigned long long bios[3];
+	unsigned long long pages[3];
+};
+
+static int read_f2fs_stat(struct f2fs_stat *st)
+{
+	char line[256];
+	unsigned long long v[6], ipu;
+	FILE *f = fopen(STATUS, "r");
+	int i;
+
+	memset(st, 0, sizeof(*st));
+	if (!f)
+		return -1;
+	while (fgets(line, sizeof(line), f)) {
+		if (sscanf(line, "IPU: %llu blocks", &ipu) == 1)
+			st->ipu += ipu;
+		else if (sscanf(line, "Write bios: data %llu (%llu pages), "
+				"node %llu (%llu pages), meta %llu (%llu pages)",
+				&v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) == 6)
+			for (i = 0; i < 3; i++) {
+				st->bios[i] += v[2 * i];
+				st->pages[i] += v[2 * i + 1];
+			}
+	}
+	fclose(f);
+	return 0;
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static double max_lat, total_lat;
+static unsigned long nr_fsync;
+
+static void timed_fsync(int fd)
+{
+	double start = now(), lat;
+
+	if (fsync(fd) < 0) {
+		perror("fsync");
+		exit(1);
+	}
+	lat = now() - start;
+	total_lat += lat;
+	if (lat > max_lat)
+		max_lat = lat;
+	nr_fsync++;
+}
+
+static void xpwrite(int fd, const void *buf, size_t len, off_t off)
+{
+	if (pwrite(fd, buf, len, off) != (ssize_t)len) {
+		perror("pwrite");
+		exit(1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long i, txns = 1000, pages = 4, p;
+	struct f2fs_stat before, after;
+	char *journal, *buf;
+	double start, elapsed;
+	int db, jfd, has_stat;
+	static const char *type[] = { "data", "node", "meta" };
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <database file> [transactions] "
+			"[pages per transaction]\n", argv[0]);
+		return 1;
+	}
+	if (argc > 2)
+		txns = strtoul(argv[2], NULL, 10);
+	if (argc > 3)
+		pages = strtoul(argv[3], NULL, 10);
+	if (!txns || !pages || pages > DB_PAGES) {
+		fprintf(stderr, "Invalid arguments\n");
+		return 1;
+	}
+
+	if (asprintf(&journal, "%s-journal", argv[1]) < 0)
+		return 1;
+	buf = malloc(PAGE);
+	db = open(argv[1], O_RDWR | O_CREAT, 0644);
+	jfd = open(journal, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (!buf || db < 0 || jfd < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	memset(buf, 0, PAGE);
+	for (p = 0; p < DB_PAGES; p++)
+		xpwrite(db, buf, PAGE, p * PAGE);
+	fsync(db);
+	sync();
+
+	srandom(getpid());
+	has_stat = !read_f2fs_stat(&before);
+	start = now();
+	for (i = 0; i < txns; i++) {
+		unsigned long pgno[pages];
+
+		/* journal header and the pages about to change */
+		memset(buf, 0xd9, PAGE);
+		xpwrite(jfd, buf, PAGE, 0);
+		for (p = 0; p < pages; p++) {
+			pgno[p] = random() % DB_PAGES;
+			if (pread(db, buf, PAGE, pgno[p] * PAGE) != PAGE) {
+				perror("pread");
+				return 1;
+			}
+			xpwrite(jfd, buf, PAGE, (p + 1) * PAGE);
+		}
+		timed_fsync(jfd);
+
+		for (p = 0; p < pages; p++) {
+			memset(buf, (int)i, PAGE);
+			xpwrite(db, buf, PAGE, pgno[p] * PAGE);
+		}
+		timed_fsync(db);
+
+		if (ftruncate(jfd, 0) < 0) {
+			perror("ftruncate");
+			return 1;
+		}
+		timed_fsync(jfd);
+	}
+	elapsed = now() - start;
+
+	printf("%lu transactions of %lu pages in %.2fs: %.0f txn/s\n",
+	       txns, pages, elapsed, txns / elapsed);
+	printf("fsync: %lu calls, avg %.3f ms, max %.3f ms\n", nr_fsync,
+	       total_lat * 1000 / nr_fsync, max_lat * 1000);
+
+	if (has_stat && !read_f2fs_stat(&after)) {
+		printf("f2fs: in-place updates %llu blocks\n",
+		       after.ipu - before.ipu);
+		for (p = 0; p < 3; p++) {
+			unsigned long long nr = after.bios[p] - before.bios[p];
+
+			printf("f2fs: %s bios %llu, %.1f pages/bio\n", type[p],
+			       nr, nr ? (double)(after.pages[p] -
+						 before.pages[p]) / nr : 0.0);
+		}
+	}
+
+	close(jfd);
+	close(db);
+	unlink(journal);
+	free(journal);
+	free(buf);
+	return 0;
+}
@@ -0,0 +1,410 @@
+/*
+ * fuse-bench:
+ *
+ * Measures the request throughput of a FUSE mount.  The program is its
+ * own filesystem daemon: it mounts a FUSE filesystem holding a single
+ * file, "file", whose contents live in a backing file, and serves it with
+ * a number of reader threads, each reading /dev/fuse.  A number of client
+ * threads then do random reads or writes of that file for a fixed time,
+ * and the program reports operations and megabytes per second and the
+ * average latency of an operation.
+ *
+ * The file is opened with FOPEN_DIRECT_IO, so that every read and write
+ * goes through the daemon and not through the page cache.  Readers and
+ * clients can be bound to CPUs round-robin, which shows the effect of the
+ * per-CPU pending queues; the per-queue counters of the connection in
+ * /sys/fs/fuse/connections/<dev>/queues are printed at the end.
+ *
+ * With -p the backing file is registered with FUSE_DEV_IOC_PASSTHROUGH_OPEN
+ * and the file is opened in passthrough mode on it instead, so that reads
+ * and writes no longer reach the daemon.  Comparing the two runs shows the cost of the round trips.
+ *
+ * Usage: fuse-bench [options] <mountpoint> <backing file>
+ *
+ *   -r <n>	daemon reader threads (default 4)
+ *   -c <n>	client threads (default 4)
+ *   -b <KB>	size of each read or write (default 4)
+ *   -s <MB>	size of the file (default 64)
+ *   -t <sec>	duration (default 10)
+ *   -w		write instead of read
+ *   -a		bind readers and clients to CPUs round-robin
+ *   -p		open the file in passthrough mode
+ *
+ * Must be run as root.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/sysmacros.h>
+
+#include "../../include/linux/fuse.h"
+
+#define FILE_NODEID	2
+#define MAX_WRITE	(128 * 1024)
+#define BUF_SIZE	(MAX_WRITE + 4096)
+
+static int fuse_fd, backing_fd;
+static int nr_readers = 4, nr_clients = 4, block = 4096, do_write, affinity;
+static int passthrough;
+static unsigned long long file_size = 64ULL << 20;
+static int duration = 10;
+static char *file_path;
+static volatile int stop;
+
+struct client {
+	pthread_t thread;
+	int cpu;
+	unsigned long long ops;
+	double latency;
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bind_cpu(int cpu)
+{
+	cpu_set_t set;
+
+	if (!affinity)
+		return;
+	CPU_ZERO(&set);
+	CPU_SET(cpu % sysconf(_SC_NPROCESSORS_ONLN), &set);
+	sched_setaffinity(0, sizeof(set), &set);
+}
+
+static void reply(uint64_t unique, int error, const void *arg, size_t len)
+{
+	struct fuse_out_header oh;
+	struct iovec iov[2];
+
+	oh.unique = unique;
+	oh.error = error;
+	oh.len = sizeof(oh) + (error ? 0 : len);
+	iov[0].iov_base = &oh;
+	iov[0].iov_len = sizeof(oh);
+	iov[1].iov_base = (void *)arg;
+	iov[1].iov_len = len;
+	/* ENOENT: the request was interrupted and is gone */
+	if (writev(fuse_fd, iov, error || !len ? 1 : 2) < 0 &&
+	    errno != ENOENT)
+		perror("reply");
+}
+
+static void fill_attr(uint64_t nodeid, struct fuse_attr *attr)
+{
+	memset(attr, 0, sizeof(*attr));
+	attr->ino = nodeid;
+	attr->nlink = 1;
+	attr->blksize = 4096;
+	if (nodeid == FUSE_ROOT_ID) {
+		attr->mode = S_IFDIR | 0755;
+		attr->nlink = 2;
+	} else {
+		attr->mode = S_IFREG | 0644;
+		attr->size = file_size;
+		attr->blocks = file_size / 512;
+	}
+}
+
+static void do_init(struct fuse_in_header *in, void *arg)
+{
+	struct fuse_init_in *ii = arg;
+	struct fuse_init_out io;
+
+	memset(&io, 0, sizeof(io));
+	io.major = FUSE_KERNEL_VERSION;
+	io.minor = FUSE_KERNEL_MINOR_VERSION;
+	io.max_readahead = ii->max_readahead;
+	io.max_background = 64;
+	io.congestion_threshold = 48;
+	io.max_write = MAX_WRITE;
+	reply(in->unique, 0, &io, sizeof(io));
+}
+
+static void handle(struct fuse_in_header *in, void *arg, char *data)
+{
+	union {
+		struct fuse_entry_out entry;
+		struct fuse_attr_out attr;
+		struct fuse_open_out open;
+		struct fuse_write_out write;
+	} out;
+	struct fuse_read_in *ri = arg;
+	struct fuse_write_in *wi = arg;
+	struct fuse_passthrough_out pto;
+	ssize_t ret;
+	int id;
+
+	memset(&out, 0, sizeof(out));
+	switch (in->opcode) {
+	case FUSE_INIT:
+		do_init(in, arg);
+		break;
+	case FUSE_LOOKUP:
+		if (in->nodeid != FUSE_ROOT_ID || strcmp(arg, "file")) {
+			reply(in->unique, -ENOENT, NULL, 0);
+			break;
+		}
+		out.entry.nodeid = FILE_NODEID;
+		out.entry.entry_valid = 3600;
+		out.entry.attr_valid = 3600;
+		fill_attr(FILE_NODEID, &out.entry.attr);
+		reply(in->unique, 0, &out.entry, sizeof(out.entry));
+		break;
+	case FUSE_GETATTR:
+		out.attr.attr_valid = 3600;
+		fill_attr(in->nodeid, &out.attr.attr);
+		reply(in->unique, 0, &out.attr, sizeof(out.attr));
+		break;
+	case FUSE_OPEN:
+		out.open.open_flags = FOPEN_DIRECT_IO;
+		if (passthrough) {
+			/* Every id is used up by the reply naming it */
+			memset(&pto, 0, sizeof(pto));
+			pto.fd = backing_fd;
+			id = ioctl(fuse_fd, FUSE_DEV_IOC_PASSTHROUGH_OPEN, &pto);
+			if (id > 0) {
+				out.open.open_flags = 0;
+				out.open.passthrough_id = id;
+			} else {
+				perror("passthrough not supported");
+				passthrough = 0;
+			}
+		}
+		reply(in->unique, 0, &out.open, sizeof(out.open));
+		break;
+	case FUSE_READ:
+		ret = pread(backing_fd, data, ri->size, ri->offset);
+		if (ret < 0)
+			reply(in->unique, -errno, NULL, 0);
+		else
+			reply(in->unique, 0, data, ret);
+		break;
+	case FUSE_WRITE:
+		ret = pwrite(backing_fd, wi + 1, wi->size, wi->offset);
+		if (ret < 0) {
+			reply(in->unique, -errno, NULL, 0);
+			break;
+		}
+		out.write.size = ret;
+		reply(in->unique, 0, &out.write, sizeof(out.write));
+		break;
+	case FUSE_FLUSH:
+	case FUSE_RELEASE:
+	case FUSE_OPENDIR:
+	case FUSE_RELEASEDIR:
+		reply(in->unique, 0, NULL, 0);
+		break;
+	case FUSE_FORGET:
+	case FUSE_BATCH_FORGET:
+	case FUSE_INTERRUPT:
+		break;
+	default:
+		reply(in->unique, -ENOSYS, NULL, 0);
+	}
+}
+
+static void *reader(void *data)
+{
+	char *buf = malloc(BUF_SIZE), *reply_buf = malloc(BUF_SIZE);
+	ssize_t len;
+
+	bind_cpu((long)data);
+	while (buf && reply_buf) {
+		len = read(fuse_fd, buf, BUF_SIZE);
+		if (len < 0) {
+			if (errno == EINTR || errno == ENOENT)
+				continue;
+			/* ENODEV once the filesystem is unmounted */
+			break;
+		}
+		if (len < (ssize_t)sizeof(struct fuse_in_header))
+			break;
+		handle((struct fuse_in_header *)buf,
+		       buf + sizeof(struct fuse_in_header), reply_buf);
+	}
+	free(buf);
+	free(reply_buf);
+	return NULL;
+}
+
+static void *client(void *data)
+{
+	struct client *c = data;
+	unsigned long long nr_blocks = file_size / block, off;
+	unsigned int seed = c->cpu;
+	char *buf = malloc(block);
+	double start;
+	ssize_t ret;
+	int fd;
+
+	bind_cpu(c->cpu);
+	fd = open(file_path, O_RDWR);
+	if (fd < 0 || !buf) {
+		perror(file_path);
+		return NULL;
+	}
+	memset(buf, 0x5a, block);
+	while (!stop) {
+		off = (unsigned long long)rand_r(&seed) % nr_blocks * block;
+		start = now();
+		if (do_write)
+			ret = pwrite(fd, buf, block, off);
+		else
+			ret = pread(fd, buf, block, off);
+		if (ret != block) {
+			perror(do_write ? "pwrite" : "pread");
+			break;
+		}
+		c->latency += now() - start;
+		c->ops++;
+	}
+	close(fd);
+	free(buf);
+	return NULL;
+}
+
+static void print_queues(const char *mnt)
+{
+	char path[128], line[128];
+	struct stat st;
+	FILE *f;
+
+	if (stat(mnt, &st) < 0)
+		return;
+	snprintf(path, sizeof(path), "/sys/fs/fuse/connections/%u/queues",
+		 major(st.st_dev) << 20 | minor(st.st_dev));
+	f = fopen(path, "r");
+	if (!f)
+		return;
+	printf("pending queues:\n");
+	while (fgets(line, sizeof(line), f))
+		printf("  %s", line);
+	fclose(f);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "Usage: %s [-r readers] [-c clients] [-b KB] [-s MB] "
+		"[-t sec] [-w] [-a] [-p] <mountpoint> <backing file>\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t *readers;
+	struct client *clients;
+	unsigned long long ops = 0;
+	double latency = 0, elapsed;
+	char opts[128];
+	const char *mnt;
+	int i, opt;
+
+	while ((opt = getopt(argc, argv, "r:c:b:s:t:wap")) != -1) {
+		switch (opt) {
+		case 'r':
+			nr_readers = atoi(optarg);
+			break;
+		case 'c':
+			nr_clients = atoi(optarg);
+			break;
+		case 'b':
+			block = atoi(optarg) * 1024;
+			break;
+		case 's':
+			file_size = strtoull(optarg, NULL, 10) << 20;
+			break;
+		case 't':
+			duration = atoi(optarg);
+			break;
+		case 'w':
+			do_write = 1;
+			break;
+		case 'a':
+			affinity = 1;
+			break;
+		case 'p':
+			passthrough = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (argc - optind != 2 || nr_readers < 1 || nr_clients < 1 ||
+	    block < 512 || block > MAX_WRITE || file_size < (unsigned)block)
+		usage(argv[0]);
+	mnt = argv[optind];
+
+	backing_fd = open(argv[optind + 1], O_RDWR | O_CREAT, 0644);
+	if (backing_fd < 0 || ftruncate(backing_fd, file_size) < 0) {
+		perror(argv[optind + 1]);
+		return 1;
+	}
+	fuse_fd = open("/dev/fuse", O_RDWR);
+	if (fuse_fd < 0) {
+		perror("/dev/fuse");
+		return 1;
+	}
+	snprintf(opts, sizeof(opts), "fd=%d,rootmode=40000,user_id=0,"
+		 "group_id=0", fuse_fd);
+	if (mount("fuse-bench", mnt, "fuse", MS_NOSUID | MS_NODEV, opts) < 0) {
+		perror("mount");
+		return 1;
+	}
+	if (asprintf(&file_path, "%s/file", mnt) < 0)
+		return 1;
+
+	readers = calloc(nr_readers, sizeof(*readers));
+	clients = calloc(nr_clients, sizeof(*clients));
+	if (!readers || !clients)
+		return 1;
+	for (i = 0; i < nr_readers; i++)
+		pthread_create(&readers[i], NULL, reader, (void *)(long)i);
+
+	elapsed = now();
+	for (i = 0; i < nr_clients; i++) {
+		clients[i].cpu = i;
+		pthread_create(&clients[i].thread, NULL, client, &clients[i]);
+	}
+	sleep(duration);
+	stop = 1;
+	for (i = 0; i < nr_clients; i++) {
+		pthread_join(clients[i].thread, NULL);
+		ops += clients[i].ops;
+		latency += clients[i].latency;
+	}
+	elapsed = now() - elapsed;
+
+	printf("%s%s of %d KB, %d readers, %d clients: %.0f ops/s, %.1f MB/s, "
+	       "avg %.1f us\n", passthrough ? "passthrough " : "",
+	       do_write ? "writes" : "reads", block / 1024,
+	       nr_readers, nr_clients, ops / elapsed,
+	       ops * block / elapsed / (1 << 20),
+	       ops ? latency * 1e6 / ops : 0.0);
+	print_queues(mnt);
+
+	umount2(mnt, MNT_DETACH);
+	for (i = 0; i < nr_readers; i++)
+		pthread_join(readers[i], NULL);
+	close(fuse_fd);
+	close(backing_fd);
+	return 0;
+}
@@ -0,0 +1,303 @@
+/*
+ * path-lookup:
+ *
+ * Path lookup microbenchmark modelled on the Android framework, which
+ * stats the same few hundred /data/data/<package> paths over and over,
+ * many of them for files that do not exist.  A tree of package
+ * directories is created under the given directory, then a number of
+ * threads stat paths in it for a fixed time in three phases:
+ *
+ *   hot       existing files, e.g. <pkg>/shared_prefs/prefs.xml
+ *   negative  missing files in existing directories
+ *   mixed     both, in a 3:1 ratio
+ *
+ * For every phase the stats per second and the average time of a stat are
+ * reported, together with the change in the lookup counters of the
+ * filesystem in /proc/fs/lookup_stats: walks completed in rcu-walk mode,
+ * fallbacks to ref-walk and dcache hits, negative hits and misses.
+ *
+ * Usage: path-lookup <directory> [packages] [seconds per phase] [threads]
+ *
+ * The defaults are 300 packages, 5 seconds and one thread.  The tree is
+ * removed at the end.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define MAX_SB		64
+#define MAX_FIELDS	32
+#define NR_MISSING	8
+
+static const char *subdirs[] = { "files", "cache", "databases",
+				 "shared_prefs" };
+#define NR_SUBDIRS	(sizeof(subdirs) / sizeof(subdirs[0]))
+
+enum phase { HOT, NEGATIVE, MIXED };
+static const char *phase_names[] = { "hot", "negative", "mixed" };
+
+static const char *base;
+static int packages = 300;
+static volatile int stop;
+static enum phase phase;
+
+struct worker {
+	pthread_t thread;
+	unsigned int seed;
+	unsigned long nr;
+};
+
+/* One line of /proc/fs/lookup_stats */
+struct sb_stat {
+	char id[128];
+	int nr;
+	char name[MAX_FIELDS][32];
+	unsigned long val[MAX_FIELDS];
+};
+
+struct snapshot {
+	int nr;
+	struct sb_stat sb[MAX_SB];
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void read_snapshot(struct snapshot *s)
+{
+	char line[4096], *tok, *save;
+	struct sb_stat *sb;
+	FILE *f = fopen("/proc/fs/lookup_stats", "r");
+
+	s->nr = 0;
+	if (!f)
+		return;
+	while (s->nr < MAX_SB && fgets(line, sizeof(line), f)) {
+		sb = &s->sb[s->nr++];
+		sb->nr = 0;
+		/* "<s_id> <type> name value name value ..." */
+		tok = strtok_r(line, " \n", &save);
+		snprintf(sb->id, sizeof(sb->id), "%s", tok ? tok : "");
+		tok = strtok_r(NULL, " \n", &save);
+		if (tok)
+			snprintf(sb->id + strlen(sb->id),
+				 sizeof(sb->id) - strlen(sb->id), " %s", tok);
+		while (sb->nr < MAX_FIELDS &&
+		       (tok = strtok_r(NULL, " \n", &save))) {
+			snprintf(sb->name[sb->nr], sizeof(sb->name[0]), "%s",
+				 tok);
+			tok = strtok_r(NULL, " \n", &save);
+			if (!tok)
+				break;
+			sb->val[sb->nr++] = strtoul(tok, NULL, 10);
+		}
+	}
+	fclose(f);
+}
+
+static unsigned long field(struct sb_stat *sb, const char *name)
+{
+	int i;
+
+	for (i = 0; i < sb->nr; i++)
+		if (!strcmp(sb->name[i], name))
+			return sb->val[i];
+	return 0;
+}
+
+static unsigned long lookups(struct sb_stat *sb)
+{
+	return field(sb, "d_hits") + field(sb, "d_neg_hits") +
+		field(sb, "d_misses");
+}
+
+/* Print the counter deltas of the superblock that saw most lookups */
+static void print_delta(struct snapshot *before, struct snapshot *after)
+{
+	struct sb_stat *best = NULL, *prev = NULL;
+	unsigned long most = 0, d;
+	int i, j;
+
+	for (i = 0; i < after->nr; i++) {
+		for (j = 0; j < before->nr; j++) {
+			if (strcmp(after->sb[i].id, before->sb[j].id))
+				continue;
+			d = lookups(&after->sb[i]) - lookups(&before->sb[j]);
+			if (d > most) {
+				most = d;
+				best = &after->sb[i];
+				prev = &before->sb[j];
+			}
+			break;
+		}
+	}
+	if (!best)
+		return;
+
+	printf("    %s:", best->id);
+	for (i = 0; i < best->nr; i++) {
+		/* gauges, not counters */
+		if (!strcmp(best->name[i], "unused") ||
+		    !strcmp(best->name[i], "neg_unused")) {
+			printf(" %s %lu", best->name[i], best->val[i]);
+			continue;
+		}
+		d = best->val[i] - field(prev, best->name[i]);
+		if (d)
+			printf(" %s +%lu", best->name[i], d);
+	}
+	printf("\n");
+}
+
+static void make_path(char *buf, size_t len, unsigned int *seed, int hot)
+{
+	int pkg = rand_r(seed) % packages;
+	int dir = rand_r(seed) % NR_SUBDIRS;
+
+	if (hot)
+		snprintf(buf, len, "%s/com.example.app%d/%s/present", base,
+			 pkg, subdirs[dir]);
+	else
+		snprintf(buf, len, "%s/com.example.app%d/%s/missing%d", base,
+			 pkg, subdirs[dir], rand_r(seed) % NR_MISSING);
+}
+
+static void *worker(void *data)
+{
+	struct worker *w = data;
+	char path[PATH_MAX];
+	struct stat st;
+	int hot;
+
+	while (!stop) {
+		if (phase == MIXED)
+			hot = rand_r(&w->seed) % 4 != 0;
+		else
+			hot = phase == HOT;
+		make_path(path, sizeof(path), &w->seed, hot);
+		if (stat(path, &st) < 0 && hot) {
+			perror(path);
+			break;
+		}
+		w->nr++;
+	}
+	return NULL;
+}
+
+static void run(int threads, int seconds)
+{
+	struct snapshot *before = malloc(sizeof(*before));
+	struct snapshot *after = malloc(sizeof(*after));
+	struct worker *w = calloc(threads, sizeof(*w));
+	unsigned long nr = 0;
+	double elapsed;
+	int i;
+
+	if (!before || !after || !w)
+		exit(1);
+
+	stop = 0;
+	read_snapshot(before);
+	elapsed = now();
+	for (i = 0; i < threads; i++) {
+		w[i].seed = i + 1;
+		pthread_create(&w[i].thread, NULL, worker, &w[i]);
+	}
+	sleep(seconds);
+	stop = 1;
+	for (i = 0; i < threads; i++) {
+		pthread_join(w[i].thread, NULL);
+		nr += w[i].nr;
+	}
+	elapsed = now() - elapsed;
+	read_snapshot(after);
+
+	printf("%-8s: %10.0f stats/s, %7.0f ns/stat\n", phase_names[phase],
+	       nr / elapsed, nr ? elapsed * threads * 1e9 / nr : 0.0);
+	print_delta(before, after);
+
+	free(before);
+	free(after);
+	free(w);
+}
+
+static void build_tree(int create)
+{
+	char path[PATH_MAX];
+	unsigned int d;
+	int pkg, fd;
+
+	for (pkg = 0; pkg < packages; pkg++) {
+		for (d = 0; d < NR_SUBDIRS; d++) {
+			snprintf(path, sizeof(path),
+				 "%s/com.example.app%d/%s/present", base, pkg,
+				 subdirs[d]);
+			if (!create) {
+				unlink(path);
+				*strrchr(path, '/') = '\0';
+				rmdir(path);
+				continue;
+			}
+			*strrchr(path, '/') = '\0';
+			*strrchr(path, '/') = '\0';
+			mkdir(path, 0755);
+			snprintf(path + strlen(path), sizeof(path) - strlen(path),
+				 "/%s", subdirs[d]);
+			mkdir(path, 0755);
+			strcat(path, "/present");
+			fd = open(path, O_WRONLY | O_CREAT, 0644);
+			if (fd < 0) {
+				perror(path);
+				exit(1);
+			}
+			close(fd);
+		}
+		if (!create) {
+			snprintf(path, sizeof(path), "%s/com.example.app%d",
+				 base, pkg);
+			rmdir(path);
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int seconds = 5, threads = 1;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <directory> [packages] "
+			"[seconds per phase] [threads]\n", argv[0]);
+		return 1;
+	}
+	base = argv[1];
+	if (argc > 2)
+		packages = atoi(argv[2]);
+	if (argc > 3)
+		seconds = atoi(argv[3]);
+	if (argc > 4)
+		threads = atoi(argv[4]);
+	if (packages < 1 || seconds < 1 || threads < 1) {
+		fprintf(stderr, "Invalid arguments\n");
+		return 1;
+	}
+
+	build_tree(1);
+	printf("%d packages, %d thread(s)\n", packages, threads);
+	for (phase = HOT; phase <= MIXED; phase++)
+		run(threads, seconds);
+	build_tree(0);
+	return 0;
+}
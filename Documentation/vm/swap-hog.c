@@ -0,0 +1,139 @@
+/*
+ * swap-hog:
+ *
+ * Allocates anonymous memory larger than what is free, writes every page
+ * of it over and over, and reports for every pass how many pages reclaim
+ * freed per second, how many were swapped out and in, and how many of the
+ * swap-outs were merged into a bio of another page (pgsteal*, pswpout,
+ * pswpin and pswpout_merged in /proc/vmstat).
+ *
+ * Meant to be run with zram as the only swap device, where the cost of
+ * reclaim is mostly CPU time spent allocating swap slots and submitting
+ * bios rather than waiting for the device:
+ *
+ *	echo $((2 << 30)) > /sys/block/zram0/disksize
+ *	mkswap /dev/zram0 && swapon /dev/zram0
+ *	swap-hog
+ *
+ * Usage: swap-hog [size in MB] [passes]
+ *
+ * The size defaults to 150% of MemTotal and the number of passes to 5.
+ * Every page is filled with a value that differs per page but compresses
+ * well, as most of anonymous memory does.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+struct counters {
+	unsigned long long pgsteal;
+	unsigned long long pswpout;
+	unsigned long long pswpin;
+	unsigned long long merged;
+};
+
+static unsigned long long meminfo(const char *name)
+{
+	char line[256];
+	unsigned long long val = 0;
+	size_t len = strlen(name);
+	FILE *f = fopen("/proc/meminfo", "r");
+
+	if (!f)
+		return 0;
+	while (fgets(line, sizeof(line), f))
+		if (!strncmp(line, name, len) && line[len] == ':') {
+			val = strtoull(line + len + 1, NULL, 10);
+			break;
+		}
+	fclose(f);
+	return val;
+}
+
+static void read_counters(struct counters *c)
+{
+	char name[64];
+	unsigned long long val;
+	FILE *f = fopen("/proc/vmstat", "r");
+
+	memset(c, 0, sizeof(*c));
+	if (!f)
+		return;
+	while (fscanf(f, "%63s %llu", name, &val) == 2) {
+		if (!strncmp(name, "pgsteal_", 8))
+			c->pgsteal += val;
+		else if (!strcmp(name, "pswpout"))
+			c->pswpout = val;
+		else if (!strcmp(name, "pswpin"))
+			c->pswpin = val;
+		else if (!strcmp(name, "pswpout_merged"))
+			c->merged = val;
+	}
+	fclose(f);
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long size, off;
+	struct counters before, after;
+	long pagesize = sysconf(_SC_PAGESIZE);
+	int pass, passes = 5;
+	double start, secs;
+	char *mem;
+
+	if (argc > 1)
+		size = strtoull(argv[1], NULL, 10) << 20;
+	else
+		size = meminfo("MemTotal") * 1024 * 3 / 2;
+	if (argc > 2)
+		passes = atoi(argv[2]);
+	size &= ~(unsigned long long)(pagesize - 1);
+	if (!size) {
+		fprintf(stderr, "Usage: %s [size in MB] [passes]\n", argv[0]);
+		return 1;
+	}
+
+	mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	printf("Writing %llu MB, MemTotal %llu MB, SwapTotal %llu MB\n",
+	       size >> 20, meminfo("MemTotal") >> 10,
+	       meminfo("SwapTotal") >> 10);
+	for (pass = 1; pass <= passes; pass++) {
+		read_counters(&before);
+		start = now();
+		for (off = 0; off < size; off += pagesize)
+			memset(mem + off, (int)(off / pagesize + pass), 64);
+		secs = now() - start;
+		read_counters(&after);
+
+		printf("pass %d: %.2fs, reclaimed %.0f pages/s, "
+		       "swapped out %llu, in %llu, merged %llu (%llu%%)\n",
+		       pass, secs, (after.pgsteal - before.pgsteal) / secs,
+		       after.pswpout - before.pswpout,
+		       after.pswpin - before.pswpin,
+		       after.merged - before.merged,
+		       after.pswpout - before.pswpout ?
+		       (after.merged - before.merged) * 100 /
+		       (after.pswpout - before.pswpout) : 0);
+	}
+
+	munmap(mem, size);
+	return 0;
+}
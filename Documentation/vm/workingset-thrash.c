@@ -0,0 +1,176 @@
+/*
+ * workingset-thrash:
+ *
+ * Reads a file that is slightly larger than memory from start to end, over
+ * and over, and reports for every pass how long it took, how much of it had
+ * to be read from disk and how many of the refaults the kernel recognized
+ * and activated (workingset_refault and workingset_activate in /proc/vmstat).
+ *
+ * With plain LRU reclaim every page is evicted before it is read again and
+ * each pass reads the whole file from disk.  With refault detection the
+ * pages that were evicted shortly before they were needed again are
+ * activated, part of the file stays in memory and the passes after the
+ * first one read less from disk.
+ *
+ * Usage: workingset-thrash <file> [size in MB] [passes]
+ *
+ * The file is created and filled if it is smaller than the requested size.
+ * The size defaults to 110% of MemTotal and the number of passes to 5.  Run
+ * it on an otherwise idle system, as root, so that the page cache can be
+ * dropped before the first pass.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#define CHUNK (1024 * 1024)
+
+struct counters {
+	unsigned long long pgpgin;
+	unsigned long long refault;
+	unsigned long long activate;
+};
+
+static unsigned long long meminfo(const char *name)
+{
+	char line[256];
+	unsigned long long val = 0;
+	size_t len = strlen(name);
+	FILE *f = fopen("/proc/meminfo", "r");
+
+	if (!f)
+		return 0;
+	while (fgets(line, sizeof(line), f))
+		if (!strncmp(line, name, len) && line[len] == ':') {
+			val = strtoull(line + len + 1, NULL, 10);
+			break;
+		}
+	fclose(f);
+	return val;
+}
+
+static void read_counters(struct counters *c)
+{
+	char name[64];
+	unsigned long long val;
+	FILE *f = fopen("/proc/vmstat", "r");
+
+	memset(c, 0, sizeof(*c));
+	if (!f)
+		return;
+	while (fscanf(f, "%63s %llu", name, &val) == 2) {
+		if (!strcmp(name, "pgpgin"))
+			c->pgpgin = val;
+		else if (!strcmp(name, "workingset_refault"))
+			c->refault = val;
+		else if (!strcmp(name, "workingset_activate"))
+			c->activate = val;
+	}
+	fclose(f);
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void fill(int fd, unsigned long long size, char *buf)
+{
+	struct stat st;
+	unsigned long long off;
+
+	if (fstat(fd, &st) < 0) {
+		perror("fstat");
+		exit(1);
+	}
+	if ((unsigned long long)st.st_size >= size)
+		return;
+
+	printf("Filling %llu MB\n", size >> 20);
+	memset(buf, 0x5a, CHUNK);
+	for (off = 0; off < size; off += CHUNK) {
+		if (pwrite(fd, buf, CHUNK, off) != CHUNK) {
+			perror("pwrite");
+			exit(1);
+		}
+	}
+	fsync(fd);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long size, off;
+	struct counters before, after;
+	int fd, pass, passes = 5;
+	double start;
+	char *buf;
+	FILE *f;
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s <file> [size in MB] [passes]\n",
+			argv[0]);
+		return 1;
+	}
+
+	if (argc > 2)
+		size = strtoull(argv[2], NULL, 10) << 20;
+	else
+		size = meminfo("MemTotal") * 1024 * 11 / 10;
+	if (argc > 3)
+		passes = atoi(argv[3]);
+	size &= ~(unsigned long long)(CHUNK - 1);
+	if (!size) {
+		fprintf(stderr, "Cannot determine the size\n");
+		return 1;
+	}
+
+	buf = malloc(CHUNK);
+	fd = open(argv[1], O_RDWR | O_CREAT, 0644);
+	if (!buf || fd < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+	fill(fd, size, buf);
+
+	/* Start with the file out of memory, if allowed to */
+	sync();
+	f = fopen("/proc/sys/vm/drop_caches", "w");
+	if (f) {
+		fputs("1\n", f);
+		fclose(f);
+	}
+
+	printf("Reading %llu MB, MemTotal %llu MB\n", size >> 20,
+	       meminfo("MemTotal") >> 10);
+	for (pass = 1; pass <= passes; pass++) {
+		read_counters(&before);
+		start = now();
+		for (off = 0; off < size; off += CHUNK) {
+			if (pread(fd, buf, CHUNK, off) != CHUNK) {
+				perror("pread");
+				return 1;
+			}
+		}
+		read_counters(&after);
+
+		printf("pass %d: %.2fs, read from disk %llu MB (%llu%%), "
+		       "refaults %llu, activated %llu\n", pass, now() - start,
+		       (after.pgpgin - before.pgpgin) >> 10,
+		       (after.pgpgin - before.pgpgin) * 1024 * 100 / size,
+		       after.refault - before.refault,
+		       after.activate - before.activate);
+	}
+
+	close(fd);
+	free(buf);
+	return 0;
+}
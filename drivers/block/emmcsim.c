@@ -0,0 +1,764 @@
+/*
+ * Emulated eMMC block device driver.
+ *
+ * A RAM backed block device, structured like brd, that charges every bio
+ * with the cost a managed NAND device would have for it: a read latency
+ * per page, a program latency per page, an erase latency whenever the
+ * write pointer crosses into a new erase block, an optional volatile
+ * write cache whose contents have to be programmed on a flush, and a
+ * periodic garbage collection stall. All parameters can be changed at
+ * runtime through sysfs, and per-request latency statistics are kept so
+ * that changes to the storage stack can be evaluated without hardware.
+ *
+ * See Documentation/blockdev/emmcsim.txt for the sysfs interface.
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/blkdev.h>
+#include <linux/bio.h>
+#include <linux/highmem.h>
+#include <linux/mutex.h>
+#include <linux/radix-tree.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/device.h>
+#include <linux/genhd.h>
+#include <linux/slab.h>
+
+#define SECTOR_SHIFT		9
+#define PAGE_SECTORS_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
+#define PAGE_SECTORS		(1 << PAGE_SECTORS_SHIFT)
+
+/* Latency histogram buckets: [0] < 2us, [n] < 2^(n+1)us, last is open */
+#define EMMCSIM_HIST_BUCKETS	20
+
+enum emmcsim_op {
+	EMMCSIM_READ,
+	EMMCSIM_WRITE,
+	EMMCSIM_FLUSH,
+	EMMCSIM_DISCARD,
+	EMMCSIM_NR_OPS,
+};
+
+static const char * const emmcsim_op_names[EMMCSIM_NR_OPS] = {
+	"read", "write", "flush", "discard",
+};
+
+struct emmcsim_op_stats {
+	u64	count;
+	u64	sectors;
+	u64	total_us;
+	u64	max_us;
+	u64	hist[EMMCSIM_HIST_BUCKETS];
+};
+
+/*
+ * Emulated flash timing. All latencies are in microseconds; sizes are in
+ * kbytes. A zero latency disables the corresponding cost.
+ */
+struct emmcsim_params {
+	unsigned int	read_lat_us;		/* per page read */
+	unsigned int	prog_lat_us;		/* per page program */
+	unsigned int	erase_lat_us;		/* per erase block */
+	unsigned int	erase_block_kb;
+	unsigned int	cache_kb;		/* 0: write through */
+	unsigned int	flush_lat_us;		/* fixed cost of a cache flush */
+	unsigned int	gc_interval;		/* erase blocks between GC stalls */
+	unsigned int	gc_stall_us;
+};
+
+struct emmcsim_device {
+	int			number;
+
+	struct request_queue	*queue;
+	struct gendisk		*disk;
+	struct list_head	list;
+
+	/* Backing store, as in brd */
+	spinlock_t		pages_lock;
+	struct radix_tree_root	pages;
+
+	/*
+	 * The emulated device processes one command at a time. busy_lock
+	 * serialises bios and protects the flash state below.
+	 */
+	struct mutex		busy_lock;
+	struct emmcsim_params	params;
+	unsigned long		cache_dirty;	/* pages in the write cache */
+	unsigned long		wp_pages;	/* pages programmed in the open block */
+	u64			erased_blocks;
+	u64			gc_stalls;
+	u64			gc_stall_us;
+	u64			flash_pages_written;
+
+	spinlock_t		stats_lock;
+	struct emmcsim_op_stats	stats[EMMCSIM_NR_OPS];
+};
+
+static int emmcsim_major;
+static unsigned int nr_devices = 1;
+static unsigned int disk_size_kb = 65536;
+static struct emmcsim_params default_params = {
+	.read_lat_us	= 50,
+	.prog_lat_us	= 250,
+	.erase_lat_us	= 2000,
+	.erase_block_kb	= 512,
+	.cache_kb	= 512,
+	.flush_lat_us	= 100,
+	.gc_interval	= 64,
+	.gc_stall_us	= 20000,
+};
+
+module_param(nr_devices, uint, S_IRUGO);
+MODULE_PARM_DESC(nr_devices, "Number of emulated eMMC devices");
+module_param(disk_size_kb, uint, S_IRUGO);
+MODULE_PARM_DESC(disk_size_kb, "Size of each emulated device in kbytes");
+module_param_named(read_lat_us, default_params.read_lat_us, uint, S_IRUGO);
+MODULE_PARM_DESC(read_lat_us, "Default per page read latency (us)");
+module_param_named(prog_lat_us, default_params.prog_lat_us, uint, S_IRUGO);
+MODULE_PARM_DESC(prog_lat_us, "Default per page program latency (us)");
+module_param_named(erase_lat_us, default_params.erase_lat_us, uint, S_IRUGO);
+MODULE_PARM_DESC(erase_lat_us, "Default erase block latency (us)");
+module_param_named(erase_block_kb, default_params.erase_block_kb, uint,
+		   S_IRUGO);
+MODULE_PARM_DESC(erase_block_kb, "Default erase block size (kbytes)");
+module_param_named(cache_kb, default_params.cache_kb, uint, S_IRUGO);
+MODULE_PARM_DESC(cache_kb, "Default write cache size (kbytes, 0 disables)");
+module_param_named(flush_lat_us, default_params.flush_lat_us, uint, S_IRUGO);
+MODULE_PARM_DESC(flush_lat_us, "Default fixed cache flush latency (us)");
+module_param_named(gc_interval, default_params.gc_interval, uint, S_IRUGO);
+MODULE_PARM_DESC(gc_interval, "Default erase blocks between GC stalls");
+module_param_named(gc_stall_us, default_params.gc_stall_us, uint, S_IRUGO);
+MODULE_PARM_DESC(gc_stall_us, "Default GC stall latency (us)");
+
+static LIST_HEAD(emmcsim_devices);
+
+/*
+ * Backing store handling. This is a trimmed down copy of the brd radix
+ * tree code; pages are allocated on first write and never freed until the
+ * device goes away.
+ */
+static struct page *emmcsim_lookup_page(struct emmcsim_device *dev,
+					 sector_t sector)
+{
+	struct page *page;
+
+	rcu_read_lock();
+	page = radix_tree_lookup(&dev->pages, sector >> PAGE_SECTORS_SHIFT);
+	rcu_read_unlock();
+
+	return page;
+}
+
+static struct page *emmcsim_insert_page(struct emmcsim_device *dev,
+					 sector_t sector)
+{
+	pgoff_t idx = sector >> PAGE_SECTORS_SHIFT;
+	struct page *page;
+
+	page = emmcsim_lookup_page(dev, sector);
+	if (page)
+		return page;
+
+	page = alloc_page(GFP_NOIO | __GFP_ZERO | __GFP_HIGHMEM);
+	if (!page)
+		return NULL;
+
+	if (radix_tree_preload(GFP_NOIO)) {
+		__free_page(page);
+		return NULL;
+	}
+
+	spin_lock(&dev->pages_lock);
+	page->index = idx;
+	if (radix_tree_insert(&dev->pages, idx, page)) {
+		__free_page(page);
+		page = radix_tree_lookup(&dev->pages, idx);
+		BUG_ON(!page);
+	}
+	spin_unlock(&dev->pages_lock);
+
+	radix_tree_preload_end();
+
+	return page;
+}
+
+#define FREE_BATCH 16
+static void emmcsim_free_pages(struct emmcsim_device *dev)
+{
+	unsigned long pos = 0;
+	struct page *pages[FREE_BATCH];
+	int nr_pages;
+
+	do {
+		int i;
+
+		nr_pages = radix_tree_gang_lookup(&dev->pages,
+				(void **)pages, pos, FREE_BATCH);
+
+		for (i = 0; i < nr_pages; i++) {
+			pos = pages[i]->index;
+			radix_tree_delete(&dev->pages, pos);
+			__free_page(pages[i]);
+		}
+
+		pos++;
+	} while (nr_pages == FREE_BATCH);
+}
+
+/*
+ * Copy one bvec worth of data, which may straddle two backing pages.
+ */
+static int emmcsim_do_bvec(struct emmcsim_device *dev, struct page *page,
+			   unsigned int len, unsigned int off, int rw,
+			   sector_t sector)
+{
+	void *mem;
+
+	mem = kmap_atomic(page, KM_USER0);
+	while (len) {
+		unsigned int offset = (sector & (PAGE_SECTORS - 1))
+						<< SECTOR_SHIFT;
+		unsigned int copy = min_t(unsigned int, len,
+					  PAGE_SIZE - offset);
+		struct page *store;
+		void *p;
+
+		if (rw == READ) {
+			store = emmcsim_lookup_page(dev, sector);
+			if (store) {
+				p = kmap_atomic(store, KM_USER1);
+				memcpy(mem + off, p + offset, copy);
+				kunmap_atomic(p, KM_USER1);
+			} else
+				memset(mem + off, 0, copy);
+		} else {
+			/* Pages are inserted before mapping, see caller */
+			store = emmcsim_lookup_page(dev, sector);
+			BUG_ON(!store);
+			p = kmap_atomic(store, KM_USER1);
+			memcpy(p + offset, mem + off, copy);
+			kunmap_atomic(p, KM_USER1);
+		}
+
+		off += copy;
+		len -= copy;
+		sector += copy >> SECTOR_SHIFT;
+	}
+	kunmap_atomic(mem, KM_USER0);
+
+	if (rw == READ)
+		flush_dcache_page(page);
+
+	return 0;
+}
+
+static int emmcsim_prepare_write(struct emmcsim_device *dev,
+				 sector_t sector, unsigned int len)
+{
+	sector_t last = sector + ((len - 1) >> SECTOR_SHIFT);
+
+	if (!emmcsim_insert_page(dev, sector))
+		return -ENOMEM;
+	if ((last >> PAGE_SECTORS_SHIFT) != (sector >> PAGE_SECTORS_SHIFT) &&
+	    !emmcsim_insert_page(dev, last))
+		return -ENOMEM;
+	return 0;
+}
+
+static void emmcsim_discard(struct emmcsim_device *dev, sector_t sector,
+			    unsigned int n)
+{
+	while (n >= PAGE_SIZE) {
+		struct page *page = emmcsim_lookup_page(dev, sector);
+
+		if (page)
+			clear_highpage(page);
+		sector += PAGE_SECTORS;
+		n -= PAGE_SIZE;
+	}
+}
+
+/*
+ * Flash timing model. These run under busy_lock and return the number
+ * of microseconds the emulated device would be busy.
+ */
+static unsigned long emmcsim_program(struct emmcsim_device *dev,
+				     unsigned long nr_pages)
+{
+	struct emmcsim_params *p = &dev->params;
+	unsigned long block_pages = max_t(unsigned long, 1,
+				(p->erase_block_kb << 10) >> PAGE_SHIFT);
+	unsigned long cost = nr_pages * p->prog_lat_us;
+
+	dev->flash_pages_written += nr_pages;
+	dev->wp_pages += nr_pages;
+	while (dev->wp_pages >= block_pages) {
+		u64 n;
+
+		dev->wp_pages -= block_pages;
+		n = ++dev->erased_blocks;
+		cost += p->erase_lat_us;
+
+		if (p->gc_interval && p->gc_stall_us &&
+		    do_div(n, p->gc_interval) == 0) {
+			dev->gc_stalls++;
+			dev->gc_stall_us += p->gc_stall_us;
+			cost += p->gc_stall_us;
+		}
+	}
+
+	return cost;
+}
+
+static unsigned long emmcsim_flush_cache(struct emmcsim_device *dev)
+{
+	unsigned long cost;
+
+	if (!dev->params.cache_kb)
+		return 0;
+
+	cost = dev->params.flush_lat_us;
+	if (dev->cache_dirty)
+		cost += emmcsim_program(dev, dev->cache_dirty);
+	dev->cache_dirty = 0;
+
+	return cost;
+}
+
+static unsigned long emmcsim_write_cost(struct emmcsim_device *dev,
+					unsigned long nr_pages, bool fua)
+{
+	unsigned long cache_pages = (dev->params.cache_kb << 10) >> PAGE_SHIFT;
+	unsigned long cost = 0;
+
+	if (fua || nr_pages > cache_pages)
+		return emmcsim_program(dev, nr_pages);
+
+	/* Make room in the cache by programming the oldest data */
+	if (dev->cache_dirty + nr_pages > cache_pages) {
+		unsigned long evict = dev->cache_dirty + nr_pages - cache_pages;
+
+		cost = emmcsim_program(dev, evict);
+		dev->cache_dirty -= evict;
+	}
+	dev->cache_dirty += nr_pages;
+
+	return cost;
+}
+
+static void emmcsim_delay(unsigned long us)
+{
+	if (!us)
+		return;
+	if (us < 10)
+		udelay(us);
+	else if (us < 20000)
+		usleep_range(us, us + (us >> 3));
+	else
+		msleep(DIV_ROUND_UP(us, 1000));
+}
+
+static void emmcsim_account(struct emmcsim_device *dev, enum emmcsim_op op,
+			    unsigned int sectors, ktime_t start)
+{
+	struct emmcsim_op_stats *st = &dev->stats[op];
+	u64 us = ktime_to_us(ktime_sub(ktime_get(), start));
+	int bucket = us ? min(fls64(us) - 1, EMMCSIM_HIST_BUCKETS - 1) : 0;
+
+	spin_lock(&dev->stats_lock);
+	st->count++;
+	st->sectors += sectors;
+	st->total_us += us;
+	if (us > st->max_us)
+		st->max_us = us;
+	st->hist[bucket]++;
+	spin_unlock(&dev->stats_lock);
+}
+
+static int emmcsim_make_request(struct request_queue *q, struct bio *bio)
+{
+	struct emmcsim_device *dev = q->queuedata;
+	unsigned int sectors = bio_sectors(bio);
+	unsigned long nr_pages = DIV_ROUND_UP(bio->bi_size, PAGE_SIZE);
+	unsigned long cost = 0;
+	ktime_t start = ktime_get();
+	enum emmcsim_op op;
+	struct bio_vec *bvec;
+	sector_t sector;
+	int rw, i;
+	int err = -EIO;
+
+	sector = bio->bi_sector;
+	if (sector + sectors > get_capacity(dev->disk))
+		goto out;
+
+	rw = bio_rw(bio);
+	if (rw == READA)
+		rw = READ;
+
+	if (bio->bi_rw & REQ_DISCARD)
+		op = EMMCSIM_DISCARD;
+	else if (rw == READ)
+		op = EMMCSIM_READ;
+	else if (!sectors)
+		op = EMMCSIM_FLUSH;
+	else
+		op = EMMCSIM_WRITE;
+
+	mutex_lock(&dev->busy_lock);
+
+	if (bio->bi_rw & REQ_FLUSH)
+		cost += emmcsim_flush_cache(dev);
+
+	err = 0;
+	switch (op) {
+	case EMMCSIM_DISCARD:
+		emmcsim_discard(dev, sector, bio->bi_size);
+		goto done;
+	case EMMCSIM_FLUSH:
+		goto done;
+	case EMMCSIM_READ:
+		cost += nr_pages * dev->params.read_lat_us;
+		break;
+	default:
+		cost += emmcsim_write_cost(dev, nr_pages,
+					   bio->bi_rw & REQ_FUA);
+		break;
+	}
+
+	bio_for_each_segment(bvec, bio, i) {
+		unsigned int len = bvec->bv_len;
+
+		if (rw != READ) {
+			err = emmcsim_prepare_write(dev, sector, len);
+			if (err)
+				break;
+		}
+		emmcsim_do_bvec(dev, bvec->bv_page, len, bvec->bv_offset,
+				rw, sector);
+		sector += len >> SECTOR_SHIFT;
+	}
+
+done:
+	emmcsim_delay(cost);
+	mutex_unlock(&dev->busy_lock);
+
+	if (!err)
+		emmcsim_account(dev, op, sectors, start);
+out:
+	bio_endio(bio, err);
+
+	return 0;
+}
+
+static const struct block_device_operations emmcsim_fops = {
+	.owner =		THIS_MODULE,
+};
+
+/*
+ * sysfs interface, attached to /sys/block/emmcsimN/emmcsim/.
+ */
+static struct emmcsim_device *dev_to_emmcsim(struct device *dev)
+{
+	return dev_to_disk(dev)->private_data;
+}
+
+#define EMMCSIM_PARAM_ATTR(name)					\
+static ssize_t name##_show(struct device *d,				\
+		struct device_attribute *attr, char *buf)		\
+{									\
+	struct emmcsim_device *dev = dev_to_emmcsim(d);			\
+									\
+	return sprintf(buf, "%u\n", dev->params.name);			\
+}									\
+static ssize_t name##_store(struct device *d,				\
+		struct device_attribute *attr, const char *buf,		\
+		size_t len)						\
+{									\
+	struct emmcsim_device *dev = dev_to_emmcsim(d);			\
+	unsigned long val;						\
+									\
+	if (strict_strtoul(buf, 10, &val) || val > UINT_MAX)		\
+		return -EINVAL;						\
+	mutex_lock(&dev->busy_lock);					\
+	dev->params.name = val;						\
+	emmcsim_params_changed(dev);					\
+	mutex_unlock(&dev->busy_lock);					\
+	return len;							\
+}									\
+static DEVICE_ATTR(name, S_IRUGO | S_IWUSR, name##_show, name##_store)
+
+/* Called under busy_lock when a timing parameter was changed */
+static void emmcsim_params_changed(struct emmcsim_device *dev)
+{
+	unsigned long cache_pages = (dev->params.cache_kb << 10) >> PAGE_SHIFT;
+
+	if (!dev->params.erase_block_kb)
+		dev->params.erase_block_kb = PAGE_SIZE >> 10;
+	/* A shrunk cache is written back immediately, without delay */
+	if (dev->cache_dirty > cache_pages) {
+		emmcsim_program(dev, dev->cache_dirty - cache_pages);
+		dev->cache_dirty = cache_pages;
+	}
+}
+
+EMMCSIM_PARAM_ATTR(read_lat_us);
+EMMCSIM_PARAM_ATTR(prog_lat_us);
+EMMCSIM_PARAM_ATTR(erase_lat_us);
+EMMCSIM_PARAM_ATTR(erase_block_kb);
+EMMCSIM_PARAM_ATTR(cache_kb);
+EMMCSIM_PARAM_ATTR(flush_lat_us);
+EMMCSIM_PARAM_ATTR(gc_interval);
+EMMCSIM_PARAM_ATTR(gc_stall_us);
+
+static ssize_t flash_show(struct device *d,
+		struct device_attribute *attr, char *buf)
+{
+	struct emmcsim_device *dev = dev_to_emmcsim(d);
+	ssize_t ret;
+
+	mutex_lock(&dev->busy_lock);
+	ret = sprintf(buf,
+		"cache_dirty_kb %lu\n"
+		"pages_programmed %llu\n"
+		"erased_blocks %llu\n"
+		"gc_stalls %llu\n"
+		"gc_stall_us %llu\n",
+		dev->cache_dirty << (PAGE_SHIFT - 10),
+		dev->flash_pages_written,
+		dev->erased_blocks,
+		dev->gc_stalls,
+		dev->gc_stall_us);
+	mutex_unlock(&dev->busy_lock);
+
+	return ret;
+}
+static DEVICE_ATTR(flash, S_IRUGO, flash_show, NULL);
+
+/*
+ * One line per operation type:
+ *   <op> <count> <sectors> <total_us> <avg_us> <max_us>
+ */
+static ssize_t stats_show(struct device *d,
+		struct device_attribute *attr, char *buf)
+{
+	struct emmcsim_device *dev = dev_to_emmcsim(d);
+	ssize_t ret = 0;
+	int op;
+
+	spin_lock(&dev->stats_lock);
+	for (op = 0; op < EMMCSIM_NR_OPS; op++) {
+		struct emmcsim_op_stats *st = &dev->stats[op];
+		u64 avg = st->total_us;
+
+		if (st->count)
+			do_div(avg, st->count);
+		ret += sprintf(buf + ret, "%-8s %llu %llu %llu %llu %llu\n",
+			       emmcsim_op_names[op], st->count, st->sectors,
+			       st->total_us, avg, st->max_us);
+	}
+	spin_unlock(&dev->stats_lock);
+
+	return ret;
+}
+
+/* Writing anything resets all statistics and flash counters */
+static ssize_t stats_store(struct device *d,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct emmcsim_device *dev = dev_to_emmcsim(d);
+
+	mutex_lock(&dev->busy_lock);
+	dev->flash_pages_written = 0;
+	dev->erased_blocks = 0;
+	dev->gc_stalls = 0;
+	dev->gc_stall_us = 0;
+	mutex_unlock(&dev->busy_lock);
+
+	spin_lock(&dev->stats_lock);
+	memset(dev->stats, 0, sizeof(dev->stats));
+	spin_unlock(&dev->stats_lock);
+
+	return len;
+}
+static DEVICE_ATTR(stats, S_IRUGO | S_IWUSR, stats_show, stats_store);
+
+/*
+ * Latency histogram of reads and writes, one line per power of two
+ * bucket: <upper bound us> <reads> <writes>
+ */
+static ssize_t latency_hist_show(struct device *d,
+		struct device_attribute *attr, char *buf)
+{
+	struct emmcsim_device *dev = dev_to_emmcsim(d);
+	ssize_t ret = 0;
+	int i;
+
+	spin_lock(&dev->stats_lock);
+	for (i = 0; i < EMMCSIM_HIST_BUCKETS; i++) {
+		if (i == EMMCSIM_HIST_BUCKETS - 1)
+			ret += sprintf(buf + ret, "%8s", "inf");
+		else
+			ret += sprintf(buf + ret, "%8lu", 2UL << i);
+		ret += sprintf(buf + ret, " %llu %llu\n",
+			       dev->stats[EMMCSIM_READ].hist[i],
+			       dev->stats[EMMCSIM_WRITE].hist[i]);
+	}
+	spin_unlock(&dev->stats_lock);
+
+	return ret;
+}
+static DEVICE_ATTR(latency_hist, S_IRUGO, latency_hist_show, NULL);
+
+static struct attribute *emmcsim_attrs[] = {
+	&dev_attr_read_lat_us.attr,
+	&dev_attr_prog_lat_us.attr,
+	&dev_attr_erase_lat_us.attr,
+	&dev_attr_erase_block_kb.attr,
+	&dev_attr_cache_kb.attr,
+	&dev_attr_flush_lat_us.attr,
+	&dev_attr_gc_interval.attr,
+	&dev_attr_gc_stall_us.attr,
+	&dev_attr_flash.attr,
+	&dev_attr_stats.attr,
+	&dev_attr_latency_hist.attr,
+	NULL,
+};
+
+static struct attribute_group emmcsim_attr_group = {
+	.name = "emmcsim",
+	.attrs = emmcsim_attrs,
+};
+
+static struct emmcsim_device *emmcsim_alloc(int i)
+{
+	struct emmcsim_device *dev;
+	struct gendisk *disk;
+
+	dev = kzalloc(sizeof(*dev), GFP_KERNEL);
+	if (!dev)
+		goto out;
+	dev->number = i;
+	spin_lock_init(&dev->pages_lock);
+	INIT_RADIX_TREE(&dev->pages, GFP_ATOMIC);
+	mutex_init(&dev->busy_lock);
+	spin_lock_init(&dev->stats_lock);
+	dev->params = default_params;
+	emmcsim_params_changed(dev);
+
+	dev->queue = blk_alloc_queue(GFP_KERNEL);
+	if (!dev->queue)
+		goto out_free_dev;
+	dev->queue->queuedata = dev;
+	blk_queue_make_request(dev->queue, emmcsim_make_request);
+	blk_queue_max_hw_sectors(dev->queue, 1024);
+	blk_queue_bounce_limit(dev->queue, BLK_BOUNCE_ANY);
+	blk_queue_physical_block_size(dev->queue, PAGE_SIZE);
+	blk_queue_io_min(dev->queue, PAGE_SIZE);
+	blk_queue_flush(dev->queue, REQ_FLUSH | REQ_FUA);
+
+	dev->queue->limits.discard_granularity = PAGE_SIZE;
+	dev->queue->limits.max_discard_sectors = UINT_MAX;
+	dev->queue->limits.discard_zeroes_data = 1;
+	queue_flag_set_unlocked(QUEUE_FLAG_DISCARD, dev->queue);
+	queue_flag_set_unlocked(QUEUE_FLAG_NONROT, dev->queue);
+
+	disk = dev->disk = alloc_disk(1);
+	if (!disk)
+		goto out_free_queue;
+	disk->major		= emmcsim_major;
+	disk->first_minor	= i;
+	disk->fops		= &emmcsim_fops;
+	disk->private_data	= dev;
+	disk->queue		= dev->queue;
+	sprintf(disk->disk_name, "emmcsim%d", i);
+	set_capacity(disk, (sector_t)disk_size_kb * 2);
+
+	return dev;
+
+out_free_queue:
+	blk_cleanup_queue(dev->queue);
+out_free_dev:
+	kfree(dev);
+out:
+	return NULL;
+}
+
+static void emmcsim_free(struct emmcsim_device *dev)
+{
+	put_disk(dev->disk);
+	blk_cleanup_queue(dev->queue);
+	emmcsim_free_pages(dev);
+	kfree(dev);
+}
+
+static void emmcsim_del_one(struct emmcsim_device *dev)
+{
+	list_del(&dev->list);
+	sysfs_remove_group(&disk_to_dev(dev->disk)->kobj,
+			   &emmcsim_attr_group);
+	del_gendisk(dev->disk);
+	emmcsim_free(dev);
+}
+
+static int __init emmcsim_init(void)
+{
+	struct emmcsim_device *dev, *next;
+	int i;
+
+	if (!nr_devices || nr_devices > 256)
+		return -EINVAL;
+
+	emmcsim_major = register_blkdev(0, "emmcsim");
+	if (emmcsim_major < 0)
+		return emmcsim_major;
+
+	for (i = 0; i < nr_devices; i++) {
+		dev = emmcsim_alloc(i);
+		if (!dev)
+			goto out_free;
+		list_add_tail(&dev->list, &emmcsim_devices);
+	}
+
+	/* point of no return */
+
+	list_for_each_entry(dev, &emmcsim_devices, list) {
+		add_disk(dev->disk);
+		if (sysfs_create_group(&disk_to_dev(dev->disk)->kobj,
+				       &emmcsim_attr_group))
+			pr_warning("emmcsim%d: error creating sysfs group\n",
+				   dev->number);
+	}
+
+	pr_info("emmcsim: %u device(s) of %u KB loaded\n",
+		nr_devices, disk_size_kb);
+	return 0;
+
+out_free:
+	list_for_each_entry_safe(dev, next, &emmcsim_devices, list) {
+		list_del(&dev->list);
+		emmcsim_free(dev);
+	}
+	unregister_blkdev(emmcsim_major, "emmcsim");
+
+	return -ENOMEM;
+}
+
+static void __exit emmcsim_exit(void)
+{
+	struct emmcsim_device *dev, *next;
+
+	list_for_each_entry_safe(dev, next, &emmcsim_devices, list)
+		emmcsim_del_one(dev);
+
+	unregister_blkdev(emmcsim_major, "emmcsim");
+}
+
+module_init(emmcsim_init);
+module_exit(emmcsim_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Emulated eMMC block device with configurable latency");
@@ -908,7 +908,8 @@ mmci_data_irq(struct mmci_host *host, struct mmc_data *data,
 			/* The error clause is handled above, success! */
 			data->bytes_xfered = data->blksz * data->blocks;
 
-		if (!data->stop) {
+		/* With SET_BLOCK_COUNT the card stops on its own */
+		if (!data->stop || (host->mrq->sbc && !data->error)) {
 			mmci_request_end(host, data->mrq);
 		} else {
 			/* Stop safety timer also before blk-rw stop */
@@ -944,6 +945,12 @@ mmci_cmd_irq(struct mmci_host *host, struct mmc_command *cmd,
 	if (host->plat->levelshifter && (host->cclk_desired > host->cclk))
 		mmci_set_clkreg(host, host->cclk_desired);
 
+	if (cmd == host->mrq->sbc && !cmd->error) {
+		/* SET_BLOCK_COUNT accepted, issue the data command */
+		mmci_start_command(host, host->mrq->cmd, 0);
+		return;
+	}
+
 	if (!cmd->data || cmd->error) {
 		/* Terminate the DMA transfer */
 		if (dma_inprogress(host)) {
@@ -952,7 +959,7 @@ mmci_cmd_irq(struct mmci_host *host, struct mmc_command *cmd,
 		}
 		if (host->data)
 			mmci_stop_data(host);
-		mmci_request_end(host, cmd->mrq);
+		mmci_request_end(host, host->mrq);
 	} else if (!(cmd->data->flags & MMC_DATA_READ)) {
 		mmci_setup_datactrl(host, cmd->data);
 		mmci_start_data(host, cmd->data);
@@ -1215,7 +1222,10 @@ static void mmci_request(struct mmc_host *mmc, struct mmc_request *mrq)
 		}
 	}
 
-	mmci_start_command(host, mrq->cmd, 0);
+	if (mrq->sbc)
+		mmci_start_command(host, mrq->sbc, 0);
+	else
+		mmci_start_command(host, mrq->cmd, 0);
 
 	if (mrq->data && dmaprep_after_cmd) {
 		mmci_dma_prep_data(host, mrq->data);
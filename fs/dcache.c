@@ -36,6 +36,9 @@
 #include <linux/bit_spinlock.h>
 #include <linux/rculist_bl.h>
 #include <linux/prefetch.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/workqueue.h>
 #include "internal.h"
 
 /*
@@ -79,6 +82,17 @@
 int sysctl_vfs_cache_pressure __read_mostly = 100;
 EXPORT_SYMBOL_GPL(sysctl_vfs_cache_pressure);
 
+/*
+ * Unused negative dentries are kept on their own per-sb LRU, so that
+ * repeated lookups of missing files stay cached without letting them push
+ * positive dentries out.  Once a superblock has more than this many, the
+ * excess is pruned in the background.  0 puts them on the normal LRU.
+ */
+int sysctl_dentry_neg_limit __read_mostly = 4096;
+
+static void prune_dcache_neg(struct work_struct *work);
+static DECLARE_WORK(dcache_neg_work, prune_dcache_neg);
+
 static __cacheline_aligned_in_smp DEFINE_SPINLOCK(dcache_lru_lock);
 __cacheline_aligned_in_smp DEFINE_SEQLOCK(rename_lock);
 
@@ -229,10 +243,20 @@ static void dentry_unlink_inode(struct dentry * dentry)
  */
 static void dentry_lru_add(struct dentry *dentry)
 {
+	struct super_block *sb = dentry->d_sb;
+	int limit = sysctl_dentry_neg_limit;
+
 	if (list_empty(&dentry->d_lru)) {
 		spin_lock(&dcache_lru_lock);
-		list_add(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
-		dentry->d_sb->s_nr_dentry_unused++;
+		if (!dentry->d_inode && limit) {
+			list_add(&dentry->d_lru, &sb->s_dentry_neg_lru);
+			dentry->d_flags |= DCACHE_NEG_LRU;
+			if (++sb->s_nr_dentry_neg > limit)
+				schedule_work(&dcache_neg_work);
+		} else {
+			list_add(&dentry->d_lru, &sb->s_dentry_lru);
+		}
+		sb->s_nr_dentry_unused++;
 		dentry_stat.nr_unused++;
 		spin_unlock(&dcache_lru_lock);
 	}
@@ -241,7 +265,9 @@ static void dentry_lru_add(struct dentry *dentry)
 static void __dentry_lru_del(struct dentry *dentry)
 {
 	list_del_init(&dentry->d_lru);
-	dentry->d_flags &= ~DCACHE_SHRINK_LIST;
+	if (dentry->d_flags & DCACHE_NEG_LRU)
+		dentry->d_sb->s_nr_dentry_neg--;
+	dentry->d_flags &= ~(DCACHE_SHRINK_LIST | DCACHE_NEG_LRU);
 	dentry->d_sb->s_nr_dentry_unused--;
 	dentry_stat.nr_unused--;
 }
@@ -264,6 +290,10 @@ static void dentry_lru_move_tail(struct dentry *dentry)
 		dentry_stat.nr_unused++;
 	} else {
 		list_move_tail(&dentry->d_lru, &dentry->d_sb->s_dentry_lru);
+		if (dentry->d_flags & DCACHE_NEG_LRU) {
+			dentry->d_flags &= ~DCACHE_NEG_LRU;
+			dentry->d_sb->s_nr_dentry_neg--;
+		}
 	}
 	spin_unlock(&dcache_lru_lock);
 }
@@ -714,16 +744,19 @@ static void shrink_dentry_list(struct list_head *list)
 }
 
 /**
- * __shrink_dcache_sb - shrink the dentry LRU on a given superblock
+ * __shrink_dcache_lru - shrink one of the dentry LRUs of a superblock
  * @sb:		superblock to shrink dentry LRU.
- * @count:	number of entries to prune
+ * @lru:	sb->s_dentry_lru or sb->s_dentry_neg_lru
+ * @count:	number of entries to prune, must not be 0
  * @flags:	flags to control the dentry processing
  *
  * If flags contains DCACHE_REFERENCED reference dentries will not be pruned.
+ * Dentries found on the negative LRU that have become positive since they
+ * were put there are moved to the normal LRU instead.
  */
-static void __shrink_dcache_sb(struct super_block *sb, int *count, int flags)
+static void __shrink_dcache_lru(struct super_block *sb, struct list_head *lru,
+				int *count, int flags)
 {
-	/* called from prune_dcache() and shrink_dcache_parent() */
 	struct dentry *dentry;
 	LIST_HEAD(referenced);
 	LIST_HEAD(tmp);
@@ -731,9 +764,8 @@ static void __shrink_dcache_sb(struct super_block *sb, int *count, int flags)
 
 relock:
 	spin_lock(&dcache_lru_lock);
-	while (!list_empty(&sb->s_dentry_lru)) {
-		dentry = list_entry(sb->s_dentry_lru.prev,
-				struct dentry, d_lru);
+	while (!list_empty(lru)) {
+		dentry = list_entry(lru->prev, struct dentry, d_lru);
 		BUG_ON(dentry->d_sb != sb);
 
 		if (!spin_trylock(&dentry->d_lock)) {
@@ -742,6 +774,14 @@ relock:
 			goto relock;
 		}
 
+		if ((dentry->d_flags & DCACHE_NEG_LRU) && dentry->d_inode) {
+			dentry->d_flags &= ~DCACHE_NEG_LRU;
+			sb->s_nr_dentry_neg--;
+			list_move(&dentry->d_lru, &sb->s_dentry_lru);
+			spin_unlock(&dentry->d_lock);
+			continue;
+		}
+
 		/*
 		 * If we are honouring the DCACHE_REFERENCED flag and the
 		 * dentry has this flag set, don't free it.  Clear the flag
@@ -762,7 +802,7 @@ relock:
 		cond_resched_lock(&dcache_lru_lock);
 	}
 	if (!list_empty(&referenced))
-		list_splice(&referenced, &sb->s_dentry_lru);
+		list_splice(&referenced, lru);
 	spin_unlock(&dcache_lru_lock);
 
 	shrink_dentry_list(&tmp);
@@ -770,6 +810,20 @@ relock:
 	*count = cnt;
 }
 
+/**
+ * __shrink_dcache_sb - shrink the dentry LRU on a given superblock
+ * @sb:		superblock to shrink dentry LRU.
+ * @count:	number of entries to prune
+ * @flags:	flags to control the dentry processing
+ *
+ * Only the LRU of positive dentries is shrunk, see __shrink_dcache_lru().
+ */
+static void __shrink_dcache_sb(struct super_block *sb, int *count, int flags)
+{
+	/* called from prune_dcache() and shrink_dcache_parent() */
+	__shrink_dcache_lru(sb, &sb->s_dentry_lru, count, flags);
+}
+
 /**
  * prune_dcache - shrink the dcache
  * @count: number of entries to try to free
@@ -782,7 +836,7 @@ relock:
 static void prune_dcache(int count)
 {
 	struct super_block *sb, *p = NULL;
-	int w_count;
+	int w_count, neg_count;
 	int unused = dentry_stat.nr_unused;
 	int prune_ratio;
 	int pruned;
@@ -810,11 +864,17 @@ static void prune_dcache(int count)
 		 * number of dentries in the machine)
 		 */
 		spin_unlock(&sb_lock);
-		if (prune_ratio != 1)
+		if (prune_ratio != 1) {
 			w_count = (sb->s_nr_dentry_unused / prune_ratio) + 1;
-		else
+			neg_count = sb->s_nr_dentry_neg / prune_ratio;
+		} else {
 			w_count = sb->s_nr_dentry_unused;
-		pruned = w_count;
+			neg_count = sb->s_nr_dentry_neg;
+		}
+		/* negative dentries get their share of the pressure */
+		neg_count = min(neg_count, w_count);
+		w_count -= neg_count;
+		pruned = w_count + neg_count;
 		/*
 		 * We need to be sure this filesystem isn't being unmounted,
 		 * otherwise we could race with generic_shutdown_super(), and
@@ -823,7 +883,13 @@ static void prune_dcache(int count)
 		 * s_root isn't NULL.
 		 */
 		if (down_read_trylock(&sb->s_umount)) {
-			if ((sb->s_root != NULL) &&
+			if ((sb->s_root != NULL) && neg_count &&
+			    (!list_empty(&sb->s_dentry_neg_lru))) {
+				__shrink_dcache_lru(sb, &sb->s_dentry_neg_lru,
+						&neg_count, DCACHE_REFERENCED);
+				pruned -= neg_count;
+			}
+			if ((sb->s_root != NULL) && w_count &&
 			    (!list_empty(&sb->s_dentry_lru))) {
 				__shrink_dcache_sb(sb, &w_count,
 						DCACHE_REFERENCED);
@@ -857,8 +923,10 @@ void shrink_dcache_sb(struct super_block *sb)
 	LIST_HEAD(tmp);
 
 	spin_lock(&dcache_lru_lock);
-	while (!list_empty(&sb->s_dentry_lru)) {
+	while (!list_empty(&sb->s_dentry_lru) ||
+	       !list_empty(&sb->s_dentry_neg_lru)) {
 		list_splice_init(&sb->s_dentry_lru, &tmp);
+		list_splice_init(&sb->s_dentry_neg_lru, &tmp);
 		spin_unlock(&dcache_lru_lock);
 		shrink_dentry_list(&tmp);
 		spin_lock(&dcache_lru_lock);
@@ -867,6 +935,31 @@ void shrink_dcache_sb(struct super_block *sb)
 }
 EXPORT_SYMBOL(shrink_dcache_sb);
 
+/*
+ * Trim the negative dentry LRU of a superblock that went over
+ * sysctl_dentry_neg_limit down to 7/8 of the limit, giving referenced
+ * dentries a second chance.
+ */
+static void prune_dcache_neg_sb(struct super_block *sb, void *unused)
+{
+	int limit = sysctl_dentry_neg_limit;
+	int count, left;
+
+	count = sb->s_nr_dentry_neg - (limit - limit / 8);
+	if (!limit || count <= 0)
+		return;
+
+	left = count;
+	__shrink_dcache_lru(sb, &sb->s_dentry_neg_lru, &left,
+			    DCACHE_REFERENCED);
+	this_cpu_add(sb->s_lookup_stats->neg_pruned, count - left);
+}
+
+static void prune_dcache_neg(struct work_struct *work)
+{
+	iterate_supers(prune_dcache_neg_sb, NULL);
+}
+
 /*
  * destroy a single subtree of dentries for unmount
  * - see the comments on shrink_dcache_for_umount() for a description of the
@@ -1261,6 +1354,73 @@ static struct shrinker dcache_shrinker = {
 	.seeks = DEFAULT_SEEKS,
 };
 
+#ifdef CONFIG_PROC_FS
+static const char * const lookup_fallback_names[NR_LOOKUP_FB] = {
+	[LOOKUP_FB_MISS]	= "miss",
+	[LOOKUP_FB_REVALIDATE]	= "revalidate",
+	[LOOKUP_FB_PERMISSION]	= "permission",
+	[LOOKUP_FB_SEQ]		= "seq",
+	[LOOKUP_FB_MOUNT]	= "mount",
+	[LOOKUP_FB_SYMLINK]	= "symlink",
+};
+
+static void lookup_stats_show_sb(struct super_block *sb, void *arg)
+{
+	struct seq_file *m = arg;
+	struct lookup_stats sum;
+	int cpu, i;
+
+	memset(&sum, 0, sizeof(sum));
+	for_each_possible_cpu(cpu) {
+		struct lookup_stats *st = per_cpu_ptr(sb->s_lookup_stats, cpu);
+
+		sum.rcu_walks += st->rcu_walks;
+		for (i = 0; i < NR_LOOKUP_FB; i++)
+			sum.fallback[i] += st->fallback[i];
+		sum.d_hits += st->d_hits;
+		sum.d_neg_hits += st->d_neg_hits;
+		sum.d_misses += st->d_misses;
+		sum.neg_pruned += st->neg_pruned;
+	}
+
+	seq_printf(m, "%s %s rcu_walks %lu", sb->s_id, sb->s_type->name,
+		   sum.rcu_walks);
+	for (i = 0; i < NR_LOOKUP_FB; i++)
+		seq_printf(m, " fb_%s %lu", lookup_fallback_names[i],
+			   sum.fallback[i]);
+	seq_printf(m, " d_hits %lu d_neg_hits %lu d_misses %lu"
+		   " unused %d neg_unused %d neg_pruned %lu\n",
+		   sum.d_hits, sum.d_neg_hits, sum.d_misses,
+		   sb->s_nr_dentry_unused, sb->s_nr_dentry_neg,
+		   sum.neg_pruned);
+}
+
+static int lookup_stats_show(struct seq_file *m, void *v)
+{
+	iterate_supers(lookup_stats_show_sb, m);
+	return 0;
+}
+
+static int lookup_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, lookup_stats_show, NULL);
+}
+
+static const struct file_operations lookup_stats_fops = {
+	.open		= lookup_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init lookup_stats_init(void)
+{
+	proc_create("fs/lookup_stats", 0, NULL, &lookup_stats_fops);
+	return 0;
+}
+module_init(lookup_stats_init);
+#endif /* CONFIG_PROC_FS */
+
 /**
  * d_alloc	-	allocate a dcache entry
  * @parent: parent of entry to allocate
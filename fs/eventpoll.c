@@ -136,7 +136,8 @@ struct epitem {
 
 	/*
 	 * Works together "struct eventpoll"->ovflist in keeping the
-	 * single linked chain of items.
+	 * single linked chain of items. EP_UNACTIVE_PTR when the item is
+	 * not staged.
 	 */
 	struct epitem *next;
 
@@ -189,12 +190,15 @@ struct eventpoll {
 	struct rb_root rbr;
 
 	/*
-	 * This is a single linked list that chains all the "struct epitem" that
-	 * happened while transferring ready events to userspace w/out
-	 * holding ->lock.
+	 * This is a single linked list that chains all the "struct epitem"
+	 * reported ready by ep_poll_callback(). Items are pushed on it without
+	 * holding ->lock and moved to ->rdllist by whoever holds ->mtx.
 	 */
 	struct epitem *ovflist;
 
+	/* Set while a waiter on ->wq has been woken for the staged events */
+	unsigned long wake_pending;
+
 	/* The user that created the eventpoll descriptor */
 	struct user_struct *user;
 
@@ -241,6 +245,9 @@ struct ep_send_events_data {
 /* Maximum number of epoll watched descriptors, per user */
 static long max_user_watches __read_mostly;
 
+/* Wake one epoll_wait() caller per batch of ready events, not per event */
+static int batch_wakeups __read_mostly = 1;
+
 /*
  * This mutex is used to serialize ep_free() and eventpoll_release_file().
  */
@@ -276,6 +283,8 @@ static LIST_HEAD(tfile_check_list);
 
 static long zero;
 static long long_max = LONG_MAX;
+static int int_zero;
+static int int_one = 1;
 
 ctl_table epoll_table[] = {
 	{
@@ -287,6 +296,15 @@ ctl_table epoll_table[] = {
 		.extra1		= &zero,
 		.extra2		= &long_max,
 	},
+	{
+		.procname	= "batch_wakeups",
+		.data		= &batch_wakeups,
+		.maxlen		= sizeof(batch_wakeups),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &int_zero,
+		.extra2		= &int_one,
+	},
 	{ }
 };
 #endif /* CONFIG_SYSCTL */
@@ -360,7 +378,35 @@ static void ep_nested_calls_init(struct nested_calls *ncalls)
  */
 static inline int ep_events_available(struct eventpoll *ep)
 {
-	return !list_empty(&ep->rdllist) || ep->ovflist != EP_UNACTIVE_PTR;
+	return !list_empty(&ep->rdllist) || ACCESS_ONCE(ep->ovflist) != NULL;
+}
+
+/*
+ * Moves the items staged by ep_poll_callback() to the ready list, in the
+ * order they were reported. Must be called with "mtx" and "lock" held.
+ */
+static void ep_drain_staged(struct eventpoll *ep)
+{
+	struct epitem *epi, *nepi, *head = NULL;
+
+	for (epi = xchg(&ep->ovflist, NULL); epi; epi = nepi) {
+		nepi = epi->next;
+		epi->next = head;
+		head = epi;
+	}
+
+	while ((epi = head) != NULL) {
+		/* The poll callback may stage the item again from here on */
+		head = epi->next;
+		epi->next = EP_UNACTIVE_PTR;
+
+		/*
+		 * The item may already be on the ready list, or on the "txlist"
+		 * of ep_scan_ready_list(), which re-injects it later.
+		 */
+		if (!ep_is_linked(&epi->rdllink))
+			list_add_tail(&epi->rdllink, &ep->rdllist);
+	}
 }
 
 /**
@@ -523,7 +569,6 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 {
 	int error, pwake = 0;
 	unsigned long flags;
-	struct epitem *epi, *nepi;
 	LIST_HEAD(txlist);
 
 	/*
@@ -534,15 +579,14 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 
 	/*
 	 * Steal the ready list, and re-init the original one to the
-	 * empty list. Also, set ep->ovflist to NULL so that events
-	 * happening while looping w/out locks, are not lost. We cannot
-	 * have the poll callback to queue directly on ep->rdllist,
-	 * because we want the "sproc" callback to be able to do it
-	 * in a lockless way.
+	 * empty list. The poll callback never queues directly on
+	 * ep->rdllist but stages items on ep->ovflist, so the "sproc"
+	 * callback is able to requeue items in a lockless way and
+	 * events happening while looping w/out locks are not lost.
 	 */
 	spin_lock_irqsave(&ep->lock, flags);
+	ep_drain_staged(ep);
 	list_splice_init(&ep->rdllist, &txlist);
-	ep->ovflist = NULL;
 	spin_unlock_irqrestore(&ep->lock, flags);
 
 	/*
@@ -553,26 +597,10 @@ static int ep_scan_ready_list(struct eventpoll *ep,
 	spin_lock_irqsave(&ep->lock, flags);
 	/*
 	 * During the time we spent inside the "sproc" callback, some
-	 * other events might have been queued by the poll callback.
+	 * other events might have been staged by the poll callback.
 	 * We re-insert them inside the main ready-list here.
 	 */
-	for (nepi = ep->ovflist; (epi = nepi) != NULL;
-	     nepi = epi->next, epi->next = EP_UNACTIVE_PTR) {
-		/*
-		 * We need to check if the item is already in the list.
-		 * During the "sproc" callback execution time, items are
-		 * queued into ->ovflist but the "txlist" might already
-		 * contain them, and the list_splice() below takes care of them.
-		 */
-		if (!ep_is_linked(&epi->rdllink))
-			list_add_tail(&epi->rdllink, &ep->rdllist);
-	}
-	/*
-	 * We need to set back ep->ovflist to EP_UNACTIVE_PTR, so that after
-	 * releasing the lock, events will be queued in the normal way inside
-	 * ep->rdllist.
-	 */
-	ep->ovflist = EP_UNACTIVE_PTR;
+	ep_drain_staged(ep);
 
 	/*
 	 * Quickly re-inject items left on "txlist".
@@ -627,7 +655,13 @@ static int ep_remove(struct eventpoll *ep, struct epitem *epi)
 
 	rb_erase(&epi->rbn, &ep->rbr);
 
+	/*
+	 * No poll callback can stage the item anymore, but a previous one
+	 * may have left it on ep->ovflist.
+	 */
 	spin_lock_irqsave(&ep->lock, flags);
+	if (epi->next != EP_UNACTIVE_PTR)
+		ep_drain_staged(ep);
 	if (ep_is_linked(&epi->rdllink))
 		list_del_init(&epi->rdllink);
 	spin_unlock_irqrestore(&ep->lock, flags);
@@ -806,7 +840,7 @@ static int ep_alloc(struct eventpoll **pep)
 	init_waitqueue_head(&ep->poll_wait);
 	INIT_LIST_HEAD(&ep->rdllist);
 	ep->rbr = RB_ROOT;
-	ep->ovflist = EP_UNACTIVE_PTR;
+	ep->ovflist = NULL;
 	ep->user = user;
 
 	*pep = ep;
@@ -854,10 +888,10 @@ static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
  */
 static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *key)
 {
-	int pwake = 0;
 	unsigned long flags;
 	struct epitem *epi = ep_item_from_wait(wait);
 	struct eventpoll *ep = epi->ep;
+	struct epitem *head;
 
 	if ((unsigned long)key & POLLFREE) {
 		ep_pwq_from_wait(wait)->whead = NULL;
@@ -870,8 +904,6 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 		list_del_init(&wait->task_list);
 	}
 
-	spin_lock_irqsave(&ep->lock, flags);
-
 	/*
 	 * If the event mask does not contain any poll(2) event, we consider the
 	 * descriptor to be disabled. This condition is likely the effect of the
@@ -879,7 +911,7 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * until the next EPOLL_CTL_MOD will be issued.
 	 */
 	if (!(epi->event.events & ~EP_PRIVATE_BITS))
-		goto out_unlock;
+		return 1;
 
 	/*
 	 * Check the events coming with the callback. At this stage, not
@@ -888,40 +920,40 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * test for "key" != NULL before the event match test.
 	 */
 	if (key && !((unsigned long) key & epi->event.events))
-		goto out_unlock;
+		return 1;
 
 	/*
-	 * If we are transferring events to userspace, we can hold no locks
-	 * (because we're accessing user memory, and because of linux f_op->poll()
-	 * semantics). All the events that happen during that period of time are
-	 * chained in ep->ovflist and requeued later on.
+	 * Many files may report events at once, so the item is staged on
+	 * ep->ovflist without taking ep->lock. Whoever next holds ep->mtx
+	 * moves it to the ready list. Claiming ->next first makes sure the
+	 * item is staged only once.
 	 */
-	if (unlikely(ep->ovflist != EP_UNACTIVE_PTR)) {
-		if (epi->next == EP_UNACTIVE_PTR) {
-			epi->next = ep->ovflist;
-			ep->ovflist = epi;
-		}
-		goto out_unlock;
-	}
-
-	/* If this file is already in the ready list we exit soon */
-	if (!ep_is_linked(&epi->rdllink))
-		list_add_tail(&epi->rdllink, &ep->rdllist);
+	if (cmpxchg(&epi->next, EP_UNACTIVE_PTR, NULL) == EP_UNACTIVE_PTR) {
+		do {
+			head = ACCESS_ONCE(ep->ovflist);
+			epi->next = head;
+		} while (cmpxchg(&ep->ovflist, head, epi) != head);
+	} else
+		smp_mb();
 
 	/*
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
-	 * wait list.
+	 * wait list. With batch_wakeups, one waiter is woken for all the events
+	 * staged until it gets around to look at them.
 	 */
-	if (waitqueue_active(&ep->wq))
-		wake_up_locked(&ep->wq);
-	if (waitqueue_active(&ep->poll_wait))
-		pwake++;
-
-out_unlock:
-	spin_unlock_irqrestore(&ep->lock, flags);
+	if (waitqueue_active(&ep->wq) &&
+	    (!batch_wakeups || (!test_bit(0, &ep->wake_pending) &&
+				!test_and_set_bit(0, &ep->wake_pending)))) {
+		spin_lock_irqsave(&ep->lock, flags);
+		if (waitqueue_active(&ep->wq))
+			wake_up_locked(&ep->wq);
+		else
+			clear_bit(0, &ep->wake_pending);
+		spin_unlock_irqrestore(&ep->lock, flags);
+	}
 
 	/* We have to call this outside the lock */
-	if (pwake)
+	if (waitqueue_active(&ep->poll_wait))
 		ep_poll_safewake(&ep->poll_wait);
 
 	return 1;
@@ -1169,11 +1201,12 @@ error_unregister:
 
 	/*
 	 * We need to do this because an event could have been arrived on some
-	 * allocated wait queue. Note that we don't care about the ep->ovflist
-	 * list, since that is used/cleaned only inside a section bound by "mtx".
-	 * And ep_insert() is called with "mtx" held.
+	 * allocated wait queue, and the poll callback staged the item on
+	 * ep->ovflist. ep_insert() is called with "mtx" held.
 	 */
 	spin_lock_irqsave(&ep->lock, flags);
+	if (epi->next != EP_UNACTIVE_PTR)
+		ep_drain_staged(ep);
 	if (ep_is_linked(&epi->rdllink))
 		list_del_init(&epi->rdllink);
 	spin_unlock_irqrestore(&ep->lock, flags);
@@ -1207,8 +1240,8 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	 *    we do not miss events from ep_poll_callback if an
 	 *    event occurs immediately after we call f_op->poll().
 	 *    We need this because we did not take ep->lock while
-	 *    changing epi above (but ep_poll_callback does take
-	 *    ep->lock).
+	 *    changing epi above, and ep_poll_callback reads it
+	 *    without any lock either.
 	 *
 	 * 2) We also need to ensure we do not miss _past_ events
 	 *    when calling f_op->poll().  This barrier also
@@ -1300,7 +1333,7 @@ static int ep_send_events_proc(struct eventpoll *ep, struct list_head *head,
 				 * into ep->rdllist besides us. The epoll_ctl()
 				 * callers are locked out by
 				 * ep_scan_ready_list() holding "mtx" and the
-				 * poll callback will queue them in ep->ovflist.
+				 * poll callback only stages them in ep->ovflist.
 				 */
 				list_add_tail(&epi->rdllink, &ep->rdllist);
 			}
@@ -1387,6 +1420,13 @@ fetch_events:
 		__add_wait_queue_exclusive(&ep->wq, &wait);
 
 		for (;;) {
+			/*
+			 * Whatever woke us, we are about to look at the ready
+			 * events, so ep_poll_callback() has to wake a waiter
+			 * again for anything staged after this point.
+			 */
+			clear_bit(0, &ep->wake_pending);
+
 			/*
 			 * We don't want to sleep if the ep_poll_callback() sends us
 			 * a wakeup in between. That's why we set the task state
@@ -867,6 +867,13 @@ struct ext4_inode_info {
 	 */
 	tid_t i_sync_tid;
 	tid_t i_datasync_tid;
+
+	/* Last mmap extent readahead window, see ext4_extent_readahead() */
+	spinlock_t i_ra_lock;
+	pgoff_t i_ra_start;
+	unsigned int i_ra_len;
+	unsigned int i_ra_pages;
+	unsigned int i_ra_hits;
 };
 
 /*
@@ -1157,6 +1164,14 @@ struct ext4_sb_info {
 	unsigned long extent_cache_hits;
 	unsigned long extent_cache_misses;
 
+	/* mmap extent readahead */
+	unsigned int s_extent_ra_kb;
+	unsigned long s_extent_ra_windows;
+	unsigned long s_extent_ra_pages;
+	unsigned long s_extent_ra_useful;
+	unsigned long s_extent_ra_wasted;
+	unsigned long s_extent_ra_throttled;
+
 	/* for buddy allocator */
 	struct ext4_group_info ***s_group_info;
 	struct inode *s_buddy_cache;
@@ -2135,6 +2150,7 @@ extern const struct file_operations ext4_dir_operations;
 extern const struct inode_operations ext4_file_inode_operations;
 extern const struct file_operations ext4_file_operations;
 extern loff_t ext4_llseek(struct file *file, loff_t offset, int origin);
+extern void ext4_extent_ra_release(struct inode *inode);
 
 /* namei.c */
 extern const struct inode_operations ext4_dir_inode_operations;
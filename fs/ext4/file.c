@@ -23,6 +23,7 @@
 #include <linux/jbd2.h>
 #include <linux/mount.h>
 #include <linux/path.h>
+#include <linux/backing-dev.h>
 #include <linux/quotaops.h>
 #include "ext4.h"
 #include "ext4_jbd2.h"
@@ -141,8 +142,118 @@ ext4_file_write(struct kiocb *iocb, const struct iovec *iov,
 	return ret;
 }
 
+/*
+ * mmap faults on large files read in scattered order (executables,
+ * libraries, application packages) defeat the generic readahead window.
+ * When extent_ra_kb is set, a fault on an uncached page of an extent
+ * mapped file reads the extent_ra_kb aligned chunk around it, stopping
+ * at the end of the extent that holds the faulting block since the next
+ * extent is unlikely to hold related data.  Delayed allocation blocks are
+ * cached already and holes need no I/O, so only a fault on a mapped block
+ * starts a window.  Nothing is read while the device is read congested.
+ *
+ * A later fault that finds its page cached inside the inode's last window
+ * counts as useful readahead, and the window's pages that were never
+ * faulted on count as wasted once it is replaced or the inode is evicted.
+ */
+static void ext4_extent_ra_retire(struct ext4_sb_info *sbi,
+				  struct ext4_inode_info *ei)
+{
+	if (ei->i_ra_pages > ei->i_ra_hits)
+		sbi->s_extent_ra_wasted += ei->i_ra_pages - ei->i_ra_hits;
+	ei->i_ra_len = 0;
+	ei->i_ra_pages = 0;
+	ei->i_ra_hits = 0;
+}
+
+void ext4_extent_ra_release(struct inode *inode)
+{
+	struct ext4_inode_info *ei = EXT4_I(inode);
+
+	spin_lock(&ei->i_ra_lock);
+	ext4_extent_ra_retire(EXT4_SB(inode->i_sb), ei);
+	spin_unlock(&ei->i_ra_lock);
+}
+
+static void ext4_extent_readahead(struct file *file, pgoff_t index)
+{
+	struct address_space *mapping = file->f_mapping;
+	struct inode *inode = mapping->host;
+	struct ext4_inode_info *ei = EXT4_I(inode);
+	struct ext4_sb_info *sbi = EXT4_SB(inode->i_sb);
+	int shift = PAGE_CACHE_SHIFT - inode->i_blkbits;
+	unsigned long chunk = sbi->s_extent_ra_kb >> (PAGE_CACHE_SHIFT - 10);
+	struct ext4_map_blocks map;
+	struct page *page;
+	pgoff_t start, end, last;
+	int ret;
+
+	page = find_get_page(mapping, index);
+	if (page) {
+		page_cache_release(page);
+		spin_lock(&ei->i_ra_lock);
+		if (index - ei->i_ra_start < ei->i_ra_len &&
+		    ei->i_ra_hits < ei->i_ra_pages) {
+			ei->i_ra_hits++;
+			sbi->s_extent_ra_useful++;
+		}
+		spin_unlock(&ei->i_ra_lock);
+		return;
+	}
+
+	if (chunk < 2 || !ext4_test_inode_flag(inode, EXT4_INODE_EXTENTS))
+		return;
+
+	if (bdi_read_congested(mapping->backing_dev_info)) {
+		sbi->s_extent_ra_throttled++;
+		return;
+	}
+
+	start = index - index % chunk;
+	end = start + chunk;
+	last = (i_size_read(inode) + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
+	if (end > last)
+		end = last;
+	if (index >= end)
+		return;
+
+	map.m_lblk = (ext4_lblk_t) index << shift;
+	map.m_len = (unsigned int) (end - index) << shift;
+	ret = ext4_map_blocks(NULL, inode, &map, 0);
+	if (ret <= 0)
+		return;
+	end = index + ((ret + (1 << shift) - 1) >> shift);
+	if (end - start < 2)
+		return;
+
+	ret = force_page_cache_readahead(mapping, file, start, end - start);
+	if (ret <= 0)
+		return;
+
+	/* The faulting page itself is demand read, not readahead */
+	spin_lock(&ei->i_ra_lock);
+	ext4_extent_ra_retire(sbi, ei);
+	ei->i_ra_start = start;
+	ei->i_ra_len = end - start;
+	ei->i_ra_pages = ret - 1;
+	sbi->s_extent_ra_windows++;
+	sbi->s_extent_ra_pages += ret - 1;
+	spin_unlock(&ei->i_ra_lock);
+}
+
+static int ext4_filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
+{
+	struct inode *inode = vma->vm_file->f_mapping->host;
+
+	if (EXT4_SB(inode->i_sb)->s_extent_ra_kb &&
+	    !(vma->vm_flags & VM_RAND_READ))
+		ext4_extent_readahead(vma->vm_file, vmf->pgoff);
+
+	return filemap_fault(vma, vmf);
+}
+
 static const struct vm_operations_struct ext4_file_vm_ops = {
-	.fault		= filemap_fault,
+	.fault		= ext4_filemap_fault,
 	.page_mkwrite   = ext4_page_mkwrite,
 };
 
@@ -873,6 +873,11 @@ static struct inode *ext4_alloc_inode(struct super_block *sb)
 	ei->i_datasync_tid = 0;
 	atomic_set(&ei->i_ioend_count, 0);
 	atomic_set(&ei->i_aiodio_unwritten, 0);
+	spin_lock_init(&ei->i_ra_lock);
+	ei->i_ra_start = 0;
+	ei->i_ra_len = 0;
+	ei->i_ra_pages = 0;
+	ei->i_ra_hits = 0;
 
 	return &ei->vfs_inode;
 }
@@ -941,6 +946,7 @@ void ext4_clear_inode(struct inode *inode)
 	end_writeback(inode);
 	dquot_drop(inode);
 	ext4_discard_preallocations(inode);
+	ext4_extent_ra_release(inode);
 	if (EXT4_I(inode)->jinode) {
 		jbd2_journal_release_jbd_inode(EXT4_JOURNAL(inode),
 					       EXT4_I(inode)->jinode);
@@ -2489,6 +2495,14 @@ static ssize_t sbi_ui_show(struct ext4_attr *a,
 	return snprintf(buf, PAGE_SIZE, "%u\n", *ui);
 }
 
+static ssize_t sbi_ul_show(struct ext4_attr *a,
+			   struct ext4_sb_info *sbi, char *buf)
+{
+	unsigned long *ul = (unsigned long *) (((char *) sbi) + a->offset);
+
+	return snprintf(buf, PAGE_SIZE, "%lu\n", *ul);
+}
+
 static ssize_t sbi_ui_store(struct ext4_attr *a,
 			    struct ext4_sb_info *sbi,
 			    const char *buf, size_t count)
@@ -2517,6 +2531,8 @@ static struct ext4_attr ext4_attr_##name = __ATTR(name, mode, show, store)
 #define EXT4_RW_ATTR(name) EXT4_ATTR(name, 0644, name##_show, name##_store)
 #define EXT4_RW_ATTR_SBI_UI(name, elname)	\
 	EXT4_ATTR_OFFSET(name, 0644, sbi_ui_show, sbi_ui_store, elname)
+#define EXT4_RO_ATTR_SBI_UL(name, elname)	\
+	EXT4_ATTR_OFFSET(name, 0444, sbi_ul_show, NULL, elname)
 #define ATTR_LIST(name) &ext4_attr_##name.attr
 
 EXT4_RO_ATTR(delayed_allocation_blocks);
@@ -2534,6 +2550,12 @@ EXT4_RW_ATTR_SBI_UI(mb_order2_req, s_mb_order2_reqs);
 EXT4_RW_ATTR_SBI_UI(mb_stream_req, s_mb_stream_request);
 EXT4_RW_ATTR_SBI_UI(mb_group_prealloc, s_mb_group_prealloc);
 EXT4_RW_ATTR_SBI_UI(max_writeback_mb_bump, s_max_writeback_mb_bump);
+EXT4_RW_ATTR_SBI_UI(extent_ra_kb, s_extent_ra_kb);
+EXT4_RO_ATTR_SBI_UL(extent_ra_windows, s_extent_ra_windows);
+EXT4_RO_ATTR_SBI_UL(extent_ra_pages, s_extent_ra_pages);
+EXT4_RO_ATTR_SBI_UL(extent_ra_useful, s_extent_ra_useful);
+EXT4_RO_ATTR_SBI_UL(extent_ra_wasted, s_extent_ra_wasted);
+EXT4_RO_ATTR_SBI_UL(extent_ra_throttled, s_extent_ra_throttled);
 
 static struct attribute *ext4_attrs[] = {
 	ATTR_LIST(delayed_allocation_blocks),
@@ -2550,6 +2572,12 @@ static struct attribute *ext4_attrs[] = {
 	ATTR_LIST(mb_stream_req),
 	ATTR_LIST(mb_group_prealloc),
 	ATTR_LIST(max_writeback_mb_bump),
+	ATTR_LIST(extent_ra_kb),
+	ATTR_LIST(extent_ra_windows),
+	ATTR_LIST(extent_ra_pages),
+	ATTR_LIST(extent_ra_useful),
+	ATTR_LIST(extent_ra_wasted),
+	ATTR_LIST(extent_ra_throttled),
 	NULL,
 };
 
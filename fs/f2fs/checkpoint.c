@@ -40,7 +40,7 @@ repeat:
 	}
 
 	/* We wait writeback only inside grab_meta_page() */
-	wait_on_page_writeback(page);
+	f2fs_wait_on_page_writeback(page, META);
 	SetPageUptodate(page);
 	return page;
 }
@@ -74,6 +74,38 @@ out:
 	return page;
 }
 
+/*
+ * Readahead consecutive meta pages, such as the summary blocks of a victim
+ * section, so that the following get_meta_page() calls do not wait for
+ * each block in turn.
+ */
+void ra_meta_pages(struct f2fs_sb_info *sbi, pgoff_t start, int nrpages)
+{
+	struct address_space *mapping = sbi->meta_inode->i_mapping;
+	struct page *page;
+	pgoff_t index;
+
+	for (index = start; index < start + nrpages; index++) {
+		page = find_get_page(mapping, index);
+		if (page && PageUptodate(page)) {
+			f2fs_put_page(page, 0);
+			continue;
+		}
+		f2fs_put_page(page, 0);
+
+		page = grab_cache_page(mapping, index);
+		if (!page)
+			return;
+		if (PageUptodate(page)) {
+			f2fs_put_page(page, 1);
+			continue;
+		}
+		if (f2fs_readpage(sbi, page, index, READA))
+			return;
+		f2fs_put_page(page, 0);
+	}
+}
+
 static int f2fs_write_meta_page(struct page *page,
 				struct writeback_control *wbc)
 {
@@ -89,7 +121,7 @@ static int f2fs_write_meta_page(struct page *page,
 		return AOP_WRITEPAGE_ACTIVATE;
 	}
 
-	wait_on_page_writeback(page);
+	f2fs_wait_on_page_writeback(page, META);
 
 	write_meta_page(sbi, page);
 	dec_page_count(sbi, F2FS_DIRTY_META);
@@ -750,6 +782,9 @@ static void do_checkpoint(struct f2fs_sb_info *sbi, bool is_umount)
 	f2fs_put_page(cp_page, 1);
 
 	/* wait for previous submitted node/meta pages writeback */
+	f2fs_submit_bio(sbi, DATA, true);
+	f2fs_submit_bio(sbi, NODE, true);
+	f2fs_submit_bio(sbi, META, true);
 	while (get_pages(sbi, F2FS_WRITEBACK))
 		congestion_wait(BLK_RW_ASYNC, HZ / 50);
 
@@ -24,6 +24,8 @@
 #include "segment.h"
 #include <trace/events/f2fs.h>
 
+static struct kmem_cache *extent_node_slab;
+
 /*
  * Lock ordering for the change of data block address:
  * ->data_page
@@ -37,7 +39,7 @@ static void __set_data_blkaddr(struct dnode_of_data *dn, block_t new_addr)
 	struct page *node_page = dn->node_page;
 	unsigned int ofs_in_node = dn->ofs_in_node;
 
-	wait_on_page_writeback(node_page);
+	f2fs_wait_on_page_writeback(node_page, NODE);
 
 	rn = (struct f2fs_node *)page_address(node_page);
 
@@ -64,6 +66,182 @@ int reserve_new_block(struct dnode_of_data *dn)
 	return 0;
 }
 
+static struct extent_node *__lookup_extent_tree(struct f2fs_inode_info *fi,
+							pgoff_t fofs)
+{
+	struct rb_node *node = fi->ext_tree.rb_node;
+	struct extent_node *en;
+
+	while (node) {
+		en = rb_entry(node, struct extent_node, rb_node);
+		if (fofs < en->fofs)
+			node = node->rb_left;
+		else if (fofs >= en->fofs + en->len)
+			node = node->rb_right;
+		else
+			return en;
+	}
+	return NULL;
+}
+
+static void __detach_extent_node(struct f2fs_inode_info *fi,
+					struct extent_node *en)
+{
+	rb_erase(&en->rb_node, &fi->ext_tree);
+	fi->ext_count--;
+	kmem_cache_free(extent_node_slab, en);
+}
+
+static void __link_extent_node(struct f2fs_inode_info *fi,
+					struct extent_node *new)
+{
+	struct rb_node **p = &fi->ext_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct extent_node *en;
+
+	while (*p) {
+		parent = *p;
+		en = rb_entry(parent, struct extent_node, rb_node);
+		if (new->fofs < en->fofs)
+			p = &(*p)->rb_left;
+		else
+			p = &(*p)->rb_right;
+	}
+	rb_link_node(&new->rb_node, parent, p);
+	rb_insert_color(&new->rb_node, &fi->ext_tree);
+	fi->ext_count++;
+}
+
+static struct extent_node *__shortest_extent_node(struct f2fs_inode_info *fi)
+{
+	struct extent_node *en, *victim = NULL;
+	struct rb_node *node;
+
+	for (node = rb_first(&fi->ext_tree); node; node = rb_next(node)) {
+		en = rb_entry(node, struct extent_node, rb_node);
+		if (!victim || en->len < victim->len)
+			victim = en;
+	}
+	return victim;
+}
+
+/*
+ * Cache the mapping of [fofs, fofs + len) which starts at blk_addr.
+ * The tree always reflects the current block addresses, so a new mapping
+ * only has to be clipped against its successor and merged with adjacent
+ * nodes when both file offsets and block addresses are contiguous.
+ */
+static void __insert_extent_tree(struct f2fs_inode_info *fi, pgoff_t fofs,
+					block_t blk_addr, unsigned int len)
+{
+	struct rb_node **p, *parent;
+	struct extent_node *en, *prev, *next;
+
+retry:
+	p = &fi->ext_tree.rb_node;
+	parent = NULL;
+	prev = next = NULL;
+
+	while (*p) {
+		parent = *p;
+		en = rb_entry(parent, struct extent_node, rb_node);
+		if (fofs < en->fofs) {
+			next = en;
+			p = &(*p)->rb_left;
+		} else if (fofs >= en->fofs + en->len) {
+			prev = en;
+			p = &(*p)->rb_right;
+		} else {
+			/* already cached */
+			return;
+		}
+	}
+
+	if (next && fofs + len > next->fofs)
+		len = next->fofs - fofs;
+
+	/* Back merge into the previous extent */
+	if (prev && prev->fofs + prev->len == fofs &&
+			prev->blk_addr + prev->len == blk_addr) {
+		prev->len += len;
+		if (next && prev->fofs + prev->len == next->fofs &&
+				prev->blk_addr + prev->len == next->blk_addr) {
+			prev->len += next->len;
+			__detach_extent_node(fi, next);
+		}
+		return;
+	}
+
+	/* Front merge into the next extent */
+	if (next && fofs + len == next->fofs &&
+			blk_addr + len == next->blk_addr) {
+		next->fofs = fofs;
+		next->blk_addr = blk_addr;
+		next->len += len;
+		return;
+	}
+
+	if (fi->ext_count >= F2FS_MAX_EXTENT_NODES) {
+		en = __shortest_extent_node(fi);
+		if (en->len >= len)
+			return;
+		__detach_extent_node(fi, en);
+		goto retry;
+	}
+
+	en = kmem_cache_alloc(extent_node_slab, GFP_ATOMIC);
+	if (!en)
+		return;
+	en->fofs = fofs;
+	en->blk_addr = blk_addr;
+	en->len = len;
+	rb_link_node(&en->rb_node, parent, p);
+	rb_insert_color(&en->rb_node, &fi->ext_tree);
+	fi->ext_count++;
+}
+
+/*
+ * Forget the cached mapping of a single block whose address is changing.
+ */
+static void __drop_extent_tree(struct f2fs_inode_info *fi, pgoff_t fofs)
+{
+	struct extent_node *en, *back;
+	unsigned int end_fofs;
+
+	en = __lookup_extent_tree(fi, fofs);
+	if (!en)
+		return;
+
+	if (en->len == 1) {
+		__detach_extent_node(fi, en);
+		return;
+	}
+
+	end_fofs = en->fofs + en->len - 1;
+	if (fofs == en->fofs) {
+		en->fofs++;
+		en->blk_addr++;
+		en->len--;
+		return;
+	}
+	if (fofs == end_fofs) {
+		en->len--;
+		return;
+	}
+
+	/* Split the extent, or keep only its front part on failure */
+	en->len = fofs - en->fofs;
+	if (fi->ext_count >= F2FS_MAX_EXTENT_NODES)
+		return;
+	back = kmem_cache_alloc(extent_node_slab, GFP_ATOMIC);
+	if (!back)
+		return;
+	back->fofs = fofs + 1;
+	back->blk_addr = en->blk_addr + en->len + 1;
+	back->len = end_fofs - fofs;
+	__link_extent_node(fi, back);
+}
+
 static int check_extent_cache(struct inode *inode, pgoff_t pgofs,
 					struct buffer_head *bh_result)
 {
@@ -71,11 +249,14 @@ static int check_extent_cache(struct inode *inode, pgoff_t pgofs,
 #ifdef CONFIG_F2FS_STAT_FS
 	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
 #endif
+	struct extent_node *en;
 	pgoff_t start_fofs, end_fofs;
 	block_t start_blkaddr;
+	unsigned int blkbits;
+	size_t count;
 
 	read_lock(&fi->ext.ext_lock);
-	if (fi->ext.len == 0) {
+	if (fi->ext.len == 0 && !fi->ext_count) {
 		read_unlock(&fi->ext.ext_lock);
 		return 0;
 	}
@@ -87,27 +268,36 @@ static int check_extent_cache(struct inode *inode, pgoff_t pgofs,
 	end_fofs = fi->ext.fofs + fi->ext.len - 1;
 	start_blkaddr = fi->ext.blk_addr;
 
-	if (pgofs >= start_fofs && pgofs <= end_fofs) {
-		unsigned int blkbits = inode->i_sb->s_blocksize_bits;
-		size_t count;
-
-		clear_buffer_new(bh_result);
-		map_bh(bh_result, inode->i_sb,
-				start_blkaddr + pgofs - start_fofs);
-		count = end_fofs - pgofs + 1;
-		if (count < (UINT_MAX >> blkbits))
-			bh_result->b_size = (count << blkbits);
-		else
-			bh_result->b_size = UINT_MAX;
-
+	if (fi->ext.len && pgofs >= start_fofs && pgofs <= end_fofs) {
 #ifdef CONFIG_F2FS_STAT_FS
 		sbi->read_hit_ext++;
 #endif
+		goto found;
+	}
+
+	en = __lookup_extent_tree(fi, pgofs);
+	if (!en) {
 		read_unlock(&fi->ext.ext_lock);
-		return 1;
+		return 0;
 	}
+	start_fofs = en->fofs;
+	end_fofs = en->fofs + en->len - 1;
+	start_blkaddr = en->blk_addr;
+#ifdef CONFIG_F2FS_STAT_FS
+	sbi->read_hit_rbtree++;
+#endif
+found:
+	blkbits = inode->i_sb->s_blocksize_bits;
+	clear_buffer_new(bh_result);
+	map_bh(bh_result, inode->i_sb, start_blkaddr + pgofs - start_fofs);
+	count = end_fofs - pgofs + 1;
+	if (count < (UINT_MAX >> blkbits))
+		bh_result->b_size = (count << blkbits);
+	else
+		bh_result->b_size = UINT_MAX;
+
 	read_unlock(&fi->ext.ext_lock);
-	return 0;
+	return 1;
 }
 
 void update_extent_cache(block_t blk_addr, struct dnode_of_data *dn)
@@ -124,6 +314,10 @@ void update_extent_cache(block_t blk_addr, struct dnode_of_data *dn)
 
 	write_lock(&fi->ext.ext_lock);
 
+	__drop_extent_tree(fi, fofs);
+	if (blk_addr != NULL_ADDR)
+		__insert_extent_tree(fi, fofs, blk_addr, 1);
+
 	start_fofs = fi->ext.fofs;
 	end_fofs = fi->ext.fofs + fi->ext.len - 1;
 	start_blkaddr = fi->ext.blk_addr;
@@ -179,6 +373,18 @@ end_update:
 	return;
 }
 
+void f2fs_destroy_extent_tree(struct inode *inode)
+{
+	struct f2fs_inode_info *fi = F2FS_I(inode);
+	struct rb_node *node;
+
+	write_lock(&fi->ext.ext_lock);
+	while ((node = rb_first(&fi->ext_tree)))
+		__detach_extent_node(fi,
+				rb_entry(node, struct extent_node, rb_node));
+	write_unlock(&fi->ext.ext_lock);
+}
+
 struct page *find_data_page(struct inode *inode, pgoff_t index, bool sync)
 {
 	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
@@ -449,12 +655,18 @@ static int get_data_block_ro(struct inode *inode, sector_t iblock,
 
 		/* Give more consecutive addresses for the read ahead */
 		for (i = 0; i < end_offset - dn.ofs_in_node; i++)
-			if (((datablock_addr(dn.node_page,
+			if ((datablock_addr(dn.node_page,
 							dn.ofs_in_node + i))
-				!= (dn.data_blkaddr + i)) || maxblocks == i)
+				!= (dn.data_blkaddr + i))
 				break;
+
+		/* Remember the whole run, while the node page is locked */
+		write_lock(&F2FS_I(inode)->ext.ext_lock);
+		__insert_extent_tree(F2FS_I(inode), pgofs, dn.data_blkaddr, i);
+		write_unlock(&F2FS_I(inode)->ext.ext_lock);
+
 		map_bh(bh_result, inode->i_sb, dn.data_blkaddr);
-		bh_result->b_size = (i << blkbits);
+		bh_result->b_size = (min_t(unsigned, i, maxblocks) << blkbits);
 	}
 	f2fs_put_dnode(&dn);
 	trace_f2fs_get_data_block(inode, iblock, bh_result, 0);
@@ -494,18 +706,21 @@ int do_write_data_page(struct page *page)
 	set_page_writeback(page);
 
 	/*
-	 * If current allocation needs SSR,
+	 * If current allocation needs SSR or the file is fsynced frequently,
 	 * it had better in-place writes for updated data.
 	 */
-	if (unlikely(old_blk_addr != NEW_ADDR &&
-			!is_cold_data(page) &&
-			need_inplace_update(inode))) {
+	if (old_blk_addr != NEW_ADDR && !is_cold_data(page) &&
+					need_inplace_update(inode)) {
 		rewrite_data_page(F2FS_SB(inode->i_sb), page,
 						old_blk_addr);
+#ifdef CONFIG_F2FS_STAT_FS
+		F2FS_SB(inode->i_sb)->inplace_count++;
+#endif
 	} else {
 		write_data_page(inode, page, &dn,
 				old_blk_addr, &new_blk_addr);
 		update_extent_cache(new_blk_addr, &dn);
+		set_inode_flag(F2FS_I(inode), FI_APPEND_WRITE);
 	}
 out_writepage:
 	f2fs_put_dnode(&dn);
@@ -609,6 +824,10 @@ static int f2fs_write_data_pages(struct address_space *mapping,
 		wbc->nr_to_write = desired_nrtw;
 	}
 
+	/* write_cache_pages() waits for pages still under writeback */
+	if (wbc->sync_mode == WB_SYNC_ALL)
+		f2fs_submit_mapping_bio(sbi, mapping, DATA);
+
 	if (!S_ISDIR(inode->i_mode)) {
 		mutex_lock(&sbi->writepages);
 		locked = true;
@@ -616,7 +835,10 @@ static int f2fs_write_data_pages(struct address_space *mapping,
 	ret = write_cache_pages(mapping, wbc, __f2fs_writepage, mapping);
 	if (locked)
 		mutex_unlock(&sbi->writepages);
-	f2fs_submit_bio(sbi, DATA, (wbc->sync_mode == WB_SYNC_ALL));
+
+	/* let background writeback keep merging into the open bio */
+	if (wbc->sync_mode == WB_SYNC_ALL)
+		f2fs_submit_bio(sbi, DATA, true);
 
 	remove_dirty_dir_inode(inode);
 
@@ -785,3 +1007,17 @@ const struct address_space_operations f2fs_dblock_aops = {
 	.direct_IO	= f2fs_direct_IO,
 	.bmap		= f2fs_bmap,
 };
+
+int __init create_extent_cache(void)
+{
+	extent_node_slab = f2fs_kmem_cache_create("f2fs_extent_node",
+			sizeof(struct extent_node), NULL);
+	if (!extent_node_slab)
+		return -ENOMEM;
+	return 0;
+}
+
+void destroy_extent_cache(void)
+{
+	kmem_cache_destroy(extent_node_slab);
+}
@@ -34,6 +34,7 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 
 	/* valid check of the segment numbers */
 	si->hit_ext = sbi->read_hit_ext;
+	si->hit_rbtree = sbi->read_hit_rbtree;
 	si->total_ext = sbi->total_hit_ext;
 	si->ndirty_node = get_pages(sbi, F2FS_DIRTY_NODES);
 	si->ndirty_dent = get_pages(sbi, F2FS_DIRTY_DENTS);
@@ -57,6 +58,15 @@ static void update_general_status(struct f2fs_sb_info *sbi)
 	si->sits = SIT_I(sbi)->dirty_sentries;
 	si->fnids = NM_I(sbi)->fcnt;
 	si->bg_gc = sbi->bg_gc;
+	si->inplace_count = sbi->inplace_count;
+	for (i = 0; i < NR_PAGE_TYPE; i++) {
+		si->nr_bios[i] = sbi->nr_bios[i];
+		si->nr_bio_pages[i] = sbi->nr_bio_pages[i];
+	}
+	for (i = 0; i < NR_FSYNC_CP_REASON; i++)
+		si->fsync_cp[i] = sbi->fsync_cp[i];
+	for (i = 0; i < NR_FSYNC_LAT_BUCKETS; i++)
+		si->fsync_lat[i] = sbi->fsync_lat[i];
 	si->util_free = (int)(free_user_blocks(sbi) >> sbi->log_blocks_per_seg)
 		* 100 / (int)(sbi->user_block_count >> sbi->log_blocks_per_seg)
 		/ 2;
@@ -153,6 +163,7 @@ static void update_mem_info(struct f2fs_sb_info *sbi)
 	si->base_mem += sizeof(struct dirty_seglist_info);
 	si->base_mem += NR_DIRTY_TYPE * f2fs_bitmap_size(TOTAL_SEGS(sbi));
 	si->base_mem += f2fs_bitmap_size(TOTAL_SECS(sbi));
+	si->base_mem += TOTAL_SECS(sbi) * sizeof(struct list_head);
 
 	/* buld nm */
 	si->base_mem += sizeof(struct f2fs_nm_info);
@@ -173,9 +184,44 @@ get_cache:
 	si->cache_mem += sbi->n_dirty_dirs * sizeof(struct dir_inode_entry);
 }
 
+static void update_fsync_status(struct seq_file *s, struct f2fs_stat_info *si)
+{
+	static const char *reasons[NR_FSYNC_CP_REASON] = {
+		[CP_NO_NEEDED]			= "none",
+		[CP_NON_REGULAR]		= "non-regular",
+		[CP_HARDLINK]			= "hardlink",
+		[CP_WRONG_PINO]			= "wrong pino",
+		[CP_NO_SPACE_ROLL_FORWARD]	= "no space",
+		[CP_PARENT_NOT_CHECKPOINTED]	= "new parent",
+	};
+	unsigned int total = 0;
+	int i;
+
+	for (i = 0; i < NR_FSYNC_CP_REASON; i++)
+		total += si->fsync_cp[i];
+
+	seq_printf(s, "\nFsync: %u calls, %u with checkpoint\n",
+		   total, total - si->fsync_cp[CP_NO_NEEDED]);
+	for (i = CP_NON_REGULAR; i < NR_FSYNC_CP_REASON; i++)
+		seq_printf(s, "  - %-12s: %u\n", reasons[i], si->fsync_cp[i]);
+	seq_printf(s, "Fsync latency (us):\n");
+	for (i = 0; i < NR_FSYNC_LAT_BUCKETS; i++) {
+		if (!si->fsync_lat[i])
+			continue;
+		if (i == NR_FSYNC_LAT_BUCKETS - 1)
+			seq_printf(s, "  >= %7lu: %u\n", 1UL << (i - 1),
+				   si->fsync_lat[i]);
+		else
+			seq_printf(s, "  < %8lu: %u\n", 1UL << i,
+				   si->fsync_lat[i]);
+	}
+	seq_printf(s, "\n");
+}
+
 static int stat_show(struct seq_file *s, void *v)
 {
 	struct f2fs_stat_info *si;
+	unsigned long long gc_time;
 	int i = 0;
 	int j;
 
@@ -240,8 +286,22 @@ static int stat_show(struct seq_file *s, void *v)
 		seq_printf(s, "Try to move %d blocks\n", si->tot_blks);
 		seq_printf(s, "  - data blocks : %d\n", si->data_blks);
 		seq_printf(s, "  - node blocks : %d\n", si->node_blks);
+		seq_printf(s, "GC victims: %d sections (FG: %d, BG expired: %d)\n",
+			   si->gc_secs, si->fg_gc, si->gc_expired);
+		seq_printf(s, "  - BG time : %llu ms (max: %u us)\n",
+			   div_u64(si->gc_time[BG_GC], 1000),
+			   si->gc_max_time[BG_GC]);
+		seq_printf(s, "  - FG time : %llu ms (max: %u us)\n",
+			   div_u64(si->gc_time[FG_GC], 1000),
+			   si->gc_max_time[FG_GC]);
+		gc_time = si->gc_time[BG_GC] + si->gc_time[FG_GC];
+		seq_printf(s, "  - throughput : %llu blocks/s\n",
+			   gc_time ? div64_u64((u64)si->tot_blks * 1000000,
+					       gc_time) : 0);
 		seq_printf(s, "\nExtent Hit Ratio: %d / %d\n",
-			   si->hit_ext, si->total_ext);
+			   si->hit_ext + si->hit_rbtree, si->total_ext);
+		seq_printf(s, "  - largest : %d\n  - rbtree : %d\n",
+			   si->hit_ext, si->hit_rbtree);
 		seq_printf(s, "\nBalancing F2FS Async:\n");
 		seq_printf(s, "  - nodes %4d in %4d\n",
 			   si->ndirty_node, si->node_pages);
@@ -268,6 +328,13 @@ static int stat_show(struct seq_file *s, void *v)
 		for (j = 0; j < si->util_free; j++)
 			seq_printf(s, "-");
 		seq_printf(s, "]\n\n");
+		seq_printf(s, "IPU: %u blocks\n", si->inplace_count);
+		seq_printf(s, "Write bios: data %u (%u pages), node %u (%u pages), "
+			   "meta %u (%u pages)\n",
+			   si->nr_bios[DATA], si->nr_bio_pages[DATA],
+			   si->nr_bios[NODE], si->nr_bio_pages[NODE],
+			   si->nr_bios[META], si->nr_bio_pages[META]);
+		update_fsync_status(s, si);
 		seq_printf(s, "SSR: %u blocks in %u segments\n",
 			   si->block_count[SSR], si->segment_count[SSR]);
 		seq_printf(s, "LFS: %u blocks in %u segments\n",
@@ -17,6 +17,7 @@
 #include <linux/slab.h>
 #include <linux/crc32.h>
 #include <linux/magic.h>
+#include <linux/rbtree.h>
 
 /*
  * For mount options
@@ -158,6 +159,20 @@ struct extent_info {
 	unsigned int len;	/* length of the extent */
 };
 
+/*
+ * Besides the largest extent kept in the inode, each inode caches up to
+ * F2FS_MAX_EXTENT_NODES other contiguous mappings in an rbtree indexed by
+ * file offset. It is protected by ext_lock as well.
+ */
+#define F2FS_MAX_EXTENT_NODES	64
+
+struct extent_node {
+	struct rb_node rb_node;	/* rb node located in the extent tree */
+	unsigned int fofs;	/* start offset in a file */
+	u32 blk_addr;		/* start block address of the extent */
+	unsigned int len;	/* length of the extent */
+};
+
 /*
  * i_advise uses FADVISE_XXX_BIT. We can add additional hints later.
  */
@@ -179,6 +194,9 @@ struct f2fs_inode_info {
 	unsigned int clevel;		/* maximum level of given file name */
 	nid_t i_xattr_nid;		/* node id that contains xattrs */
 	struct extent_info ext;		/* in-memory extent cache entry */
+	struct rb_root ext_tree;	/* other cached extents */
+	unsigned int ext_count;		/* # of nodes in ext_tree */
+	unsigned long last_fsync;	/* jiffies of the last fsync */
 };
 
 static inline void get_extent_info(struct extent_info *ext,
@@ -348,6 +366,23 @@ enum page_type {
 	META_FLUSH,
 };
 
+/*
+ * Why an fsync could not be served by roll-forward node writes alone and
+ * needed a checkpoint, or CP_NO_NEEDED when it took the fast path.
+ */
+enum fsync_cp_reason {
+	CP_NO_NEEDED,
+	CP_NON_REGULAR,
+	CP_HARDLINK,
+	CP_WRONG_PINO,
+	CP_NO_SPACE_ROLL_FORWARD,
+	CP_PARENT_NOT_CHECKPOINTED,
+	NR_FSYNC_CP_REASON,
+};
+
+/* fsync latency histogram buckets, in log2 microseconds */
+#define NR_FSYNC_LAT_BUCKETS	20
+
 struct f2fs_sb_info {
 	struct super_block *sb;			/* pointer to VFS super block */
 	struct buffer_head *raw_super_buf;	/* buffer head of raw sb */
@@ -363,6 +398,8 @@ struct f2fs_sb_info {
 	struct bio *bio[NR_PAGE_TYPE];		/* bios to merge */
 	sector_t last_block_in_bio[NR_PAGE_TYPE];	/* last block number */
 	struct rw_semaphore bio_sem;		/* IO semaphore */
+	unsigned long bio_time[NR_PAGE_TYPE];	/* when bio[] was started */
+	struct delayed_work bio_work;		/* submits aged bio[] */
 
 	/* for checkpoint */
 	struct f2fs_checkpoint *ckpt;		/* raw checkpoint pointer */
@@ -409,6 +446,8 @@ struct f2fs_sb_info {
 	atomic_t nr_pages[NR_COUNT_TYPE];	/* # of pages, see count_type */
 
 	struct f2fs_mount_info mount_opt;	/* mount options */
+	unsigned int ipu_policy;		/* in-place-update policy */
+	unsigned int min_ipu_util;		/* in-place-update threshold */
 
 	/* for cleaning operations */
 	struct mutex gc_mutex;			/* mutex for GC */
@@ -424,6 +463,12 @@ struct f2fs_sb_info {
 	unsigned int segment_count[2];		/* # of allocated segments */
 	unsigned int block_count[2];		/* # of allocated blocks */
 	int total_hit_ext, read_hit_ext;	/* extent cache hit ratio */
+	int read_hit_rbtree;			/* hits in the extent tree */
+	unsigned int inplace_count;		/* # of in-place updates */
+	unsigned int nr_bios[NR_PAGE_TYPE];	/* # of submitted write bios */
+	unsigned int nr_bio_pages[NR_PAGE_TYPE];/* # of pages in them */
+	unsigned int fsync_cp[NR_FSYNC_CP_REASON];	/* fsyncs by reason */
+	unsigned int fsync_lat[NR_FSYNC_LAT_BUCKETS];	/* fsync latency */
 	int bg_gc;				/* background gc calls */
 	unsigned int n_dirty_dirs;		/* # of dir inodes */
 #endif
@@ -873,6 +918,7 @@ enum {
 	FI_NO_ALLOC,		/* should not allocate any blocks */
 	FI_UPDATE_DIR,		/* should update inode block for consistency */
 	FI_DELAY_IPUT,		/* used for the recovery */
+	FI_APPEND_WRITE,	/* data got new block addresses since fsync */
 };
 
 static inline void set_inode_flag(struct f2fs_inode_info *fi, int flag)
@@ -1013,6 +1059,9 @@ void allocate_new_segments(struct f2fs_sb_info *);
 struct page *get_sum_page(struct f2fs_sb_info *, unsigned int);
 struct bio *f2fs_bio_alloc(struct block_device *, int);
 void f2fs_submit_bio(struct f2fs_sb_info *, enum page_type, bool sync);
+void f2fs_wait_on_page_writeback(struct page *, enum page_type);
+void f2fs_submit_mapping_bio(struct f2fs_sb_info *, struct address_space *,
+				enum page_type);
 void write_meta_page(struct f2fs_sb_info *, struct page *);
 void write_node_page(struct f2fs_sb_info *, struct page *, unsigned int,
 					block_t, block_t *);
@@ -1036,6 +1085,7 @@ void destroy_segment_manager(struct f2fs_sb_info *);
  */
 struct page *grab_meta_page(struct f2fs_sb_info *, pgoff_t);
 struct page *get_meta_page(struct f2fs_sb_info *, pgoff_t);
+void ra_meta_pages(struct f2fs_sb_info *, pgoff_t, int);
 long sync_meta_pages(struct f2fs_sb_info *, enum page_type, long);
 int check_orphan_space(struct f2fs_sb_info *);
 void add_orphan_inode(struct f2fs_sb_info *, nid_t);
@@ -1057,11 +1107,14 @@ void destroy_checkpoint_caches(void);
  */
 int reserve_new_block(struct dnode_of_data *);
 void update_extent_cache(block_t, struct dnode_of_data *);
+void f2fs_destroy_extent_tree(struct inode *);
 struct page *find_data_page(struct inode *, pgoff_t, bool);
 struct page *get_lock_data_page(struct inode *, pgoff_t);
 struct page *get_new_data_page(struct inode *, struct page *, pgoff_t, bool);
 int f2fs_readpage(struct f2fs_sb_info *, struct page *, block_t, int);
 int do_write_data_page(struct page *);
+int __init create_extent_cache(void);
+void destroy_extent_cache(void);
 
 /*
  * gc.c
@@ -1090,7 +1143,7 @@ struct f2fs_stat_info {
 	struct mutex stat_lock;
 	int all_area_segs, sit_area_segs, nat_area_segs, ssa_area_segs;
 	int main_area_segs, main_area_sections, main_area_zones;
-	int hit_ext, total_ext;
+	int hit_ext, hit_rbtree, total_ext;
 	int ndirty_node, ndirty_dent, ndirty_dirs, ndirty_meta;
 	int nats, sits, fnids;
 	int total_count, utilization;
@@ -1101,6 +1154,14 @@ struct f2fs_stat_info {
 	int rsvd_segs, overp_segs;
 	int dirty_count, node_pages, meta_pages;
 	int prefree_count, call_count;
+	int fg_gc, gc_secs, gc_expired;
+	unsigned int inplace_count;
+	unsigned int nr_bios[NR_PAGE_TYPE], nr_bio_pages[NR_PAGE_TYPE];
+	unsigned int fsync_cp[NR_FSYNC_CP_REASON];
+	unsigned int fsync_lat[NR_FSYNC_LAT_BUCKETS];
+	unsigned long long gc_time[2];	/* usecs spent in BG_GC and FG_GC */
+	unsigned int gc_max_time[2];	/* longest BG_GC and FG_GC run */
+	ktime_t gc_start;
 	int tot_segs, node_segs, data_segs, free_segs, free_secs;
 	int tot_blks, data_blks, node_blks;
 	int curseg[NR_CURSEG_TYPE];
@@ -1141,6 +1202,23 @@ struct f2fs_stat_info {
 		si->node_blks += (blks);				\
 	} while (0)
 
+#define stat_inc_gc_sec_count(sbi)	((sbi)->stat_info->gc_secs++)
+#define stat_inc_gc_expired(sbi)	((sbi)->stat_info->gc_expired++)
+
+#define stat_start_gc_time(sbi)	((sbi)->stat_info->gc_start = ktime_get())
+
+#define stat_update_gc_time(sbi, type)					\
+	do {								\
+		struct f2fs_stat_info *si = sbi->stat_info;		\
+		unsigned int us = ktime_us_delta(ktime_get(),		\
+						si->gc_start);		\
+		if (type == FG_GC)					\
+			si->fg_gc++;					\
+		si->gc_time[type] += us;				\
+		if (si->gc_max_time[type] < us)				\
+			si->gc_max_time[type] = us;			\
+	} while (0)
+
 int f2fs_build_stats(struct f2fs_sb_info *);
 void f2fs_destroy_stats(struct f2fs_sb_info *);
 void __init f2fs_create_root_stats(void);
@@ -1151,6 +1229,10 @@ void f2fs_destroy_root_stats(void);
 #define stat_inc_tot_blk_count(si, blks)
 #define stat_inc_data_blk_count(si, blks)
 #define stat_inc_node_blk_count(sbi, blks)
+#define stat_inc_gc_sec_count(sbi)
+#define stat_inc_gc_expired(sbi)
+#define stat_start_gc_time(sbi)
+#define stat_update_gc_time(sbi, type)
 
 static inline int f2fs_build_stats(struct f2fs_sb_info *sbi) { return 0; }
 static inline void f2fs_destroy_stats(struct f2fs_sb_info *sbi) { }
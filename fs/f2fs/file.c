@@ -100,7 +100,7 @@ static int f2fs_vm_page_mkwrite(struct vm_area_struct *vma,
 
 mapped:
 	/* fill the page */
-	wait_on_page_writeback(page);
+	f2fs_wait_on_page_writeback(page, DATA);
 out:
 	return block_page_mkwrite_return(err);
 }
@@ -138,12 +138,63 @@ static int get_parent_ino(struct inode *inode, nid_t *pino)
 	return 1;
 }
 
+/*
+ * The parent inode number is needed by roll-forward recovery to find the
+ * directory of a newly created file. Once a checkpoint has made the
+ * namespace consistent, look it up again so that later fsyncs of the file
+ * do not need a checkpoint.
+ */
+static void try_to_fix_pino(struct inode *inode)
+{
+	nid_t pino;
+
+	if (inode->i_nlink != 1 || !get_parent_ino(inode, &pino))
+		return;
+	F2FS_I(inode)->i_pino = pino;
+	file_got_pino(inode);
+	mark_inode_dirty_sync(inode);
+	f2fs_write_inode(inode, NULL);
+}
+
+static enum fsync_cp_reason need_do_checkpoint(struct inode *inode)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+
+	if (!S_ISREG(inode->i_mode))
+		return CP_NON_REGULAR;
+	if (inode->i_nlink != 1)
+		return CP_HARDLINK;
+	if (file_wrong_pino(inode))
+		return CP_WRONG_PINO;
+	if (!space_for_roll_forward(sbi))
+		return CP_NO_SPACE_ROLL_FORWARD;
+	if (!is_checkpointed_node(sbi, F2FS_I(inode)->i_pino))
+		return CP_PARENT_NOT_CHECKPOINTED;
+	return CP_NO_NEEDED;
+}
+
+#ifdef CONFIG_F2FS_STAT_FS
+static void stat_update_fsync(struct f2fs_sb_info *sbi,
+			enum fsync_cp_reason reason, ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+	int bucket = us > 0 ? fls64(us) : 0;
+
+	sbi->fsync_cp[reason]++;
+	sbi->fsync_lat[min(bucket, NR_FSYNC_LAT_BUCKETS - 1)]++;
+}
+#else
+static inline void stat_update_fsync(struct f2fs_sb_info *sbi,
+			enum fsync_cp_reason reason, ktime_t start) { }
+#endif
+
 int f2fs_sync_file(struct file *file, int datasync)
 {
 	struct inode *inode = file->f_mapping->host;
 	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+	enum fsync_cp_reason reason = CP_NO_NEEDED;
+	ktime_t start = ktime_get();
 	int ret = 0;
-	bool need_cp = false;
 	struct writeback_control wbc = {
 		.sync_mode = WB_SYNC_ALL,
 		.nr_to_write = LONG_MAX,
@@ -155,35 +206,30 @@ int f2fs_sync_file(struct file *file, int datasync)
 
 	trace_f2fs_sync_file_enter(inode);
 
+	/* feeds the F2FS_IPU_FSYNC in-place-update policy */
+	F2FS_I(inode)->last_fsync = jiffies;
+
 	/* guarantee free sections for fsync */
 	f2fs_balance_fs(sbi);
 
-	if (datasync && !(inode->i_state & I_DIRTY_DATASYNC))
+	/*
+	 * Data which was only overwritten in place does not change any node,
+	 * so fdatasync just has to flush the device cache.
+	 */
+	if (datasync && !(inode->i_state & I_DIRTY_DATASYNC) &&
+			!is_inode_flag_set(F2FS_I(inode), FI_APPEND_WRITE)) {
+		ret = blkdev_issue_flush(inode->i_sb->s_bdev, GFP_KERNEL, NULL);
 		goto out;
+	}
+	clear_inode_flag(F2FS_I(inode), FI_APPEND_WRITE);
 
-	if (!S_ISREG(inode->i_mode) || inode->i_nlink != 1)
-		need_cp = true;
-	else if (file_wrong_pino(inode))
-		need_cp = true;
-	else if (!space_for_roll_forward(sbi))
-		need_cp = true;
-	else if (!is_checkpointed_node(sbi, F2FS_I(inode)->i_pino))
-		need_cp = true;
-
-	if (need_cp) {
-		nid_t pino;
+	reason = need_do_checkpoint(inode);
 
+	if (reason != CP_NO_NEEDED) {
 		/* all the dirty node pages should be flushed for POR */
 		ret = f2fs_sync_fs(inode->i_sb, 1);
-		if (file_wrong_pino(inode) && inode->i_nlink == 1 &&
-					get_parent_ino(inode, &pino)) {
-			F2FS_I(inode)->i_pino = pino;
-			file_got_pino(inode);
-			mark_inode_dirty_sync(inode);
-			ret = f2fs_write_inode(inode, NULL);
-			if (ret)
-				goto out;
-		}
+		if (!ret && reason == CP_WRONG_PINO)
+			try_to_fix_pino(inode);
 	} else {
 		/* if there is no written node page, write its inode page */
 		while (!sync_node_pages(sbi, inode->i_ino, &wbc)) {
@@ -192,12 +238,14 @@ int f2fs_sync_file(struct file *file, int datasync)
 			if (ret)
 				goto out;
 		}
+		f2fs_submit_mapping_bio(sbi, sbi->node_inode->i_mapping, NODE);
 		filemap_fdatawait_range(sbi->node_inode->i_mapping,
 							0, LONG_MAX);
 		ret = blkdev_issue_flush(inode->i_sb->s_bdev, GFP_KERNEL, NULL);
 	}
 out:
-	trace_f2fs_sync_file_exit(inode, need_cp, datasync, ret);
+	stat_update_fsync(sbi, reason, start);
+	trace_f2fs_sync_file_exit(inode, reason != CP_NO_NEEDED, datasync, ret);
 	return ret;
 }
 
@@ -262,7 +310,7 @@ static void truncate_partial_data_page(struct inode *inode, u64 from)
 		f2fs_put_page(page, 1);
 		return;
 	}
-	wait_on_page_writeback(page);
+	f2fs_wait_on_page_writeback(page, DATA);
 	zero_user(page, offset, PAGE_CACHE_SIZE - offset);
 	set_page_dirty(page);
 	f2fs_put_page(page, 1);
@@ -384,6 +432,8 @@ int f2fs_setattr(struct dentry *dentry, struct iattr *attr)
 
 	if ((attr->ia_valid & ATTR_SIZE) &&
 			attr->ia_size != i_size_read(inode)) {
+		f2fs_submit_mapping_bio(F2FS_SB(inode->i_sb),
+					inode->i_mapping, DATA);
 		truncate_setsize(inode, attr->ia_size);
 		f2fs_truncate(inode);
 		f2fs_balance_fs(F2FS_SB(inode->i_sb));
@@ -432,7 +482,7 @@ static void fill_zero(struct inode *inode, pgoff_t index,
 	mutex_unlock_op(sbi, ilock);
 
 	if (!IS_ERR(page)) {
-		wait_on_page_writeback(page);
+		f2fs_wait_on_page_writeback(page, DATA);
 		zero_user(page, start, len);
 		set_page_dirty(page);
 		f2fs_put_page(page, 1);
@@ -494,6 +544,7 @@ static int punch_hole(struct inode *inode, loff_t offset, loff_t len, int mode)
 
 			blk_start = pg_start << PAGE_CACHE_SHIFT;
 			blk_end = pg_end << PAGE_CACHE_SHIFT;
+			f2fs_submit_mapping_bio(sbi, mapping, DATA);
 			truncate_inode_pages_range(mapping, blk_start,
 					blk_end - 1);
 
@@ -223,6 +223,46 @@ static unsigned int get_gc_cost(struct f2fs_sb_info *sbi, unsigned int segno,
 		return get_cb_cost(sbi, segno);
 }
 
+/*
+ * LFS victims are taken from the utilization index of dirty sections, starting
+ * from the emptiest bucket. Greedy stops at the first bucket which has a
+ * candidate, since every section in the following buckets has more valid
+ * blocks. Cost-benefit also weighs the age, so it keeps looking into the next
+ * buckets until MAX_VICTIM_SEARCH candidates have been examined.
+ */
+static void get_victim_from_buckets(struct f2fs_sb_info *sbi, int gc_type,
+					struct victim_sel_policy *p)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	struct list_head *pos;
+	int nsearched = 0;
+	int i;
+
+	for (i = 0; i < NR_VICTIM_BUCKETS; i++) {
+		list_for_each(pos, &dirty_i->victim_bucket[i]) {
+			unsigned int secno = pos - dirty_i->sec_list;
+			unsigned int segno = secno * sbi->segs_per_sec;
+			unsigned long cost;
+
+			if (sec_usage_check(sbi, secno))
+				continue;
+			if (gc_type == BG_GC &&
+					test_bit(secno, dirty_i->victim_secmap))
+				continue;
+
+			cost = get_gc_cost(sbi, segno, p);
+			if (p->min_cost > cost) {
+				p->min_segno = segno;
+				p->min_cost = cost;
+			}
+			if (++nsearched >= MAX_VICTIM_SEARCH)
+				return;
+		}
+		if (p->gc_mode == GC_GREEDY && p->min_segno != NULL_SEGNO)
+			return;
+	}
+}
+
 /*
  * This function is called from two paths.
  * One is garbage collection and the other is SSR segment selection.
@@ -253,6 +293,11 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			goto got_it;
 	}
 
+	if (p.alloc_mode == LFS) {
+		get_victim_from_buckets(sbi, gc_type, &p);
+		goto out;
+	}
+
 	while (1) {
 		unsigned long cost;
 		unsigned int segno;
@@ -290,6 +335,7 @@ static int get_victim_by_default(struct f2fs_sb_info *sbi,
 			break;
 		}
 	}
+out:
 	if (p.min_segno != NULL_SEGNO) {
 got_it:
 		if (p.alloc_mode == LFS) {
@@ -372,7 +418,8 @@ static int check_valid_map(struct f2fs_sb_info *sbi,
  * ignore that.
  */
 static void gc_node_segment(struct f2fs_sb_info *sbi,
-		struct f2fs_summary *sum, unsigned int segno, int gc_type)
+		struct f2fs_summary *sum, unsigned int segno, int gc_type,
+		unsigned long deadline)
 {
 	bool initial = true;
 	struct f2fs_summary *entry;
@@ -388,6 +435,9 @@ next_step:
 		/* stop BG_GC if there is not enough free sections. */
 		if (gc_type == BG_GC && has_not_enough_free_secs(sbi, 0))
 			return;
+		/* stop BG_GC once its time slice is used up */
+		if (gc_slice_expired(gc_type, deadline))
+			return;
 
 		if (check_valid_map(sbi, segno, off) == 0)
 			continue;
@@ -529,7 +579,8 @@ out:
  * the victim data block is ignored.
  */
 static void gc_data_segment(struct f2fs_sb_info *sbi, struct f2fs_summary *sum,
-		struct list_head *ilist, unsigned int segno, int gc_type)
+		struct list_head *ilist, unsigned int segno, int gc_type,
+		unsigned long deadline)
 {
 	struct super_block *sb = sbi->sb;
 	struct f2fs_summary *entry;
@@ -552,6 +603,9 @@ next_step:
 		/* stop BG_GC if there is not enough free sections. */
 		if (gc_type == BG_GC && has_not_enough_free_secs(sbi, 0))
 			return;
+		/* stop BG_GC once its time slice is used up */
+		if (gc_slice_expired(gc_type, deadline))
+			return;
 
 		if (check_valid_map(sbi, segno, off) == 0)
 			continue;
@@ -630,7 +684,7 @@ static int __get_victim(struct f2fs_sb_info *sbi, unsigned int *victim,
 }
 
 static void do_garbage_collect(struct f2fs_sb_info *sbi, unsigned int segno,
-				struct list_head *ilist, int gc_type)
+		struct list_head *ilist, int gc_type, unsigned long deadline)
 {
 	struct page *sum_page;
 	struct f2fs_summary_block *sum;
@@ -647,10 +701,11 @@ static void do_garbage_collect(struct f2fs_sb_info *sbi, unsigned int segno,
 
 	switch (GET_SUM_TYPE((&sum->footer))) {
 	case SUM_TYPE_NODE:
-		gc_node_segment(sbi, sum->entries, segno, gc_type);
+		gc_node_segment(sbi, sum->entries, segno, gc_type, deadline);
 		break;
 	case SUM_TYPE_DATA:
-		gc_data_segment(sbi, sum->entries, ilist, segno, gc_type);
+		gc_data_segment(sbi, sum->entries, ilist, segno, gc_type,
+								deadline);
 		break;
 	}
 	blk_finish_plug(&plug);
@@ -668,8 +723,10 @@ int f2fs_gc(struct f2fs_sb_info *sbi)
 	int gc_type = BG_GC;
 	int nfree = 0;
 	int ret = -1;
+	unsigned long deadline = jiffies + msecs_to_jiffies(GC_TIME_SLICE);
 
 	INIT_LIST_HEAD(&ilist);
+	stat_start_gc_time(sbi);
 gc_more:
 	if (!(sbi->sb->s_flags & MS_ACTIVE))
 		goto stop;
@@ -683,8 +740,18 @@ gc_more:
 		goto stop;
 	ret = 0;
 
-	for (i = 0; i < sbi->segs_per_sec; i++)
-		do_garbage_collect(sbi, segno + i, &ilist, gc_type);
+	/* readahead the summary blocks of the whole victim section */
+	ra_meta_pages(sbi, GET_SUM_BLOCK(sbi, segno), sbi->segs_per_sec);
+
+	for (i = 0; i < sbi->segs_per_sec; i++) {
+		if (gc_slice_expired(gc_type, deadline))
+			break;
+		do_garbage_collect(sbi, segno + i, &ilist, gc_type, deadline);
+	}
+	stat_inc_gc_sec_count(sbi);
+
+	if (gc_slice_expired(gc_type, deadline))
+		stat_inc_gc_expired(sbi);
 
 	if (gc_type == FG_GC) {
 		sbi->cur_victim_sec = NULL_SEGNO;
@@ -698,6 +765,7 @@ gc_more:
 	if (gc_type == FG_GC)
 		write_checkpoint(sbi, false);
 stop:
+	stat_update_gc_time(sbi, gc_type);
 	mutex_unlock(&sbi->gc_mutex);
 
 	put_gc_inode(&ilist);
@@ -22,6 +22,9 @@
 /* Search max. number of dirty segments to select a victim segment */
 #define MAX_VICTIM_SEARCH	20
 
+/* Time budget of a background GC pass, so that it yields to user IO */
+#define GC_TIME_SLICE		50	/* milliseconds */
+
 struct f2fs_gc_kthread {
 	struct task_struct *f2fs_gc_task;
 	wait_queue_head_t gc_wait_queue_head;
@@ -100,3 +103,8 @@ static inline int is_idle(struct f2fs_sb_info *sbi)
 	struct request_list *rl = &q->rq;
 	return !(rl->count[BLK_RW_SYNC]) && !(rl->count[BLK_RW_ASYNC]);
 }
+
+static inline bool gc_slice_expired(int gc_type, unsigned long deadline)
+{
+	return gc_type == BG_GC && time_after(jiffies, deadline);
+}
@@ -151,7 +151,7 @@ void update_inode(struct inode *inode, struct page *node_page)
 	struct f2fs_node *rn;
 	struct f2fs_inode *ri;
 
-	wait_on_page_writeback(node_page);
+	f2fs_wait_on_page_writeback(node_page, NODE);
 
 	rn = page_address(node_page);
 	ri = &(rn->i);
@@ -243,7 +243,9 @@ void f2fs_evict_inode(struct inode *inode)
 	int ilock;
 
 	trace_f2fs_evict_inode(inode);
+	f2fs_submit_mapping_bio(sbi, &inode->i_data, DATA);
 	truncate_inode_pages(&inode->i_data, 0);
+	f2fs_destroy_extent_tree(inode);
 
 	if (inode->i_ino == F2FS_NODE_INO(sbi) ||
 			inode->i_ino == F2FS_META_INO(sbi))
@@ -299,7 +299,7 @@ static int do_recover_data(struct f2fs_sb_info *sbi, struct inode *inode,
 		return err;
 	}
 
-	wait_on_page_writeback(dn.node_page);
+	f2fs_wait_on_page_writeback(dn.node_page, NODE);
 
 	get_node_info(sbi, dn.nid, &ni);
 	BUG_ON(ni.ino != ino_of_node(page));
@@ -36,6 +36,31 @@ void f2fs_balance_fs(struct f2fs_sb_info *sbi)
 	}
 }
 
+/*
+ * Keep the utilization index of dirty sections in sync with dirty_segmap.
+ * A section is indexed as long as any of its segments is dirty.
+ */
+static void __update_victim_bucket(struct f2fs_sb_info *sbi, unsigned int segno)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	unsigned int secno = GET_SECNO(sbi, segno);
+	unsigned int start = secno * sbi->segs_per_sec;
+	unsigned int end = start + sbi->segs_per_sec;
+	unsigned int blks_per_sec, vblocks, bucket;
+
+	if (find_next_bit(dirty_i->dirty_segmap[DIRTY], end, start) >= end) {
+		list_del_init(&dirty_i->sec_list[secno]);
+		return;
+	}
+
+	blks_per_sec = sbi->segs_per_sec << sbi->log_blocks_per_seg;
+	vblocks = get_valid_blocks(sbi, start, sbi->segs_per_sec);
+	bucket = min_t(unsigned int, vblocks * NR_VICTIM_BUCKETS / blks_per_sec,
+						NR_VICTIM_BUCKETS - 1);
+	list_move_tail(&dirty_i->sec_list[secno],
+					&dirty_i->victim_bucket[bucket]);
+}
+
 static void __locate_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno,
 		enum dirty_type dirty_type)
 {
@@ -64,6 +89,7 @@ static void __locate_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno,
 			if (test_and_clear_bit(segno, dirty_i->dirty_segmap[t]))
 				dirty_i->nr_dirty[t]--;
 		}
+		__update_victim_bucket(sbi, segno);
 	}
 }
 
@@ -86,6 +112,7 @@ static void __remove_dirty_segment(struct f2fs_sb_info *sbi, unsigned int segno,
 		if (get_valid_blocks(sbi, segno, sbi->segs_per_sec) == 0)
 			clear_bit(GET_SECNO(sbi, segno),
 						dirty_i->victim_secmap);
+		__update_victim_bucket(sbi, segno);
 	}
 }
 
@@ -644,6 +671,10 @@ static void do_submit_bio(struct f2fs_sb_info *sbi,
 		sbi->bio[btype]->bi_end_io = f2fs_end_io_write;
 
 		trace_f2fs_do_submit_bio(sbi->sb, btype, sync, sbi->bio[btype]);
+#ifdef CONFIG_F2FS_STAT_FS
+		sbi->nr_bios[btype]++;
+		sbi->nr_bio_pages[btype] += sbi->bio[btype]->bi_vcnt;
+#endif
 
 		if (type == META_FLUSH) {
 			DECLARE_COMPLETION_ONSTACK(wait);
@@ -666,6 +697,85 @@ void f2fs_submit_bio(struct f2fs_sb_info *sbi, enum page_type type, bool sync)
 	up_write(&sbi->bio_sem);
 }
 
+/*
+ * Write bios are kept open across writeback callers so that consecutive
+ * blocks from different inodes and writepages calls end up in one request.
+ * A bio is submitted once it is full, when someone needs its pages, or
+ * BIO_MERGE_INTERVAL after it was started, whichever comes first.
+ */
+static void f2fs_bio_work(struct work_struct *work)
+{
+	struct f2fs_sb_info *sbi = container_of(to_delayed_work(work),
+					struct f2fs_sb_info, bio_work);
+	unsigned long next = 0;
+	int type;
+
+	down_write(&sbi->bio_sem);
+	for (type = DATA; type < NR_PAGE_TYPE; type++) {
+		unsigned long expire = sbi->bio_time[type] + BIO_MERGE_INTERVAL;
+
+		if (!sbi->bio[type])
+			continue;
+		if (time_after_eq(jiffies, expire))
+			do_submit_bio(sbi, type, false);
+		else if (!next || time_before(expire, next))
+			next = expire;
+	}
+	up_write(&sbi->bio_sem);
+
+	if (next)
+		schedule_delayed_work(&sbi->bio_work, time_after(next, jiffies) ?
+							next - jiffies : 0);
+}
+
+static bool is_merged_page(struct f2fs_sb_info *sbi, struct page *page,
+						enum page_type type)
+{
+	enum page_type btype = type > META ? META : type;
+	struct bio_vec *bvec;
+	bool ret = false;
+	int i;
+
+	down_read(&sbi->bio_sem);
+	if (sbi->bio[btype]) {
+		bio_for_each_segment(bvec, sbi->bio[btype], i) {
+			if (bvec->bv_page == page) {
+				ret = true;
+				break;
+			}
+		}
+	}
+	up_read(&sbi->bio_sem);
+	return ret;
+}
+
+/*
+ * Wait for writeback of a page, which may still sit in an open bio.
+ */
+void f2fs_wait_on_page_writeback(struct page *page, enum page_type type)
+{
+	struct f2fs_sb_info *sbi = F2FS_SB(page->mapping->host->i_sb);
+
+	if (!PageWriteback(page))
+		return;
+	if (is_merged_page(sbi, page, type))
+		f2fs_submit_bio(sbi, type, true);
+	wait_on_page_writeback(page);
+}
+
+/*
+ * Submit the open bio of a type before generic code such as
+ * write_cache_pages() or truncate_inode_pages() waits for the writeback
+ * of pages in @mapping, which could otherwise sit in it until the merge
+ * timer expires.
+ */
+void f2fs_submit_mapping_bio(struct f2fs_sb_info *sbi,
+			struct address_space *mapping, enum page_type type)
+{
+	if (mapping_tagged(mapping, PAGECACHE_TAG_WRITEBACK))
+		f2fs_submit_bio(sbi, type, true);
+}
+
 static void submit_write_page(struct f2fs_sb_info *sbi, struct page *page,
 				block_t blk_addr, enum page_type type)
 {
@@ -688,6 +798,8 @@ alloc_new:
 		 * Until then, let bio_add_page() merge consecutive IOs as much
 		 * as possible.
 		 */
+		sbi->bio_time[type] = jiffies;
+		schedule_delayed_work(&sbi->bio_work, BIO_MERGE_INTERVAL);
 	}
 
 	if (bio_add_page(sbi->bio[type], page, PAGE_CACHE_SIZE, 0) <
@@ -1557,10 +1669,29 @@ static int init_victim_secmap(struct f2fs_sb_info *sbi)
 	return 0;
 }
 
+static int init_victim_buckets(struct f2fs_sb_info *sbi)
+{
+	struct dirty_seglist_info *dirty_i = DIRTY_I(sbi);
+	unsigned int secno;
+	int i;
+
+	for (i = 0; i < NR_VICTIM_BUCKETS; i++)
+		INIT_LIST_HEAD(&dirty_i->victim_bucket[i]);
+
+	dirty_i->sec_list = vzalloc(TOTAL_SECS(sbi) * sizeof(struct list_head));
+	if (!dirty_i->sec_list)
+		return -ENOMEM;
+
+	for (secno = 0; secno < TOTAL_SECS(sbi); secno++)
+		INIT_LIST_HEAD(&dirty_i->sec_list[secno]);
+	return 0;
+}
+
 static int build_dirty_segmap(struct f2fs_sb_info *sbi)
 {
 	struct dirty_seglist_info *dirty_i;
 	unsigned int bitmap_size, i;
+	int err;
 
 	/* allocate memory for dirty segments list information */
 	dirty_i = kzalloc(sizeof(struct dirty_seglist_info), GFP_KERNEL);
@@ -1578,6 +1709,10 @@ static int build_dirty_segmap(struct f2fs_sb_info *sbi)
 			return -ENOMEM;
 	}
 
+	err = init_victim_buckets(sbi);
+	if (err)
+		return err;
+
 	init_dirty_segmap(sbi);
 	return init_victim_secmap(sbi);
 }
@@ -1617,6 +1752,8 @@ int build_segment_manager(struct f2fs_sb_info *sbi)
 	struct f2fs_sm_info *sm_info;
 	int err;
 
+	INIT_DELAYED_WORK(&sbi->bio_work, f2fs_bio_work);
+
 	sm_info = kzalloc(sizeof(struct f2fs_sm_info), GFP_KERNEL);
 	if (!sm_info)
 		return -ENOMEM;
@@ -1685,6 +1822,7 @@ static void destroy_dirty_segmap(struct f2fs_sb_info *sbi)
 		discard_dirty_segmap(sbi, i);
 
 	destroy_victim_secmap(sbi);
+	vfree(dirty_i->sec_list);
 	SM_I(sbi)->dirty_info = NULL;
 	kfree(dirty_i);
 }
@@ -1739,6 +1877,8 @@ static void destroy_sit_info(struct f2fs_sb_info *sbi)
 void destroy_segment_manager(struct f2fs_sb_info *sbi)
 {
 	struct f2fs_sm_info *sm_info = SM_I(sbi);
+
+	cancel_delayed_work_sync(&sbi->bio_work);
 	destroy_dirty_segmap(sbi);
 	destroy_curseg(sbi);
 	destroy_free_segmap(sbi);
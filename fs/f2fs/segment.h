@@ -214,12 +214,22 @@ enum dirty_type {
 	NR_DIRTY_TYPE
 };
 
+/*
+ * Dirty sections are also indexed by their utilization so that the cleaner
+ * can pick a victim without scanning the whole dirty segmap. Each bucket
+ * covers 1/NR_VICTIM_BUCKETS of a section, and a section is moved to the tail
+ * of its bucket whenever its valid block count changes.
+ */
+#define NR_VICTIM_BUCKETS	16
+
 struct dirty_seglist_info {
 	const struct victim_selection *v_ops;	/* victim selction operation */
 	unsigned long *dirty_segmap[NR_DIRTY_TYPE];
 	struct mutex seglist_lock;		/* lock for segment bitmaps */
 	int nr_dirty[NR_DIRTY_TYPE];		/* # of dirty segments */
 	unsigned long *victim_secmap;		/* background GC victims */
+	struct list_head victim_bucket[NR_VICTIM_BUCKETS]; /* dirty sections */
+	struct list_head *sec_list;		/* per-section bucket entries */
 };
 
 /* victim selection function for cleaning and SSR */
@@ -475,22 +485,68 @@ static inline int utilization(struct f2fs_sb_info *sbi)
 
 /*
  * Sometimes f2fs may be better to drop out-of-place update policy.
- * So, if fs utilization is over MIN_IPU_UTIL, then f2fs tries to write
- * data in the original place likewise other traditional file systems.
- * But, currently set 100 in percentage, which means it is disabled.
- * See below need_inplace_update().
+ * Then, f2fs tries to write data in the original place likewise other
+ * traditional file systems. The ipu_policy mount option selects when:
+ *
+ * F2FS_IPU_FORCE: always.
+ * F2FS_IPU_SSR: if SSR mode is activated.
+ * F2FS_IPU_UTIL: if fs utilization is over min_ipu_util.
+ * F2FS_IPU_SSR_UTIL: if SSR mode is activated and fs utilization is over
+ *                    min_ipu_util.
+ * F2FS_IPU_FSYNC: if the file was fsynced within IPU_FSYNC_INTERVAL, and
+ *                 either SSR mode is activated or fs utilization is over
+ *                 min_ipu_util. Such small overwrites then leave the node
+ *                 pages clean, so that the next fsync has less to write.
+ * F2FS_IPU_DISABLE: never.
+ *
+ * Only overwrites of existing blocks are considered, see do_write_data_page.
  */
-#define MIN_IPU_UTIL		100
+enum {
+	F2FS_IPU_FORCE,
+	F2FS_IPU_SSR,
+	F2FS_IPU_UTIL,
+	F2FS_IPU_SSR_UTIL,
+	F2FS_IPU_FSYNC,
+	F2FS_IPU_DISABLE,
+	NR_F2FS_IPU_POLICY,
+};
+
+#define DEF_MIN_IPU_UTIL	70
+#define IPU_FSYNC_INTERVAL	(5 * HZ)
+
+static inline bool is_fsync_heavy(struct inode *inode)
+{
+	unsigned long last = F2FS_I(inode)->last_fsync;
+
+	return last && time_before(jiffies, last + IPU_FSYNC_INTERVAL);
+}
+
 static inline bool need_inplace_update(struct inode *inode)
 {
 	struct f2fs_sb_info *sbi = F2FS_SB(inode->i_sb);
+
 	if (S_ISDIR(inode->i_mode))
 		return false;
-	if (need_SSR(sbi) && utilization(sbi) > MIN_IPU_UTIL)
+
+	switch (sbi->ipu_policy) {
+	case F2FS_IPU_FORCE:
 		return true;
+	case F2FS_IPU_SSR:
+		return need_SSR(sbi);
+	case F2FS_IPU_UTIL:
+		return utilization(sbi) > sbi->min_ipu_util;
+	case F2FS_IPU_SSR_UTIL:
+		return need_SSR(sbi) && utilization(sbi) > sbi->min_ipu_util;
+	case F2FS_IPU_FSYNC:
+		return is_fsync_heavy(inode) && (need_SSR(sbi) ||
+				utilization(sbi) > sbi->min_ipu_util);
+	}
 	return false;
 }
 
+/* time a write bio waits for more pages before it is submitted anyway */
+#define BIO_MERGE_INTERVAL	(msecs_to_jiffies(20))
+
 static inline unsigned int curseg_segno(struct f2fs_sb_info *sbi,
 		int type)
 {
@@ -42,6 +42,8 @@ enum {
 	Opt_noacl,
 	Opt_active_logs,
 	Opt_disable_ext_identify,
+	Opt_ipu_policy,
+	Opt_min_ipu_util,
 	Opt_err,
 };
 
@@ -54,6 +56,8 @@ static match_table_t f2fs_tokens = {
 	{Opt_noacl, "noacl"},
 	{Opt_active_logs, "active_logs=%u"},
 	{Opt_disable_ext_identify, "disable_ext_identify"},
+	{Opt_ipu_policy, "ipu_policy=%u"},
+	{Opt_min_ipu_util, "min_ipu_util=%u"},
 	{Opt_err, NULL},
 };
 
@@ -151,6 +155,20 @@ static int parse_options(struct super_block *sb, char *options)
 		case Opt_disable_ext_identify:
 			set_opt(sbi, DISABLE_EXT_IDENTIFY);
 			break;
+		case Opt_ipu_policy:
+			if (args->from && match_int(args, &arg))
+				return -EINVAL;
+			if (arg < 0 || arg >= NR_F2FS_IPU_POLICY)
+				return -EINVAL;
+			sbi->ipu_policy = arg;
+			break;
+		case Opt_min_ipu_util:
+			if (args->from && match_int(args, &arg))
+				return -EINVAL;
+			if (arg < 0 || arg > 100)
+				return -EINVAL;
+			sbi->min_ipu_util = arg;
+			break;
 		default:
 			f2fs_msg(sb, KERN_ERR,
 				"Unrecognized mount option \"%s\" or missing value",
@@ -177,6 +195,7 @@ static struct inode *f2fs_alloc_inode(struct super_block *sb)
 	fi->i_current_depth = 1;
 	fi->i_advise = 0;
 	rwlock_init(&fi->ext.ext_lock);
+	fi->ext_tree = RB_ROOT;
 
 	set_inode_flag(fi, FI_NEW_INODE);
 
@@ -320,6 +339,8 @@ static int f2fs_show_options(struct seq_file *seq, struct vfsmount *vfs)
 		seq_puts(seq, ",disable_ext_identify");
 
 	seq_printf(seq, ",active_logs=%u", sbi->active_logs);
+	seq_printf(seq, ",ipu_policy=%u", sbi->ipu_policy);
+	seq_printf(seq, ",min_ipu_util=%u", sbi->min_ipu_util);
 
 	return 0;
 }
@@ -329,6 +350,7 @@ static int f2fs_remount(struct super_block *sb, int *flags, char *data)
 	struct f2fs_sb_info *sbi = F2FS_SB(sb);
 	struct f2fs_mount_info org_mount_opt;
 	int err, active_logs;
+	unsigned int ipu_policy, min_ipu_util;
 
 	/*
 	 * Save the old mount options in case we
@@ -336,6 +358,8 @@ static int f2fs_remount(struct super_block *sb, int *flags, char *data)
 	 */
 	org_mount_opt = sbi->mount_opt;
 	active_logs = sbi->active_logs;
+	ipu_policy = sbi->ipu_policy;
+	min_ipu_util = sbi->min_ipu_util;
 
 	/* parse mount options */
 	err = parse_options(sb, data);
@@ -373,6 +397,8 @@ skip:
 restore_opts:
 	sbi->mount_opt = org_mount_opt;
 	sbi->active_logs = active_logs;
+	sbi->ipu_policy = ipu_policy;
+	sbi->min_ipu_util = min_ipu_util;
 	return err;
 }
 
@@ -603,6 +629,8 @@ static int f2fs_fill_super(struct super_block *sb, void *data, int silent)
 	sb->s_fs_info = sbi;
 	/* init some FS parameters */
 	sbi->active_logs = NR_CURSEG_TYPE;
+	sbi->ipu_policy = F2FS_IPU_FSYNC;
+	sbi->min_ipu_util = DEF_MIN_IPU_UTIL;
 
 	set_opt(sbi, BG_GC);
 
@@ -826,6 +854,9 @@ static int __init init_f2fs_fs(void)
 	if (err)
 		goto fail;
 	err = create_checkpoint_caches();
+	if (err)
+		goto fail;
+	err = create_extent_cache();
 	if (err)
 		goto fail;
 	err = register_filesystem(&f2fs_fs_type);
@@ -840,6 +871,7 @@ static void __exit exit_f2fs_fs(void)
 {
 	f2fs_destroy_root_stats();
 	unregister_filesystem(&f2fs_fs_type);
+	destroy_extent_cache();
 	destroy_checkpoint_caches();
 	destroy_gc_caches();
 	destroy_node_manager_caches();
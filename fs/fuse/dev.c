@@ -209,6 +209,9 @@ void fuse_put_request(struct fuse_conn *fc, struct fuse_req *req)
 		if (req->waiting)
 			atomic_dec(&fc->num_waiting);
 
+		if (req->passthrough_filp)
+			fput(req->passthrough_filp);
+
 		if (req->stolen_file)
 			put_reserved_req(fc, req);
 		else
@@ -238,18 +241,60 @@ static u64 fuse_get_unique(struct fuse_conn *fc)
 	return fc->reqctr;
 }
 
+static struct fuse_queue *fuse_local_queue(struct fuse_conn *fc)
+{
+	return &fc->queues[raw_smp_processor_id() % fc->num_queues];
+}
+
+/*
+ * Wake up one reader, preferably one sleeping on queue q.  If there is
+ * none, wake up a reader of another queue, who will steal the request.
+ *
+ * Readers add themselves to a queue and then check for requests without
+ * a lock; the barrier orders the caller's queueing of the request before
+ * the waitqueue_active() checks, pairing with set_current_state() in
+ * request_wait().
+ */
+static void fuse_wake_reader(struct fuse_conn *fc, struct fuse_queue *q)
+{
+	unsigned i;
+
+	smp_mb();
+	for (i = 0; !waitqueue_active(&q->waitq) && i < fc->num_queues; i++) {
+		if (waitqueue_active(&fc->queues[i].waitq))
+			q = &fc->queues[i];
+	}
+	wake_up(&q->waitq);
+	wake_up(&fc->waitq);
+	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+}
+
+void fuse_wake_up_readers(struct fuse_conn *fc)
+{
+	unsigned i;
+
+	for (i = 0; i < fc->num_queues; i++)
+		wake_up_all(&fc->queues[i].waitq);
+	wake_up_all(&fc->waitq);
+}
+
 static void queue_request(struct fuse_conn *fc, struct fuse_req *req)
 {
+	struct fuse_queue *q = fuse_local_queue(fc);
+
 	req->in.h.len = sizeof(struct fuse_in_header) +
 		len_args(req->in.numargs, (struct fuse_arg *) req->in.args);
-	list_add_tail(&req->list, &fc->pending);
+	req->queue = q;
+	spin_lock(&q->lock);
+	list_add_tail(&req->list, &q->pending);
+	q->queued++;
 	req->state = FUSE_REQ_PENDING;
+	spin_unlock(&q->lock);
 	if (!req->waiting) {
 		req->waiting = 1;
 		atomic_inc(&fc->num_waiting);
 	}
-	wake_up(&fc->waitq);
-	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+	fuse_wake_reader(fc, q);
 }
 
 void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
@@ -262,8 +307,7 @@ void fuse_queue_forget(struct fuse_conn *fc, struct fuse_forget_link *forget,
 	if (fc->connected) {
 		fc->forget_list_tail->next = forget;
 		fc->forget_list_tail = forget;
-		wake_up(&fc->waitq);
-		kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+		fuse_wake_reader(fc, fuse_local_queue(fc));
 	} else {
 		kfree(forget);
 	}
@@ -323,6 +367,24 @@ __releases(fc->lock)
 	fuse_put_request(fc, req);
 }
 
+/*
+ * Take a request that is still pending off its queue.  Returns false if
+ * a reader got to it first.  Called with fc->lock held.
+ */
+static bool unqueue_request(struct fuse_req *req)
+{
+	struct fuse_queue *q = req->queue;
+	bool pending;
+
+	spin_lock(&q->lock);
+	pending = req->state == FUSE_REQ_PENDING;
+	if (pending)
+		list_del(&req->list);
+	spin_unlock(&q->lock);
+
+	return pending;
+}
+
 static void wait_answer_interruptible(struct fuse_conn *fc,
 				      struct fuse_req *req)
 __releases(fc->lock)
@@ -339,8 +401,7 @@ __acquires(fc->lock)
 static void queue_interrupt(struct fuse_conn *fc, struct fuse_req *req)
 {
 	list_add_tail(&req->intr_entry, &fc->interrupts);
-	wake_up(&fc->waitq);
-	kill_fasync(&fc->fasync, SIGIO, POLL_IN);
+	fuse_wake_reader(fc, fuse_local_queue(fc));
 }
 
 static void request_wait_answer(struct fuse_conn *fc, struct fuse_req *req)
@@ -375,8 +436,7 @@ __acquires(fc->lock)
 			return;
 
 		/* Request is not yet in userspace, bail out */
-		if (req->state == FUSE_REQ_PENDING) {
-			list_del(&req->list);
+		if (req->state == FUSE_REQ_PENDING && unqueue_request(req)) {
 			__fuse_put_request(req);
 			req->out.h.error = -EINTR;
 			return;
@@ -915,31 +975,108 @@ static int forget_pending(struct fuse_conn *fc)
 	return fc->forget_list_head.next != NULL;
 }
 
+static int queues_pending(struct fuse_conn *fc)
+{
+	unsigned i;
+
+	for (i = 0; i < fc->num_queues; i++) {
+		if (!list_empty(&fc->queues[i].pending))
+			return 1;
+	}
+	return 0;
+}
+
 static int request_pending(struct fuse_conn *fc)
 {
-	return !list_empty(&fc->pending) || !list_empty(&fc->interrupts) ||
+	return queues_pending(fc) || !list_empty(&fc->interrupts) ||
 		forget_pending(fc);
 }
 
-/* Wait until a request is available on the pending list */
+/* Called with q->lock held and the queue not empty */
+static struct fuse_req *dequeue_from(struct fuse_queue *q)
+{
+	struct fuse_req *req;
+
+	req = list_entry(q->pending.next, struct fuse_req, list);
+	list_del_init(&req->list);
+	req->state = FUSE_REQ_READING;
+
+	return req;
+}
+
+/*
+ * Take the oldest request from the local queue.  After FUSE_LOCAL_BATCH
+ * requests in a row from it, or when it is empty, steal the oldest request
+ * of another queue instead.  Other queues are visited round-robin, so a
+ * queue without readers of its own is not starved by busy local queues.
+ * Only the queue locks are taken.  Returns NULL if all queues are empty.
+ */
+static struct fuse_req *dequeue_request(struct fuse_conn *fc)
+{
+	struct fuse_queue *local = fuse_local_queue(fc);
+	struct fuse_req *req = NULL;
+	struct fuse_queue *q;
+	unsigned i, idx, start;
+
+	spin_lock(&local->lock);
+	if (!list_empty(&local->pending) &&
+	    local->local_run < FUSE_LOCAL_BATCH) {
+		local->local_run++;
+		req = dequeue_from(local);
+	} else {
+		local->local_run = 0;
+	}
+	start = local->steal_next;
+	spin_unlock(&local->lock);
+	if (req)
+		return req;
+
+	for (i = 1; i <= fc->num_queues; i++) {
+		idx = (start + i) % fc->num_queues;
+		q = &fc->queues[idx];
+		if (q == local || list_empty(&q->pending))
+			continue;
+
+		spin_lock(&q->lock);
+		if (!list_empty(&q->pending)) {
+			q->stolen++;
+			req = dequeue_from(q);
+		}
+		spin_unlock(&q->lock);
+		if (req) {
+			local->steal_next = idx;
+			return req;
+		}
+	}
+
+	spin_lock(&local->lock);
+	if (!list_empty(&local->pending))
+		req = dequeue_from(local);
+	spin_unlock(&local->lock);
+
+	return req;
+}
+
+/*
+ * Wait until a request is available on one of the pending queues.  No
+ * lock is held, fuse_wake_reader() makes sure a queued request is seen.
+ */
 static void request_wait(struct fuse_conn *fc)
-__releases(fc->lock)
-__acquires(fc->lock)
 {
 	DECLARE_WAITQUEUE(wait, current);
+	struct fuse_queue *q = fuse_local_queue(fc);
 
-	add_wait_queue_exclusive(&fc->waitq, &wait);
-	while (fc->connected && !request_pending(fc)) {
+	add_wait_queue_exclusive(&q->waitq, &wait);
+	for (;;) {
 		set_current_state(TASK_INTERRUPTIBLE);
-		if (signal_pending(current))
+		if (!fc->connected || request_pending(fc) ||
+		    signal_pending(current))
 			break;
 
-		spin_unlock(&fc->lock);
 		schedule();
-		spin_lock(&fc->lock);
 	}
 	set_current_state(TASK_RUNNING);
-	remove_wait_queue(&fc->waitq, &wait);
+	remove_wait_queue(&q->waitq, &wait);
 }
 
 /*
@@ -1112,37 +1249,48 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 	unsigned reqsize;
 
  restart:
-	spin_lock(&fc->lock);
-	err = -EAGAIN;
 	if ((file->f_flags & O_NONBLOCK) && fc->connected &&
 	    !request_pending(fc))
-		goto err_unlock;
+		return -EAGAIN;
 
 	request_wait(fc);
-	err = -ENODEV;
 	if (!fc->connected)
-		goto err_unlock;
-	err = -ERESTARTSYS;
+		return -ENODEV;
 	if (!request_pending(fc))
-		goto err_unlock;
+		return -ERESTARTSYS;
 
-	if (!list_empty(&fc->interrupts)) {
-		req = list_entry(fc->interrupts.next, struct fuse_req,
-				 intr_entry);
-		return fuse_read_interrupt(fc, cs, nbytes, req);
-	}
+	/* Interrupts and forgets are under fc->lock, not on the queues */
+	if (!list_empty(&fc->interrupts) || forget_pending(fc)) {
+		spin_lock(&fc->lock);
+		if (!list_empty(&fc->interrupts)) {
+			req = list_entry(fc->interrupts.next, struct fuse_req,
+					 intr_entry);
+			return fuse_read_interrupt(fc, cs, nbytes, req);
+		}
 
-	if (forget_pending(fc)) {
-		if (list_empty(&fc->pending) || fc->forget_batch-- > 0)
-			return fuse_read_forget(fc, cs, nbytes);
+		if (forget_pending(fc)) {
+			if (!queues_pending(fc) || fc->forget_batch-- > 0)
+				return fuse_read_forget(fc, cs, nbytes);
 
-		if (fc->forget_batch <= -8)
-			fc->forget_batch = 16;
+			if (fc->forget_batch <= -8)
+				fc->forget_batch = 16;
+		}
+		spin_unlock(&fc->lock);
 	}
 
-	req = list_entry(fc->pending.next, struct fuse_req, list);
-	req->state = FUSE_REQ_READING;
-	list_move(&req->list, &fc->io);
+	/* Another reader may have taken it meanwhile */
+	req = dequeue_request(fc);
+	if (!req)
+		goto restart;
+
+	spin_lock(&fc->lock);
+	list_add(&req->list, &fc->io);
+	/* The connection was aborted after the request was dequeued */
+	if (!fc->connected) {
+		req->out.h.error = -ECONNABORTED;
+		request_end(fc, req);
+		return -ENODEV;
+	}
 
 	in = &req->in;
 	reqsize = in->h.len;
@@ -1183,10 +1331,6 @@ static ssize_t fuse_dev_do_read(struct fuse_conn *fc, struct file *file,
 		spin_unlock(&fc->lock);
 	}
 	return reqsize;
-
- err_unlock:
-	spin_unlock(&fc->lock);
-	return err;
 }
 
 static ssize_t fuse_dev_read(struct kiocb *iocb, const struct iovec *iov,
@@ -1726,6 +1870,8 @@ static ssize_t fuse_dev_do_write(struct fuse_conn *fc,
 
 	err = copy_out_args(cs, &req->out, nbytes);
 	fuse_copy_finish(cs);
+	if (!err)
+		fuse_passthrough_setup(fc, req);
 
 	spin_lock(&fc->lock);
 	req->locked = 0;
@@ -1914,9 +2060,23 @@ static void end_queued_requests(struct fuse_conn *fc)
 __releases(fc->lock)
 __acquires(fc->lock)
 {
+	LIST_HEAD(pending);
+	unsigned i;
+
 	fc->max_background = UINT_MAX;
 	flush_bg_queue(fc);
-	end_requests(fc, &fc->pending);
+	/*
+	 * Once off the queues, the requests are only unlinked under
+	 * fc->lock, by end_requests() or by unqueue_request().
+	 */
+	for (i = 0; i < fc->num_queues; i++) {
+		struct fuse_queue *q = &fc->queues[i];
+
+		spin_lock(&q->lock);
+		list_splice_tail_init(&q->pending, &pending);
+		spin_unlock(&q->lock);
+	}
+	end_requests(fc, &pending);
 	end_requests(fc, &fc->processing);
 	while (forget_pending(fc))
 		kfree(dequeue_forget(fc, 1, NULL));
@@ -1965,7 +2125,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		end_io_requests(fc);
 		end_queued_requests(fc);
 		end_polls(fc);
-		wake_up_all(&fc->waitq);
+		fuse_wake_up_readers(fc);
 		wake_up_all(&fc->blocked_waitq);
 		kill_fasync(&fc->fasync, SIGIO, POLL_IN);
 	}
@@ -2001,6 +2161,26 @@ static int fuse_dev_fasync(int fd, struct file *file, int on)
 	return fasync_helper(fd, file, on, &fc->fasync);
 }
 
+static long fuse_dev_ioctl(struct file *file, unsigned int cmd,
+			   unsigned long arg)
+{
+	struct fuse_passthrough_out pto;
+	struct fuse_conn *fc = fuse_get_conn(file);
+	if (!fc)
+		return -EPERM;
+
+	switch (cmd) {
+	case FUSE_DEV_IOC_PASSTHROUGH_OPEN:
+		if (copy_from_user(&pto, (void __user *)arg, sizeof(pto)))
+			return -EFAULT;
+		if (pto.flags)
+			return -EINVAL;
+		return fuse_passthrough_register(fc, pto.fd);
+	default:
+		return -ENOTTY;
+	}
+}
+
 const struct file_operations fuse_dev_operations = {
 	.owner		= THIS_MODULE,
 	.llseek		= no_llseek,
@@ -2013,6 +2193,8 @@ const struct file_operations fuse_dev_operations = {
 	.poll		= fuse_dev_poll,
 	.release	= fuse_dev_release,
 	.fasync		= fuse_dev_fasync,
+	.unlocked_ioctl	= fuse_dev_ioctl,
+	.compat_ioctl	= fuse_dev_ioctl,
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
@@ -22,10 +22,14 @@
 #include <linux/rbtree.h>
 #include <linux/poll.h>
 #include <linux/workqueue.h>
+#include <linux/idr.h>
 
 /** Max number of pages that can be used in a single read request */
 #define FUSE_MAX_PAGES_PER_REQ 32
 
+/** Magic number of fuse superblocks */
+#define FUSE_SUPER_MAGIC 0x65735546
+
 /** Bias for fi->writectr, meaning new writepages must not be sent */
 #define FUSE_NOWRITE INT_MIN
 
@@ -33,7 +37,13 @@
 #define FUSE_NAME_MAX 1024
 
 /** Number of dentries for each connection in the control filesystem */
-#define FUSE_CTL_NUM_DENTRIES 5
+#define FUSE_CTL_NUM_DENTRIES 6
+
+/** Maximum number of pending request queues per connection */
+#define FUSE_MAX_QUEUES 8
+
+/** Requests a reader takes from its own queue before serving another one */
+#define FUSE_LOCAL_BATCH 16
 
 /** If the FUSE_DEFAULT_PERMISSIONS flag is given, the filesystem
     module will check permissions based on the file mode.  Otherwise no
@@ -130,6 +140,9 @@ struct fuse_file {
 	/** FOPEN_* flags returned by open */
 	u32 open_flags;
 
+	/** Lower file that read, write and mmap are passed to or NULL */
+	struct file *passthrough_filp;
+
 	/** Entry on inode's write_files list */
 	struct list_head write_entry;
 
@@ -310,6 +323,49 @@ struct fuse_req {
 
 	/** Request is stolen from fuse_file->reserved_req */
 	struct file *stolen_file;
+
+	/** Passthrough file taken from an OPEN or CREATE reply */
+	struct file *passthrough_filp;
+
+	/** Pending queue the request was put on */
+	struct fuse_queue *queue;
+};
+
+/**
+ * A queue of requests waiting to be read by the userspace filesystem.
+ *
+ * Requests are queued on the queue of the submitting CPU and a reader
+ * takes from the queue of the CPU it runs on first, so with a
+ * multi-threaded daemon a request usually goes to a thread on the same
+ * CPU and only a reader sleeping on that queue is woken.  Every
+ * FUSE_LOCAL_BATCH requests a reader serves another queue, bounding how
+ * long requests on other queues can be overtaken.
+ *
+ * The pending list is protected by the queue's own lock, so readers
+ * waiting for and taking requests do not contend on fuse_conn->lock.
+ * When both are needed, fuse_conn->lock is taken first.
+ */
+struct fuse_queue {
+	/** Protects the pending list and the counters below */
+	spinlock_t lock;
+
+	/** Readers preferring this queue sleep here */
+	wait_queue_head_t waitq;
+
+	/** The list of pending requests */
+	struct list_head pending;
+
+	/** Number of requests queued here */
+	unsigned long queued;
+
+	/** Number of requests taken from here by readers of another queue */
+	unsigned long stolen;
+
+	/** Requests taken in a row from this queue by its own readers */
+	unsigned local_run;
+
+	/** Queue last stolen from by readers of this queue, only a hint */
+	unsigned steal_next;
 };
 
 /**
@@ -344,11 +400,14 @@ struct fuse_conn {
 	/** Maximum write size */
 	unsigned max_write;
 
-	/** Readers of the connection are waiting on this */
+	/** Pollers of the connection are waiting on this */
 	wait_queue_head_t waitq;
 
-	/** The list of pending requests */
-	struct list_head pending;
+	/** Pending request queues */
+	struct fuse_queue queues[FUSE_MAX_QUEUES];
+
+	/** Number of queues in use */
+	unsigned num_queues;
 
 	/** The list of requests being processed */
 	struct list_head processing;
@@ -362,6 +421,9 @@ struct fuse_conn {
 	/** rbtree of fuse_files waiting for poll events indexed by ph */
 	struct rb_root polled_files;
 
+	/** Passthrough files registered by the daemon, not yet opened */
+	struct idr passthrough_idr;
+
 	/** Maximum number of outstanding background requests */
 	unsigned max_background;
 
@@ -475,6 +537,7 @@ struct fuse_conn {
 	/** Don't apply umask to creation modes */
 	unsigned dont_mask:1;
 
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -686,6 +749,11 @@ void fuse_request_send_background_locked(struct fuse_conn *fc,
 /* Abort all requests */
 void fuse_abort_conn(struct fuse_conn *fc);
 
+/**
+ * Wake up everybody waiting for requests on the connection
+ */
+void fuse_wake_up_readers(struct fuse_conn *fc);
+
 /**
  * Invalidate inode attributes
  */
@@ -766,4 +834,18 @@ int fuse_dev_release(struct inode *inode, struct file *file);
 
 void fuse_write_update_size(struct inode *inode, loff_t pos);
 
+/**
+ * Passthrough of read, write and mmap to a file opened by the daemon
+ */
+int fuse_passthrough_register(struct fuse_conn *fc, unsigned int fd);
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_req *req);
+void fuse_passthrough_conn_release(struct fuse_conn *fc);
+void fuse_passthrough_open(struct file *file);
+void fuse_passthrough_release(struct fuse_file *ff);
+ssize_t fuse_passthrough_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos);
+ssize_t fuse_passthrough_aio_write(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos);
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma);
+
 #endif /* _FS_FUSE_I_H */
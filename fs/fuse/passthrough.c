@@ -0,0 +1,227 @@
+/*
+  FUSE: Filesystem in Userspace
+  Copyright (C) 2001-2008  Miklos Szeredi <miklos@szeredi.hu>
+
+  This program can be distributed under the terms of the GNU GPL.
+  See the file COPYING.
+*/
+
+#include "fuse_i.h"
+
+#include <linux/capability.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/uio.h>
+
+/*
+ * A filesystem that only relays data to and from files it has opened
+ * itself can register such a file with the FUSE_DEV_IOC_PASSTHROUGH_OPEN
+ * ioctl and reply to OPEN or CREATE with the returned id in
+ * passthrough_id.  Reads, writes and mmaps of the fuse file are then
+ * performed on that lower file directly, without a round trip to
+ * userspace and without using the fuse page cache.  All other operations
+ * (lookup, getattr, setattr, flush, fsync, release, ...) still go to the
+ * filesystem.
+ *
+ * The file is looked up in the ioctl, by a caller that has to have
+ * CAP_SYS_ADMIN, rather than while a reply is written: anybody the fuse
+ * device is passed to can write replies, and would otherwise have its
+ * own open files attached to fuse files.
+ *
+ * Like vfs_read() and vfs_write() would, each read and write checks the
+ * lower file's mandatory locks and security_file_permission() first.
+ */
+
+int fuse_passthrough_register(struct fuse_conn *fc, unsigned int fd)
+{
+	struct file *lower;
+	struct inode *inode;
+	int id, err;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+
+	lower = fget(fd);
+	if (!lower)
+		return -EBADF;
+
+	inode = lower->f_dentry->d_inode;
+	err = -EINVAL;
+	if (!S_ISREG(inode->i_mode) || !lower->f_op ||
+	    !lower->f_op->aio_read || !lower->f_op->aio_write ||
+	    (lower->f_flags & O_DIRECT) ||
+	    inode->i_sb->s_magic == FUSE_SUPER_MAGIC)
+		goto out_fput;
+
+	do {
+		err = -ENOMEM;
+		if (!idr_pre_get(&fc->passthrough_idr, GFP_KERNEL))
+			goto out_fput;
+		spin_lock(&fc->lock);
+		err = idr_get_new_above(&fc->passthrough_idr, lower, 1, &id);
+		spin_unlock(&fc->lock);
+	} while (err == -EAGAIN);
+	if (err)
+		goto out_fput;
+
+	return id;
+
+ out_fput:
+	fput(lower);
+	return err;
+}
+
+static struct fuse_open_out *fuse_passthrough_outarg(struct fuse_req *req)
+{
+	switch (req->in.h.opcode) {
+	case FUSE_OPEN:
+		return req->out.args[0].value;
+	case FUSE_CREATE:
+		return req->out.args[1].value;
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Called with the reply to a request copied in.  The registered file is
+ * handed over to the request; an unknown id is not an error, the file is
+ * simply opened without passthrough.
+ */
+void fuse_passthrough_setup(struct fuse_conn *fc, struct fuse_req *req)
+{
+	struct fuse_open_out *outarg;
+	u32 id;
+
+	if (req->out.h.error)
+		return;
+
+	outarg = fuse_passthrough_outarg(req);
+	if (!outarg || !outarg->passthrough_id)
+		return;
+
+	id = outarg->passthrough_id;
+	outarg->passthrough_id = 0;
+	if (id > INT_MAX)
+		return;
+
+	spin_lock(&fc->lock);
+	req->passthrough_filp = idr_find(&fc->passthrough_idr, id);
+	if (req->passthrough_filp)
+		idr_remove(&fc->passthrough_idr, id);
+	spin_unlock(&fc->lock);
+}
+
+static int fuse_passthrough_put(int id, void *p, void *data)
+{
+	fput(p);
+	return 0;
+}
+
+/* Drop the files that were registered but never named in a reply */
+void fuse_passthrough_conn_release(struct fuse_conn *fc)
+{
+	idr_for_each(&fc->passthrough_idr, fuse_passthrough_put, NULL);
+	idr_remove_all(&fc->passthrough_idr);
+	idr_destroy(&fc->passthrough_idr);
+}
+
+/*
+ * Keep the passthrough file only if it can serve every access the fuse
+ * file was opened for.  The lower file's O_APPEND decides where writes
+ * go, so it has to agree with the fuse file's.
+ */
+void fuse_passthrough_open(struct file *file)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *lower = ff->passthrough_filp;
+
+	if (!lower)
+		return;
+
+	if (((file->f_mode & FMODE_READ) && !(lower->f_mode & FMODE_READ)) ||
+	    ((file->f_mode & FMODE_WRITE) && !(lower->f_mode & FMODE_WRITE)) ||
+	    (file->f_flags & O_APPEND) != (lower->f_flags & O_APPEND))
+		fuse_passthrough_release(ff);
+}
+
+void fuse_passthrough_release(struct fuse_file *ff)
+{
+	if (ff->passthrough_filp) {
+		fput(ff->passthrough_filp);
+		ff->passthrough_filp = NULL;
+	}
+}
+
+ssize_t fuse_passthrough_aio_read(struct kiocb *iocb, const struct iovec *iov,
+				  unsigned long nr_segs, loff_t pos)
+{
+	struct file *file = iocb->ki_filp;
+	struct fuse_file *ff = file->private_data;
+	struct file *lower = ff->passthrough_filp;
+	ssize_t ret;
+
+	ret = rw_verify_area(READ, lower, &pos, iov_length(iov, nr_segs));
+	if (ret < 0)
+		return ret;
+
+	iocb->ki_filp = lower;
+	ret = lower->f_op->aio_read(iocb, iov, nr_segs, pos);
+	iocb->ki_filp = file;
+
+	return ret;
+}
+
+ssize_t fuse_passthrough_aio_write(struct kiocb *iocb, const struct iovec *iov,
+				   unsigned long nr_segs, loff_t pos)
+{
+	struct file *file = iocb->ki_filp;
+	struct inode *inode = file->f_mapping->host;
+	struct fuse_file *ff = file->private_data;
+	struct file *lower = ff->passthrough_filp;
+	ssize_t ret;
+
+	ret = rw_verify_area(WRITE, lower, &pos, iov_length(iov, nr_segs));
+	if (ret < 0)
+		return ret;
+
+	mutex_lock(&inode->i_mutex);
+	iocb->ki_filp = lower;
+	ret = lower->f_op->aio_write(iocb, iov, nr_segs, pos);
+	iocb->ki_filp = file;
+	if (ret > 0)
+		fuse_write_update_size(inode, iocb->ki_pos);
+	mutex_unlock(&inode->i_mutex);
+
+	fuse_invalidate_attr(inode);
+
+	return ret;
+}
+
+/*
+ * The vma is handed over to the lower file, so faults and writeback never
+ * see the fuse inode.
+ */
+int fuse_passthrough_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct fuse_file *ff = file->private_data;
+	struct file *lower = ff->passthrough_filp;
+	int err;
+
+	if (!lower->f_op->mmap)
+		return -ENODEV;
+
+	get_file(lower);
+	vma->vm_file = lower;
+	err = lower->f_op->mmap(lower, vma);
+	if (err) {
+		vma->vm_file = file;
+		fput(lower);
+		return err;
+	}
+	fput(file);
+	file_accessed(file);
+
+	return 0;
+}
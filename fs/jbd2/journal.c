@@ -662,6 +662,59 @@ int jbd2_log_wait_commit(journal_t *journal, tid_t tid)
 	return err;
 }
 
+/*
+ * Commit the transaction @tid and wait for it on behalf of a synchronous
+ * operation such as fsync.  If @tid is still running, the commit is
+ * batched with other synchronous operations by jbd2_sync_batch().
+ */
+int jbd2_complete_transaction(journal_t *journal, tid_t tid)
+{
+	ktime_t start = ktime_get();
+	ktime_t t_start_time = ktime_set(0, 0);
+	transaction_t *transaction;
+	int running = 0;
+	int err;
+
+	read_lock(&journal->j_state_lock);
+	transaction = journal->j_running_transaction;
+	if (transaction && transaction->t_tid == tid) {
+		atomic_inc(&transaction->t_sync_waiters);
+		t_start_time = transaction->t_start_time;
+		running = 1;
+	} else {
+		transaction = journal->j_committing_transaction;
+		if (transaction && transaction->t_tid == tid)
+			atomic_inc(&transaction->t_sync_waiters);
+	}
+	read_unlock(&journal->j_state_lock);
+
+	if (running)
+		jbd2_sync_batch(journal, t_start_time);
+
+	jbd2_log_start_commit(journal, tid);
+	err = jbd2_log_wait_commit(journal, tid);
+	jbd2_account_sync(journal, start);
+
+	return err;
+}
+EXPORT_SYMBOL(jbd2_complete_transaction);
+
+/*
+ * Account a synchronous operation that started at @start and whose
+ * commit has just completed.
+ */
+void jbd2_account_sync(journal_t *journal, ktime_t start)
+{
+	u64 latency = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	spin_lock(&journal->j_history_lock);
+	journal->j_stats.ts_sync_count++;
+	journal->j_stats.ts_sync_time += latency;
+	if (latency > journal->j_stats.ts_sync_max)
+		journal->j_stats.ts_sync_max = latency;
+	spin_unlock(&journal->j_history_lock);
+}
+
 /*
  * Log buffer allocation routines:
  */
@@ -790,6 +843,23 @@ static int jbd2_seq_info_show(struct seq_file *seq, void *v)
 	    s->stats->run.rs_blocks / s->stats->ts_tid);
 	seq_printf(seq, "  %lu logged blocks per transaction\n",
 	    s->stats->run.rs_blocks_logged / s->stats->ts_tid);
+	if (s->stats->ts_sync_commits)
+		seq_printf(seq, "  %lu sync waiters per synchronous commit\n",
+		    s->stats->run.rs_sync_waiters / s->stats->ts_sync_commits);
+	if (!s->stats->ts_sync_count)
+		return 0;
+	seq_printf(seq, "%lu synchronous operations, %lu commits\n",
+		   s->stats->ts_sync_count, s->stats->ts_sync_commits);
+	seq_printf(seq, "  %lluus average sync latency\n",
+		   div_u64(div_u64(s->stats->ts_sync_time,
+			   s->stats->ts_sync_count), 1000));
+	seq_printf(seq, "  %lluus maximum sync latency\n",
+		   div_u64(s->stats->ts_sync_max, 1000));
+	seq_printf(seq, "  %lluus average batching hold\n",
+		   div_u64(div_u64(s->stats->ts_sync_hold,
+			   s->stats->ts_sync_count), 1000));
+	seq_printf(seq, "  %lluus average sync arrival interval\n",
+		   div_u64(s->journal->j_average_sync_interval, 1000));
 	return 0;
 }
 
@@ -59,6 +59,7 @@ jbd2_get_transaction(journal_t *journal, transaction_t *transaction)
 	atomic_set(&transaction->t_updates, 0);
 	atomic_set(&transaction->t_outstanding_credits, 0);
 	atomic_set(&transaction->t_handle_count, 0);
+	atomic_set(&transaction->t_sync_waiters, 0);
 	INIT_LIST_HEAD(&transaction->t_inode_list);
 	INIT_LIST_HEAD(&transaction->t_private_list);
 
@@ -1270,6 +1271,71 @@ drop:
 	return err;
 }
 
+/*
+ * Adaptive batching of synchronous operations.
+ *
+ * Every synchronous operation (a sync handle, or an fsync waiting for the
+ * running transaction) folds the time since the previous one into a
+ * running average of the sync arrival interval.  When syncers arrive
+ * faster than the journal commits, holding the transaction open for a
+ * couple of arrival intervals lets the next ones join this commit instead
+ * of forcing their own.  Holding it longer than one commit time never
+ * pays: a syncer arriving after that is absorbed by the next commit
+ * anyway.  A single stream of syncs, whose arrivals are always slower
+ * than commits, doesn't wait unless min_batch_time asks for it, which
+ * replaces the old "same pid as the last sync writer" heuristic for
+ * that case; that heuristic is still applied on top.
+ *
+ * Sleeps until the transaction started at @t_start_time is old enough.
+ * The caller must make sure the transaction stays around, or not care
+ * if it has been committed in the meantime.
+ */
+void jbd2_sync_batch(journal_t *journal, ktime_t t_start_time)
+{
+	ktime_t now = ktime_get();
+	u64 interval, commit_time, hold, trans_time;
+	pid_t pid = current->pid;
+
+	spin_lock(&journal->j_history_lock);
+	interval = ktime_to_ns(ktime_sub(now, journal->j_last_sync_time));
+	interval = min_t(u64, interval, JBD2_SYNC_INTERVAL_MAX);
+	journal->j_last_sync_time = now;
+	if (likely(journal->j_average_sync_interval))
+		journal->j_average_sync_interval = (interval +
+				journal->j_average_sync_interval*3) / 4;
+	else
+		journal->j_average_sync_interval = interval;
+	interval = journal->j_average_sync_interval;
+	spin_unlock(&journal->j_history_lock);
+
+	if (journal->j_last_sync_writer == pid)
+		return;
+	journal->j_last_sync_writer = pid;
+
+	read_lock(&journal->j_state_lock);
+	commit_time = journal->j_average_commit_time;
+	read_unlock(&journal->j_state_lock);
+
+	hold = 0;
+	if (interval < commit_time)
+		hold = min_t(u64, commit_time,
+			     JBD2_SYNC_BATCH_INTERVALS * interval);
+	hold = max_t(u64, hold, 1000*journal->j_min_batch_time);
+	hold = min_t(u64, hold, 1000*journal->j_max_batch_time);
+
+	trans_time = ktime_to_ns(ktime_sub(now, t_start_time));
+	if (trans_time < hold) {
+		ktime_t expires = ktime_add_ns(now, hold - trans_time);
+
+		set_current_state(TASK_UNINTERRUPTIBLE);
+		schedule_hrtimeout(&expires, HRTIMER_MODE_ABS);
+
+		spin_lock(&journal->j_history_lock);
+		journal->j_stats.ts_sync_hold += hold - trans_time;
+		spin_unlock(&journal->j_history_lock);
+	}
+}
+
 /**
  * int jbd2_journal_stop() - complete a transaction
  * @handle: tranaction to complete.
@@ -1292,7 +1358,7 @@ int jbd2_journal_stop(handle_t *handle)
 	journal_t *journal = transaction->t_journal;
 	int err, wait_for_commit = 0;
 	tid_t tid;
-	pid_t pid;
+	ktime_t sync_start = ktime_set(0, 0);
 
 	J_ASSERT(journal_current_handle() == handle);
 
@@ -1320,48 +1386,14 @@ int jbd2_journal_stop(handle_t *handle)
 	 * and sleep on IO anyway.  Speeds up many-threaded, many-dir
 	 * operations by 30x or more...
 	 *
-	 * We try and optimize the sleep time against what the
-	 * underlying disk can do, instead of having a static sleep
-	 * time.  This is useful for the case where our storage is so
-	 * fast that it is more optimal to go ahead and force a flush
-	 * and wait for the transaction to be committed than it is to
-	 * wait for an arbitrary amount of time for new writers to
-	 * join the transaction.  We achieve this by measuring how
-	 * long it takes to commit a transaction, and compare it with
-	 * how long this transaction has been running, and if run time
-	 * < commit time then we sleep for the delta and commit.  This
-	 * greatly helps super fast disks that would see slowdowns as
-	 * more threads started doing fsyncs.
-	 *
-	 * But don't do this if this process was the most recent one
-	 * to perform a synchronous write.  We do this to detect the
-	 * case where a single process is doing a stream of sync
-	 * writes.  No point in waiting for joiners in that case.
+	 * How long to wait is decided by jbd2_sync_batch() from the
+	 * measured commit time and the rate at which synchronous
+	 * operations arrive.
 	 */
-	pid = current->pid;
-	if (handle->h_sync && journal->j_last_sync_writer != pid) {
-		u64 commit_time, trans_time;
-
-		journal->j_last_sync_writer = pid;
-
-		read_lock(&journal->j_state_lock);
-		commit_time = journal->j_average_commit_time;
-		read_unlock(&journal->j_state_lock);
-
-		trans_time = ktime_to_ns(ktime_sub(ktime_get(),
-						   transaction->t_start_time));
-
-		commit_time = max_t(u64, commit_time,
-				    1000*journal->j_min_batch_time);
-		commit_time = min_t(u64, commit_time,
-				    1000*journal->j_max_batch_time);
-
-		if (trans_time < commit_time) {
-			ktime_t expires = ktime_add_ns(ktime_get(),
-						       commit_time);
-			set_current_state(TASK_UNINTERRUPTIBLE);
-			schedule_hrtimeout(&expires, HRTIMER_MODE_ABS);
-		}
+	if (handle->h_sync) {
+		sync_start = ktime_get();
+		atomic_inc(&transaction->t_sync_waiters);
+		jbd2_sync_batch(journal, transaction->t_start_time);
 	}
 
 	if (handle->h_sync)
@@ -1410,8 +1442,10 @@ int jbd2_journal_stop(handle_t *handle)
 			wake_up(&journal->j_wait_transaction_locked);
 	}
 
-	if (wait_for_commit)
+	if (wait_for_commit) {
 		err = jbd2_log_wait_commit(journal, tid);
+		jbd2_account_sync(journal, sync_start);
+	}
 
 	lock_map_release(&handle->h_lockdep_map);
 
@@ -538,10 +538,12 @@ static int complete_walk(struct nameidata *nd)
 		spin_lock(&dentry->d_lock);
 		if (unlikely(!__d_rcu_to_refcount(dentry, nd->seq))) {
 			spin_unlock(&dentry->d_lock);
+			sb_lookup_stat_inc(dentry->d_sb, fallback[LOOKUP_FB_SEQ]);
 			rcu_read_unlock();
 			br_read_unlock(vfsmount_lock);
 			return -ECHILD;
 		}
+		sb_lookup_stat_inc(dentry->d_sb, rcu_walks);
 		BUG_ON(nd->inode != dentry->d_inode);
 		spin_unlock(&dentry->d_lock);
 		mntget(nd->path.mnt);
@@ -1013,6 +1015,7 @@ static int follow_dotdot_rcu(struct nameidata *nd)
 	return 0;
 
 failed:
+	sb_lookup_stat_inc(nd->path.dentry->d_sb, fallback[LOOKUP_FB_SEQ]);
 	nd->flags &= ~LOOKUP_RCU;
 	if (!(nd->flags & LOOKUP_ROOT))
 		nd->root.mnt = NULL;
@@ -1160,36 +1163,51 @@ static int do_lookup(struct nameidata *nd, struct qstr *name,
 	 */
 	if (nd->flags & LOOKUP_RCU) {
 		unsigned seq;
+		int reason = LOOKUP_FB_MISS;
 		*inode = nd->inode;
 		dentry = __d_lookup_rcu(parent, name, &seq, inode);
 		if (!dentry)
 			goto unlazy;
 
 		/* Memory barrier in read_seqcount_begin of child is enough */
-		if (__read_seqcount_retry(&parent->d_seq, nd->seq))
+		if (__read_seqcount_retry(&parent->d_seq, nd->seq)) {
+			sb_lookup_stat_inc(parent->d_sb,
+					   fallback[LOOKUP_FB_SEQ]);
 			return -ECHILD;
+		}
 		nd->seq = seq;
+		sb_lookup_stat_inc(parent->d_sb, d_hits);
 
 		if (unlikely(dentry->d_flags & DCACHE_OP_REVALIDATE)) {
 			status = d_revalidate(dentry, nd);
 			if (unlikely(status <= 0)) {
 				if (status != -ECHILD)
 					need_reval = 0;
+				reason = LOOKUP_FB_REVALIDATE;
 				goto unlazy;
 			}
 		}
 		path->mnt = mnt;
 		path->dentry = dentry;
+		reason = LOOKUP_FB_MOUNT;
 		if (unlikely(!__follow_mount_rcu(nd, path, inode)))
 			goto unlazy;
 		if (unlikely(path->dentry->d_flags & DCACHE_NEED_AUTOMOUNT))
 			goto unlazy;
+		if (!*inode)
+			sb_lookup_stat_inc(parent->d_sb, d_neg_hits);
 		return 0;
 unlazy:
+		sb_lookup_stat_inc(parent->d_sb, fallback[reason]);
 		if (unlazy_walk(nd, dentry))
 			return -ECHILD;
 	} else {
 		dentry = __d_lookup(parent, name);
+		if (dentry) {
+			sb_lookup_stat_inc(parent->d_sb, d_hits);
+			if (!dentry->d_inode)
+				sb_lookup_stat_inc(parent->d_sb, d_neg_hits);
+		}
 	}
 
 retry:
@@ -1200,6 +1218,7 @@ retry:
 		mutex_lock(&dir->i_mutex);
 		dentry = d_lookup(parent, name);
 		if (likely(!dentry)) {
+			sb_lookup_stat_inc(parent->d_sb, d_misses);
 			dentry = d_alloc_and_lookup(parent, name, nd);
 			if (IS_ERR(dentry)) {
 				mutex_unlock(&dir->i_mutex);
@@ -1245,6 +1264,8 @@ static inline int may_lookup(struct nameidata *nd)
 		int err = exec_permission(nd->inode, IPERM_FLAG_RCU);
 		if (err != -ECHILD)
 			return err;
+		sb_lookup_stat_inc(nd->inode->i_sb,
+				   fallback[LOOKUP_FB_PERMISSION]);
 		if (unlazy_walk(nd, NULL))
 			return -ECHILD;
 	}
@@ -1294,12 +1315,17 @@ static inline int walk_component(struct nameidata *nd, struct path *path,
 		return err;
 	}
 	if (!inode) {
+		/* a negative dentry ends the walk without leaving rcu-walk */
+		if (nd->flags & LOOKUP_RCU)
+			sb_lookup_stat_inc(path->dentry->d_sb, rcu_walks);
 		path_to_nameidata(path, nd);
 		terminate_walk(nd);
 		return -ENOENT;
 	}
 	if (unlikely(inode->i_op->follow_link) && follow) {
 		if (nd->flags & LOOKUP_RCU) {
+			sb_lookup_stat_inc(path->dentry->d_sb,
+					   fallback[LOOKUP_FB_SYMLINK]);
 			if (unlikely(unlazy_walk(nd, path->dentry))) {
 				terminate_walk(nd);
 				return -ECHILD;
@@ -72,11 +72,22 @@ static struct super_block *alloc_super(struct file_system_type *type)
 #else
 		INIT_LIST_HEAD(&s->s_files);
 #endif
+		s->s_lookup_stats = alloc_percpu(struct lookup_stats);
+		if (!s->s_lookup_stats) {
+#ifdef CONFIG_SMP
+			free_percpu(s->s_files);
+#endif
+			security_sb_free(s);
+			kfree(s);
+			s = NULL;
+			goto out;
+		}
 		s->s_bdi = &default_backing_dev_info;
 		INIT_LIST_HEAD(&s->s_instances);
 		INIT_HLIST_BL_HEAD(&s->s_anon);
 		INIT_LIST_HEAD(&s->s_inodes);
 		INIT_LIST_HEAD(&s->s_dentry_lru);
+		INIT_LIST_HEAD(&s->s_dentry_neg_lru);
 		init_rwsem(&s->s_umount);
 		mutex_init(&s->s_lock);
 		lockdep_set_class(&s->s_umount, &type->s_umount_key);
@@ -130,6 +141,7 @@ static inline void destroy_super(struct super_block *s)
 #ifdef CONFIG_SMP
 	free_percpu(s->s_files);
 #endif
+	free_percpu(s->s_lookup_stats);
 	security_sb_free(s);
 	kfree(s->s_subtype);
 	kfree(s->s_options);
@@ -62,6 +62,12 @@ void yaffs_free_raw_obj(struct yaffs_dev *dev, struct yaffs_obj *obj)
 	kfree(obj);
 }
 
+void yaffs_allocator_set_bulk(struct yaffs_dev *dev, int bulk)
+{
+	dev = dev;
+	bulk = bulk;
+}
+
 #else
 
 struct yaffs_tnode_list {
@@ -74,7 +80,19 @@ struct yaffs_obj_list {
 	struct yaffs_obj *objects;
 };
 
+/*
+ * While bulk is set (during mount) each new batch of tnodes or objects is
+ * twice the size of the last, up to YAFFS_ALLOCATION_BULK_BYTES, so that
+ * building the tree for a large image costs a handful of allocations
+ * rather than one per hundred items.
+ */
+#define YAFFS_ALLOCATION_BULK_BYTES	(8 * PAGE_SIZE)
+
 struct yaffs_allocator {
+	int bulk;
+	int tnode_batch;
+	int obj_batch;
+
 	int n_tnodes_created;
 	struct yaffs_tnode *free_tnodes;
 	int n_free_tnodes;
@@ -87,6 +105,26 @@ struct yaffs_allocator {
 	struct yaffs_obj_list *allocated_obj_list;
 };
 
+static int yaffs_next_batch(int batch, int item_size)
+{
+	int max_batch = YAFFS_ALLOCATION_BULK_BYTES / item_size;
+
+	batch *= 2;
+	return (batch > max_batch) ? max_batch : batch;
+}
+
+void yaffs_allocator_set_bulk(struct yaffs_dev *dev, int bulk)
+{
+	struct yaffs_allocator *allocator = dev->allocator;
+
+	if (!allocator)
+		return;
+
+	allocator->bulk = bulk;
+	allocator->tnode_batch = YAFFS_ALLOCATION_NTNODES;
+	allocator->obj_batch = YAFFS_ALLOCATION_NOBJECTS;
+}
+
 static void yaffs_deinit_raw_tnodes(struct yaffs_dev *dev)
 {
 
@@ -205,6 +243,11 @@ struct yaffs_tnode *yaffs_alloc_raw_tnode(struct yaffs_dev *dev)
 	}
 
 	/* If there are none left make more */
+	if (!allocator->free_tnodes && allocator->bulk) {
+		yaffs_create_tnodes(dev, allocator->tnode_batch);
+		allocator->tnode_batch =
+		    yaffs_next_batch(allocator->tnode_batch, dev->tnode_size);
+	}
 	if (!allocator->free_tnodes)
 		yaffs_create_tnodes(dev, YAFFS_ALLOCATION_NTNODES);
 
@@ -336,6 +379,12 @@ struct yaffs_obj *yaffs_alloc_raw_obj(struct yaffs_dev *dev)
 	}
 
 	/* If there are none left make more */
+	if (!allocator->free_objs && allocator->bulk) {
+		yaffs_create_free_objs(dev, allocator->obj_batch);
+		allocator->obj_batch =
+		    yaffs_next_batch(allocator->obj_batch,
+				     sizeof(struct yaffs_obj));
+	}
 	if (!allocator->free_objs)
 		yaffs_create_free_objs(dev, YAFFS_ALLOCATION_NOBJECTS);
 
@@ -385,6 +434,7 @@ void yaffs_init_raw_tnodes_and_objs(struct yaffs_dev *dev)
 		allocator = kmalloc(sizeof(struct yaffs_allocator), GFP_NOFS);
 		if (allocator) {
 			dev->allocator = allocator;
+			yaffs_allocator_set_bulk(dev, 0);
 			yaffs_init_raw_tnodes(dev);
 			yaffs_init_raw_objs(dev);
 		}
@@ -27,4 +27,6 @@ void yaffs_free_raw_tnode(struct yaffs_dev *dev, struct yaffs_tnode *tn);
 struct yaffs_obj *yaffs_alloc_raw_obj(struct yaffs_dev *dev);
 void yaffs_free_raw_obj(struct yaffs_dev *dev, struct yaffs_obj *obj);
 
+void yaffs_allocator_set_bulk(struct yaffs_dev *dev, int bulk);
+
 #endif
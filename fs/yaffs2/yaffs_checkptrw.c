@@ -13,6 +13,10 @@
 
 #include "yaffs_checkptrw.h"
 #include "yaffs_getblockinfo.h"
+#include "yaffs_nand.h"
+
+/* Checkpoint chunks fetched per multi-chunk read when restoring */
+#define YAFFS_CHECKPT_RA_CHUNKS	16
 
 static int yaffs2_checkpt_space_ok(struct yaffs_dev *dev)
 {
@@ -184,6 +188,17 @@ int yaffs2_checkpt_open(struct yaffs_dev *dev, int writing)
 
 		for (i = 0; i < dev->checkpt_max_blocks; i++)
 			dev->checkpt_block_list[i] = -1;
+
+		/* Readahead is an optimisation, carry on without it */
+		dev->checkpt_ra_count = 0;
+		if (dev->param.read_chunks_tags_fn) {
+			dev->checkpt_ra_buffer =
+			    kmalloc(YAFFS_CHECKPT_RA_CHUNKS *
+				    dev->data_bytes_per_chunk, GFP_NOFS);
+			dev->checkpt_ra_tags =
+			    kmalloc(YAFFS_CHECKPT_RA_CHUNKS *
+				    sizeof(struct yaffs_ext_tags), GFP_NOFS);
+		}
 	}
 
 	return 1;
@@ -284,6 +299,54 @@ int yaffs2_checkpt_wr(struct yaffs_dev *dev, const void *data, int n_bytes)
 	return i;
 }
 
+/*
+ * Read a checkpoint chunk into checkpt_buffer. Where possible the rest of
+ * the block (up to YAFFS_CHECKPT_RA_CHUNKS chunks) is fetched with one
+ * multi-chunk read and later chunks are served from that window.
+ */
+static void yaffs2_checkpt_rd_chunk(struct yaffs_dev *dev, int chunk,
+				    struct yaffs_ext_tags *tags)
+{
+	int n;
+	int idx = chunk - dev->checkpt_ra_first;
+
+	if (dev->checkpt_ra_buffer && dev->checkpt_ra_tags &&
+	    (idx < 0 || idx >= dev->checkpt_ra_count)) {
+		n = dev->param.chunks_per_block - dev->checkpt_cur_chunk;
+		if (n > YAFFS_CHECKPT_RA_CHUNKS)
+			n = YAFFS_CHECKPT_RA_CHUNKS;
+
+		dev->checkpt_ra_first = chunk;
+		dev->checkpt_ra_count = 0;
+		if (yaffs_rd_chunks_tags_nand(dev, chunk, n,
+					      dev->checkpt_ra_buffer,
+					      dev->checkpt_ra_tags) == YAFFS_OK) {
+			dev->checkpt_ra_count = n;
+		} else {
+			/* Read chunk by chunk from now on */
+			kfree(dev->checkpt_ra_buffer);
+			dev->checkpt_ra_buffer = NULL;
+			kfree(dev->checkpt_ra_tags);
+			dev->checkpt_ra_tags = NULL;
+		}
+		idx = 0;
+	}
+
+	if (idx >= 0 && idx < dev->checkpt_ra_count) {
+		memcpy(dev->checkpt_buffer,
+		       dev->checkpt_ra_buffer + idx * dev->data_bytes_per_chunk,
+		       dev->data_bytes_per_chunk);
+		*tags = dev->checkpt_ra_tags[idx];
+		return;
+	}
+
+	dev->n_page_reads++;
+
+	/* read in the next chunk */
+	dev->param.read_chunk_tags_fn(dev, chunk - dev->chunk_offset,
+				      dev->checkpt_buffer, tags);
+}
+
 int yaffs2_checkpt_rd(struct yaffs_dev *dev, void *data, int n_bytes)
 {
 	int i = 0;
@@ -291,9 +354,11 @@ int yaffs2_checkpt_rd(struct yaffs_dev *dev, void *data, int n_bytes)
 	struct yaffs_ext_tags tags;
 
 	int chunk;
-	int realigned_chunk;
+	int run;
+	int j;
 
 	u8 *data_bytes = (u8 *) data;
+	u8 *src;
 
 	if (!dev->checkpt_buffer)
 		return 0;
@@ -318,16 +383,7 @@ int yaffs2_checkpt_rd(struct yaffs_dev *dev, void *data, int n_bytes)
 				    dev->param.chunks_per_block +
 				    dev->checkpt_cur_chunk;
 
-				realigned_chunk = chunk - dev->chunk_offset;
-
-				dev->n_page_reads++;
-
-				/* read in the next chunk */
-				dev->param.read_chunk_tags_fn(dev,
-							      realigned_chunk,
-							      dev->
-							      checkpt_buffer,
-							      &tags);
+				yaffs2_checkpt_rd_chunk(dev, chunk, &tags);
 
 				if (tags.chunk_id != (dev->checkpt_page_seq + 1)
 				    || tags.ecc_result > YAFFS_ECC_RESULT_FIXED
@@ -346,14 +402,20 @@ int yaffs2_checkpt_rd(struct yaffs_dev *dev, void *data, int n_bytes)
 		}
 
 		if (ok) {
-			*data_bytes =
-			    dev->checkpt_buffer[dev->checkpt_byte_offs];
-			dev->checkpt_sum += *data_bytes;
-			dev->checkpt_xor ^= *data_bytes;
-			dev->checkpt_byte_offs++;
-			i++;
-			data_bytes++;
-			dev->checkpt_byte_count++;
+			/* Copy out as much as this chunk holds in one go */
+			run = dev->data_bytes_per_chunk - dev->checkpt_byte_offs;
+			if (run > n_bytes - i)
+				run = n_bytes - i;
+			src = &dev->checkpt_buffer[dev->checkpt_byte_offs];
+			memcpy(data_bytes, src, run);
+			for (j = 0; j < run; j++) {
+				dev->checkpt_sum += src[j];
+				dev->checkpt_xor ^= src[j];
+			}
+			dev->checkpt_byte_offs += run;
+			i += run;
+			data_bytes += run;
+			dev->checkpt_byte_count += run;
 		}
 	}
 
@@ -384,6 +446,12 @@ int yaffs_checkpt_close(struct yaffs_dev *dev)
 		}
 		kfree(dev->checkpt_block_list);
 		dev->checkpt_block_list = NULL;
+
+		kfree(dev->checkpt_ra_buffer);
+		dev->checkpt_ra_buffer = NULL;
+		kfree(dev->checkpt_ra_tags);
+		dev->checkpt_ra_tags = NULL;
+		dev->checkpt_ra_count = 0;
 	}
 
 	dev->n_free_chunks -=
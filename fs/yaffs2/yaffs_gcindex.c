@@ -0,0 +1,212 @@
+/*
+ * YAFFS: Yet Another Flash File System. A NAND-flash specific file system.
+ *
+ * Copyright (C) 2002-2010 Aleph One Ltd.
+ *   for Toby Churchill Ltd and Brightstar Engineering
+ *
+ * Created by Charles Manning <charles@aleph1.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include "yaffs_gcindex.h"
+#include "yaffs_getblockinfo.h"
+#include "yaffs_yaffs2.h"
+#include "yaffs_trace.h"
+
+/*
+ * Every FULL block with at least one free (deleted or soft deleted) chunk
+ * sits on the list for its pages_used count. The lists are doubly linked
+ * through arrays of block offsets so the index costs four ints per block
+ * plus one per bucket and is updated in O(1) whenever a block's usage or
+ * state changes.
+ *
+ * yaffs_gc_index_update() recomputes where a block belongs from its
+ * block info, so it is safe to call redundantly. Mount-time scanning
+ * fills in the block info directly and then rebuilds the whole index.
+ */
+
+static inline int yaffs_gc_index_bucket_for(struct yaffs_dev *dev,
+					    struct yaffs_block_info *bi)
+{
+	int pages_used;
+
+	if (bi->block_state != YAFFS_BLOCK_STATE_FULL)
+		return -1;
+
+	pages_used = bi->pages_in_use - bi->soft_del_pages;
+	if (pages_used < 0 || pages_used >= dev->param.chunks_per_block)
+		return -1;
+
+	return pages_used;
+}
+
+static void yaffs_gc_index_unlink(struct yaffs_dev *dev, int i)
+{
+	int bucket = dev->gc_index_bucket[i];
+	int next = dev->gc_index_next[i];
+	int prev = dev->gc_index_prev[i];
+
+	if (prev >= 0)
+		dev->gc_index_next[prev] = next;
+	else
+		dev->gc_index_head[bucket] = next;
+	if (next >= 0)
+		dev->gc_index_prev[next] = prev;
+
+	dev->gc_index_bucket[i] = -1;
+}
+
+static void yaffs_gc_index_link(struct yaffs_dev *dev, int i, int bucket)
+{
+	int head = dev->gc_index_head[bucket];
+
+	dev->gc_index_prev[i] = -1;
+	dev->gc_index_next[i] = head;
+	if (head >= 0)
+		dev->gc_index_prev[head] = i;
+	dev->gc_index_head[bucket] = i;
+	dev->gc_index_bucket[i] = bucket;
+}
+
+static void yaffs_gc_index_clear(struct yaffs_dev *dev)
+{
+	int n_blocks = dev->internal_end_block - dev->internal_start_block + 1;
+	int i;
+
+	for (i = 0; i < dev->param.chunks_per_block; i++)
+		dev->gc_index_head[i] = -1;
+	for (i = 0; i < n_blocks; i++)
+		dev->gc_index_bucket[i] = -1;
+}
+
+int yaffs_gc_index_init(struct yaffs_dev *dev)
+{
+	int n_blocks = dev->internal_end_block - dev->internal_start_block + 1;
+	int n_ints = 3 * n_blocks + dev->param.chunks_per_block;
+
+	dev->gc_index = kmalloc(n_ints * sizeof(int), GFP_NOFS);
+	if (!dev->gc_index) {
+		dev->gc_index = vmalloc(n_ints * sizeof(int));
+		dev->gc_index_alt = 1;
+	} else {
+		dev->gc_index_alt = 0;
+	}
+
+	if (!dev->gc_index)
+		return YAFFS_FAIL;
+
+	dev->gc_index_next = dev->gc_index;
+	dev->gc_index_prev = dev->gc_index_next + n_blocks;
+	dev->gc_index_bucket = dev->gc_index_prev + n_blocks;
+	dev->gc_index_head = dev->gc_index_bucket + n_blocks;
+
+	yaffs_gc_index_clear(dev);
+
+	return YAFFS_OK;
+}
+
+void yaffs_gc_index_deinit(struct yaffs_dev *dev)
+{
+	if (dev->gc_index_alt && dev->gc_index)
+		vfree(dev->gc_index);
+	else if (dev->gc_index)
+		kfree(dev->gc_index);
+
+	dev->gc_index_alt = 0;
+	dev->gc_index = NULL;
+	dev->gc_index_next = NULL;
+	dev->gc_index_prev = NULL;
+	dev->gc_index_bucket = NULL;
+	dev->gc_index_head = NULL;
+}
+
+void yaffs_gc_index_rebuild(struct yaffs_dev *dev)
+{
+	struct yaffs_block_info *bi = dev->block_info;
+	int n_blocks = dev->internal_end_block - dev->internal_start_block + 1;
+	int bucket;
+	int i;
+
+	if (!dev->gc_index)
+		return;
+
+	yaffs_gc_index_clear(dev);
+
+	for (i = 0; i < n_blocks; i++, bi++) {
+		bucket = yaffs_gc_index_bucket_for(dev, bi);
+		if (bucket >= 0)
+			yaffs_gc_index_link(dev, i, bucket);
+	}
+}
+
+void yaffs_gc_index_update(struct yaffs_dev *dev, int blk)
+{
+	struct yaffs_block_info *bi;
+	int bucket;
+	int i;
+
+	if (!dev->gc_index ||
+	    blk < dev->internal_start_block || blk > dev->internal_end_block)
+		return;
+
+	i = blk - dev->internal_start_block;
+	bi = yaffs_get_block_info(dev, blk);
+	bucket = yaffs_gc_index_bucket_for(dev, bi);
+
+	if (bucket == dev->gc_index_bucket[i])
+		return;
+
+	if (dev->gc_index_bucket[i] >= 0)
+		yaffs_gc_index_unlink(dev, i);
+	if (bucket >= 0)
+		yaffs_gc_index_link(dev, i, bucket);
+}
+
+/*
+ * Find the dirtiest block that may be collected and has no more than
+ * threshold pages in use. Among equally dirty blocks the first few on the
+ * list are compared and the oldest (lowest sequence number) wins, which
+ * keeps yaffs2 from leaving old blocks with discarded pages behind.
+ *
+ * Returns the block number or 0 if there is no suitable block.
+ */
+int yaffs_gc_index_find(struct yaffs_dev *dev, int threshold, int *pages_used)
+{
+	struct yaffs_block_info *bi;
+	int bucket;
+	int i;
+	int n;
+	int selected;
+
+	if (!dev->gc_index)
+		return 0;
+
+	if (threshold >= dev->param.chunks_per_block)
+		threshold = dev->param.chunks_per_block - 1;
+
+	for (bucket = 0; bucket <= threshold; bucket++) {
+		selected = -1;
+		n = 0;
+		for (i = dev->gc_index_head[bucket];
+		     i >= 0 && n < YAFFS_GC_INDEX_MAX_SCAN;
+		     i = dev->gc_index_next[i], n++) {
+			bi = &dev->block_info[i];
+			if (!yaffs_block_ok_for_gc(dev, bi))
+				continue;
+			if (selected < 0 ||
+			    bi->seq_number < dev->block_info[selected].seq_number)
+				selected = i;
+		}
+		dev->gc_scan_blocks += n;
+
+		if (selected >= 0) {
+			*pages_used = bucket;
+			return selected + dev->internal_start_block;
+		}
+	}
+
+	return 0;
+}
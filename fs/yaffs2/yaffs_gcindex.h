@@ -0,0 +1,36 @@
+/*
+ * YAFFS: Yet another Flash File System . A NAND-flash specific file system.
+ *
+ * Copyright (C) 2002-2010 Aleph One Ltd.
+ *   for Toby Churchill Ltd and Brightstar Engineering
+ *
+ * Created by Charles Manning <charles@aleph1.co.uk>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License version 2.1 as
+ * published by the Free Software Foundation.
+ *
+ * Note: Only YAFFS headers are LGPL, YAFFS C code is covered by GPL.
+ */
+
+/*
+ * Garbage collection candidate index.
+ * Full blocks are kept on per-dirtiness lists so that the gc can find the
+ * dirtiest block without scanning the block array.
+ */
+
+#ifndef __YAFFS_GCINDEX_H__
+#define __YAFFS_GCINDEX_H__
+
+#include "yaffs_guts.h"
+
+/* How many candidates in one bucket are compared by sequence number */
+#define YAFFS_GC_INDEX_MAX_SCAN	8
+
+int yaffs_gc_index_init(struct yaffs_dev *dev);
+void yaffs_gc_index_deinit(struct yaffs_dev *dev);
+void yaffs_gc_index_rebuild(struct yaffs_dev *dev);
+void yaffs_gc_index_update(struct yaffs_dev *dev, int blk);
+int yaffs_gc_index_find(struct yaffs_dev *dev, int threshold, int *pages_used);
+
+#endif
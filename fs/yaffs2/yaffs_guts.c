@@ -25,6 +25,7 @@
 #include "yaffs_yaffs1.h"
 #include "yaffs_yaffs2.h"
 #include "yaffs_bitmap.h"
+#include "yaffs_gcindex.h"
 #include "yaffs_verify.h"
 
 #include "yaffs_nand.h"
@@ -35,10 +36,11 @@
 
 #include "yaffs_attribs.h"
 
-/* Note YAFFS_GC_GOOD_ENOUGH must be <= YAFFS_GC_PASSIVE_THRESHOLD */
-#define YAFFS_GC_GOOD_ENOUGH 2
 #define YAFFS_GC_PASSIVE_THRESHOLD 4
 
+/* Background gc time slice per unit of urgency */
+#define YAFFS_BG_GC_SLICE_US 2000
+
 #include "yaffs_ecc.h"
 
 /* Forward declarations */
@@ -477,6 +479,7 @@ static int yaffs_alloc_chunk(struct yaffs_dev *dev, int use_reserver,
 		/* If the block is full set the state to full */
 		if (dev->alloc_page >= dev->param.chunks_per_block) {
 			bi->block_state = YAFFS_BLOCK_STATE_FULL;
+			yaffs_gc_index_update(dev, dev->alloc_block);
 			dev->alloc_block = -1;
 		}
 
@@ -515,6 +518,7 @@ void yaffs_skip_rest_of_block(struct yaffs_dev *dev)
 		    yaffs_get_block_info(dev, dev->alloc_block);
 		if (bi->block_state == YAFFS_BLOCK_STATE_ALLOCATING) {
 			bi->block_state = YAFFS_BLOCK_STATE_FULL;
+			yaffs_gc_index_update(dev, dev->alloc_block);
 			dev->alloc_block = -1;
 		}
 	}
@@ -662,6 +666,7 @@ static void yaffs_retire_block(struct yaffs_dev *dev, int flash_block)
 	bi->block_state = YAFFS_BLOCK_STATE_DEAD;
 	bi->gc_prioritise = 0;
 	bi->needs_retiring = 0;
+	yaffs_gc_index_update(dev, flash_block);
 
 	dev->n_retired_blocks++;
 }
@@ -1200,6 +1205,7 @@ static void yaffs_soft_del_chunk(struct yaffs_dev *dev, int chunk)
 	if (the_block) {
 		the_block->soft_del_pages++;
 		dev->n_free_chunks++;
+		yaffs_gc_index_update(dev, block_no);
 		yaffs2_update_oldest_dirty_seq(dev, block_no, the_block);
 	}
 }
@@ -2332,7 +2338,8 @@ static int yaffs_init_blocks(struct yaffs_dev *dev)
                 }
 	}
 
-	if (dev->block_info && dev->chunk_bits) {
+	if (dev->block_info && dev->chunk_bits &&
+	    yaffs_gc_index_init(dev) == YAFFS_OK) {
 		memset(dev->block_info, 0,
 		       n_blocks * sizeof(struct yaffs_block_info));
 		memset(dev->chunk_bits, 0, dev->chunk_bit_stride * n_blocks);
@@ -2359,6 +2366,8 @@ static void yaffs_deinit_blocks(struct yaffs_dev *dev)
 		kfree(dev->chunk_bits);
 	dev->chunk_bits_alt = 0;
 	dev->chunk_bits = NULL;
+
+	yaffs_gc_index_deinit(dev);
 }
 
 void yaffs_block_became_dirty(struct yaffs_dev *dev, int block_no)
@@ -2379,6 +2388,7 @@ void yaffs_block_became_dirty(struct yaffs_dev *dev, int block_no)
 	yaffs2_clear_oldest_dirty_seq(dev, bi);
 
 	bi->block_state = YAFFS_BLOCK_STATE_DIRTY;
+	yaffs_gc_index_update(dev, block_no);
 
 	/* If this is the block being garbage collected then stop gc'ing this block */
 	if (block_no == dev->gc_block)
@@ -2468,8 +2478,10 @@ static int yaffs_gc_block(struct yaffs_dev *dev, int block, int whole_block)
 
 	/*yaffs_verify_free_chunks(dev); */
 
-	if (bi->block_state == YAFFS_BLOCK_STATE_FULL)
+	if (bi->block_state == YAFFS_BLOCK_STATE_FULL) {
 		bi->block_state = YAFFS_BLOCK_STATE_COLLECTING;
+		yaffs_gc_index_update(dev, block);
+	}
 
 	bi->has_shrink_hdr = 0;	/* clear the flag so that the block can erase */
 
@@ -2679,6 +2691,7 @@ static int yaffs_gc_block(struct yaffs_dev *dev, int block, int whole_block)
 		 * because checkpointing does not restore gc.
 		 */
 		bi->block_state = YAFFS_BLOCK_STATE_FULL;
+		yaffs_gc_index_update(dev, block);
 	} else {
 		/* The gc completed. */
 		/* Do any required cleanups */
@@ -2724,7 +2737,6 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 				    int aggressive, int background)
 {
 	int i;
-	int iterations;
 	unsigned selected = 0;
 	int prioritised = 0;
 	int prioritised_exist = 0;
@@ -2771,11 +2783,9 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 
 	if (!selected) {
 		int pages_used;
-		int n_blocks =
-		    dev->internal_end_block - dev->internal_start_block + 1;
+
 		if (aggressive) {
 			threshold = dev->param.chunks_per_block;
-			iterations = n_blocks;
 		} else {
 			int max_threshold;
 
@@ -2792,38 +2802,19 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 				threshold = YAFFS_GC_PASSIVE_THRESHOLD;
 			if (threshold > max_threshold)
 				threshold = max_threshold;
-
-			iterations = n_blocks / 16 + 1;
-			if (iterations > 100)
-				iterations = 100;
-		}
-
-		for (i = 0;
-		     i < iterations &&
-		     (dev->gc_dirtiest < 1 ||
-		      dev->gc_pages_in_use > YAFFS_GC_GOOD_ENOUGH); i++) {
-			dev->gc_block_finder++;
-			if (dev->gc_block_finder < dev->internal_start_block ||
-			    dev->gc_block_finder > dev->internal_end_block)
-				dev->gc_block_finder =
-				    dev->internal_start_block;
-
-			bi = yaffs_get_block_info(dev, dev->gc_block_finder);
-
-			pages_used = bi->pages_in_use - bi->soft_del_pages;
-
-			if (bi->block_state == YAFFS_BLOCK_STATE_FULL &&
-			    pages_used < dev->param.chunks_per_block &&
-			    (dev->gc_dirtiest < 1
-			     || pages_used < dev->gc_pages_in_use)
-			    && yaffs_block_ok_for_gc(dev, bi)) {
-				dev->gc_dirtiest = dev->gc_block_finder;
-				dev->gc_pages_in_use = pages_used;
-			}
 		}
 
-		if (dev->gc_dirtiest > 0 && dev->gc_pages_in_use <= threshold)
+		/*
+		 * The gc index hands us the dirtiest eligible block
+		 * directly, so there is no need to walk the block array
+		 * a slice at a time any more.
+		 */
+		dev->gc_dirtiest = yaffs_gc_index_find(dev, threshold,
+						       &pages_used);
+		if (dev->gc_dirtiest > 0) {
+			dev->gc_pages_in_use = pages_used;
 			selected = dev->gc_dirtiest;
+		}
 	}
 
 	/*
@@ -2865,8 +2856,8 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 	} else {
 		dev->gc_not_done++;
 		yaffs_trace(YAFFS_TRACE_GC,
-			"GC none: finder %d skip %d threshold %d dirtiest %d using %d oldest %d%s",
-			dev->gc_block_finder, dev->gc_not_done, threshold,
+			"GC none: skip %d threshold %d dirtiest %d using %d oldest %d%s",
+			dev->gc_not_done, threshold,
 			dev->gc_dirtiest, dev->gc_pages_in_use,
 			dev->oldest_dirty_block, background ? " bg" : "");
 	}
@@ -2874,11 +2865,19 @@ static unsigned yaffs_find_gc_block(struct yaffs_dev *dev,
 	return selected;
 }
 
+static void yaffs_account_gc_stall(struct yaffs_dev *dev, s64 us)
+{
+	dev->gc_stalls++;
+	dev->gc_stall_us += us;
+	if (us > dev->gc_max_stall_us)
+		dev->gc_max_stall_us = us;
+}
+
 /* New garbage collector
  * If we're very low on erased blocks then we do aggressive garbage collection
  * otherwise we do "leasurely" garbage collection.
- * Aggressive gc looks further (whole array) and will accept less dirty blocks.
- * Passive gc only inspects smaller areas and will only accept more dirty blocks.
+ * Aggressive gc will accept less dirty blocks.
+ * Passive gc will only accept more dirty blocks.
  *
  * The idea is to help clear out space in a more spread-out manner.
  * Dunno if it really does anything useful.
@@ -2950,6 +2949,8 @@ static int yaffs_check_gc(struct yaffs_dev *dev, int background)
 		}
 
 		if (dev->gc_block > 0) {
+			s64 start = Y_CLOCK_US();
+
 			dev->all_gcs++;
 			if (!aggressive)
 				dev->passive_gc_count++;
@@ -2959,6 +2960,9 @@ static int yaffs_check_gc(struct yaffs_dev *dev, int background)
 				dev->n_erased_blocks, aggressive);
 
 			gc_ok = yaffs_gc_block(dev, dev->gc_block, aggressive);
+
+			if (!background)
+				yaffs_account_gc_stall(dev, Y_CLOCK_US() - start);
 		}
 
 		if (dev->n_erased_blocks < (dev->param.n_reserved_blocks)
@@ -2981,11 +2985,34 @@ static int yaffs_check_gc(struct yaffs_dev *dev, int background)
  */
 int yaffs_bg_gc(struct yaffs_dev *dev, unsigned urgency)
 {
-	int erased_chunks = dev->n_erased_blocks * dev->param.chunks_per_block;
+	int erased_chunks;
+	s64 deadline = Y_CLOCK_US() + urgency * YAFFS_BG_GC_SLICE_US;
+	u32 progress;
 
 	yaffs_trace(YAFFS_TRACE_BACKGROUND, "Background gc %u", urgency);
 
-	yaffs_check_gc(dev, 1);
+	/*
+	 * Keep collecting in small steps until the time slice is used up.
+	 * A non-urgent pass does a single step, as before, so an idle
+	 * device is not kept busy; the caller holds the gross lock so the
+	 * slice bounds how long foreground operations can be held off.
+	 */
+	dev->bg_gc_slices++;
+	do {
+		progress = dev->n_gc_copies + dev->n_erasures;
+		yaffs_check_gc(dev, 1);
+		erased_chunks =
+		    dev->n_erased_blocks * dev->param.chunks_per_block;
+		if (progress == dev->n_gc_copies + dev->n_erasures ||
+		    erased_chunks > dev->n_free_chunks / 2)
+			break;
+		if (Y_CLOCK_US() >= deadline) {
+			if (urgency)
+				dev->bg_gc_expired++;
+			break;
+		}
+	} while (1);
+
 	return erased_chunks > dev->n_free_chunks / 2;
 }
 
@@ -3061,6 +3088,7 @@ void yaffs_chunk_del(struct yaffs_dev *dev, int chunk_id, int mark_flash,
 		yaffs_clear_chunk_bit(dev, block, page);
 
 		bi->pages_in_use--;
+		yaffs_gc_index_update(dev, block);
 
 		if (bi->pages_in_use == 0 &&
 		    !bi->has_shrink_hdr &&
@@ -4764,6 +4792,7 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	int init_failed = 0;
 	unsigned x;
 	int bits;
+	s64 start = Y_CLOCK_US();
 
 	yaffs_trace(YAFFS_TRACE_TRACING, "yaffs: yaffs_guts_initialise()" );
 
@@ -4916,7 +4945,13 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	dev->passive_gc_count = 0;
 	dev->oldest_dirty_gc_count = 0;
 	dev->bg_gcs = 0;
-	dev->gc_block_finder = 0;
+	dev->gc_scan_blocks = 0;
+	dev->gc_stalls = 0;
+	dev->gc_stall_us = 0;
+	dev->gc_max_stall_us = 0;
+	dev->bg_gc_slices = 0;
+	dev->bg_gc_expired = 0;
+	dev->n_batched_reads = 0;
 	dev->buffered_block = -1;
 	dev->doing_buffered_block_rewrite = 0;
 	dev->n_deleted_files = 0;
@@ -4992,6 +5027,9 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 		init_failed = 1;
 
 	if (!init_failed) {
+		/* Mount builds most of the tree, allocate for it in bulk */
+		yaffs_allocator_set_bulk(dev, 1);
+
 		/* Now scan the flash. */
 		if (dev->param.is_yaffs2) {
 			if (yaffs2_checkpt_restore(dev)) {
@@ -5020,6 +5058,7 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 					init_failed = 1;
 
 				yaffs_init_tnodes_and_objs(dev);
+				yaffs_allocator_set_bulk(dev, 1);
 
 				if (!init_failed
 				    && !yaffs_create_initial_dir(dev))
@@ -5032,6 +5071,11 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 			init_failed = 1;
                 }
 
+		yaffs_allocator_set_bulk(dev, 0);
+
+		/* Scanning filled in the block info behind the gc index's back */
+		yaffs_gc_index_rebuild(dev);
+
 		yaffs_strip_deleted_objs(dev);
 		yaffs_fix_hanging_objs(dev);
 		if (dev->param.empty_lost_n_found)
@@ -5063,8 +5107,10 @@ int yaffs_guts_initialise(struct yaffs_dev *dev)
 	if (!dev->is_checkpointed && dev->blocks_in_checkpt > 0)
 		yaffs2_checkpt_invalidate(dev);
 
-	yaffs_trace(YAFFS_TRACE_TRACING,
-	  "yaffs: yaffs_guts_initialise() done.");
+	dev->mount_us = Y_CLOCK_US() - start;
+
+	yaffs_trace(YAFFS_TRACE_TRACING | YAFFS_TRACE_MOUNT,
+	  "yaffs: yaffs_guts_initialise() done in %u us.", dev->mount_us);
 	return YAFFS_OK;
 
 }
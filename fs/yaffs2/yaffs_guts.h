@@ -543,6 +543,10 @@ struct yaffs_param {
 	int (*read_chunk_tags_fn) (struct yaffs_dev * dev,
 				   int nand_chunk, u8 * data,
 				   struct yaffs_ext_tags * tags);
+	/* Optional: read n consecutive chunks in one go, data may be NULL */
+	int (*read_chunks_tags_fn) (struct yaffs_dev * dev,
+				    int nand_chunk, int n_chunks, u8 * data,
+				    struct yaffs_ext_tags * tags);
 	int (*bad_block_fn) (struct yaffs_dev * dev, int block_no);
 	int (*query_block_fn) (struct yaffs_dev * dev, int block_no,
 			       enum yaffs_block_state * state,
@@ -627,6 +631,10 @@ struct yaffs_dev {
 	int checkpt_next_block;
 	int *checkpt_block_list;
 	int checkpt_max_blocks;
+	u8 *checkpt_ra_buffer;	/* multi-chunk readahead window for restore */
+	struct yaffs_ext_tags *checkpt_ra_tags;
+	int checkpt_ra_first;	/* nand chunk at the start of the window */
+	int checkpt_ra_count;	/* chunks valid in the window */
 	u32 checkpt_sum;
 	u32 checkpt_xor;
 
@@ -664,7 +672,6 @@ struct yaffs_dev {
 
 	unsigned has_pending_prioritised_gc;	/* We think this device might have pending prioritised gcs */
 	unsigned gc_disable;
-	unsigned gc_block_finder;
 	unsigned gc_dirtiest;
 	unsigned gc_pages_in_use;
 	unsigned gc_not_done;
@@ -672,6 +679,14 @@ struct yaffs_dev {
 	unsigned gc_chunk;
 	unsigned gc_skip;
 
+	/* GC candidate index by dirtiness, see yaffs_gcindex.c */
+	int *gc_index;		/* single allocation backing the arrays below */
+	int *gc_index_next;
+	int *gc_index_prev;
+	int *gc_index_bucket;	/* bucket each block is filed in, -1 if none */
+	int *gc_index_head;	/* first block of each bucket, -1 if empty */
+	unsigned gc_index_alt:1;	/* was allocated using alternative strategy */
+
 	/* Special directories */
 	struct yaffs_obj *root_dir;
 	struct yaffs_obj *lost_n_found;
@@ -724,6 +739,14 @@ struct yaffs_dev {
 	u32 oldest_dirty_gc_count;
 	u32 n_gc_blocks;
 	u32 bg_gcs;
+	u32 gc_scan_blocks;	/* blocks examined while choosing gc victims */
+	u32 gc_stalls;		/* foreground gc passes that collected */
+	u64 gc_stall_us;	/* time spent in foreground gc */
+	u32 gc_max_stall_us;
+	u32 bg_gc_slices;	/* background gc time slices run */
+	u32 bg_gc_expired;	/* ...that ran out of time with work left */
+	u32 n_batched_reads;	/* multi-chunk nand reads */
+	u32 mount_us;		/* time taken by yaffs_guts_initialise() */
 	u32 n_retired_writes;
 	u32 n_retired_blocks;
 	u32 n_ecc_fixed;
@@ -28,6 +28,7 @@ struct yaffs_linux_context {
 	u8 *spare_buffer;	/* For mtdif2 use. Don't know the size of the buffer
 				 * at compile time so we have to allocate it.
 				 */
+	u8 *batch_oob_buffer;	/* For mtdif2 multi-chunk reads, allocated on first use */
 	struct list_head search_contexts;
 	void (*put_super_fn) (struct super_block * sb);
 
@@ -165,6 +165,75 @@ int nandmtd2_read_chunk_tags(struct yaffs_dev *dev, int nand_chunk,
 		return YAFFS_FAIL;
 }
 
+/*
+ * Read the tags, and optionally the data, of n_chunks consecutive chunks
+ * with a single MTD request. With MTD_OOB_AUTO the free oob bytes of each
+ * page are packed back to back in the oob buffer, mtd->oobavail apart.
+ *
+ * Any error, including a corrected one in the data or in the tags, fails
+ * the whole request because it cannot be pinned on a single chunk; callers
+ * then fall back to reading the chunks one at a time. Inband tags are not
+ * supported here for the same reason.
+ */
+int nandmtd2_read_chunks_tags(struct yaffs_dev *dev, int nand_chunk,
+			      int n_chunks, u8 * data,
+			      struct yaffs_ext_tags *tags)
+{
+	struct mtd_info *mtd = yaffs_dev_to_mtd(dev);
+	struct yaffs_linux_context *lc = yaffs_dev_to_lc(dev);
+	struct mtd_oob_ops ops;
+	int retval;
+	int i;
+
+	loff_t addr = ((loff_t) nand_chunk) * dev->param.total_bytes_per_chunk;
+
+	struct yaffs_packed_tags2 pt;
+
+	int packed_tags_size =
+	    dev->param.no_tags_ecc ? sizeof(pt.t) : sizeof(pt);
+	void *packed_tags_ptr =
+	    dev->param.no_tags_ecc ? (void *)&pt.t : (void *)&pt;
+
+	yaffs_trace(YAFFS_TRACE_MTD,
+		"nandmtd2_read_chunks_tags chunk %d n %d data %p",
+		nand_chunk, n_chunks, data);
+
+	if (dev->param.inband_tags || n_chunks < 1 ||
+	    n_chunks > dev->param.chunks_per_block ||
+	    packed_tags_size > mtd->oobavail)
+		return YAFFS_FAIL;
+
+	if (!lc->batch_oob_buffer) {
+		lc->batch_oob_buffer =
+		    kmalloc(dev->param.chunks_per_block * mtd->oobavail,
+			    GFP_NOFS);
+		if (!lc->batch_oob_buffer)
+			return YAFFS_FAIL;
+	}
+
+	ops.mode = MTD_OOB_AUTO;
+	ops.ooblen = n_chunks * mtd->oobavail;
+	ops.len = data ? n_chunks * dev->data_bytes_per_chunk : 0;
+	ops.ooboffs = 0;
+	ops.datbuf = data;
+	ops.oobbuf = lc->batch_oob_buffer;
+	retval = mtd->read_oob(mtd, addr, &ops);
+
+	if (retval != 0 || ops.oobretlen != ops.ooblen)
+		return YAFFS_FAIL;
+
+	for (i = 0; i < n_chunks; i++) {
+		memcpy(packed_tags_ptr,
+		       lc->batch_oob_buffer + i * mtd->oobavail,
+		       packed_tags_size);
+		yaffs_unpack_tags2(&tags[i], &pt, !dev->param.no_tags_ecc);
+		if (tags[i].ecc_result > YAFFS_ECC_RESULT_NO_ERROR)
+			return YAFFS_FAIL;
+	}
+
+	return YAFFS_OK;
+}
+
 int nandmtd2_mark_block_bad(struct yaffs_dev *dev, int block_no)
 {
 	struct mtd_info *mtd = yaffs_dev_to_mtd(dev);
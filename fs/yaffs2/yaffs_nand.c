@@ -50,6 +50,31 @@ int yaffs_rd_chunk_tags_nand(struct yaffs_dev *dev, int nand_chunk,
 	return result;
 }
 
+/*
+ * Batched read of n_chunks consecutive chunks. Fails if the driver can't
+ * do it or hit any ECC trouble, in which case the caller should fall back
+ * to yaffs_rd_chunk_tags_nand() so errors are attributed per chunk.
+ */
+int yaffs_rd_chunks_tags_nand(struct yaffs_dev *dev, int nand_chunk,
+			      int n_chunks, u8 * buffer,
+			      struct yaffs_ext_tags *tags)
+{
+	int result;
+
+	if (!dev->param.read_chunks_tags_fn)
+		return YAFFS_FAIL;
+
+	result = dev->param.read_chunks_tags_fn(dev,
+					nand_chunk - dev->chunk_offset,
+					n_chunks, buffer, tags);
+	if (result == YAFFS_OK) {
+		dev->n_page_reads += n_chunks;
+		dev->n_batched_reads++;
+	}
+
+	return result;
+}
+
 int yaffs_wr_chunk_tags_nand(struct yaffs_dev *dev,
 			     int nand_chunk,
 			     const u8 * buffer, struct yaffs_ext_tags *tags)
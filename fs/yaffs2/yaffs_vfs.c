@@ -1985,6 +1985,9 @@ static void yaffs_put_super(struct super_block *sb)
 		yaffs_dev_to_lc(dev)->spare_buffer = NULL;
 	}
 
+	kfree(yaffs_dev_to_lc(dev)->batch_oob_buffer);
+	yaffs_dev_to_lc(dev)->batch_oob_buffer = NULL;
+
 	kfree(dev);
 }
 
@@ -2260,6 +2263,7 @@ static struct super_block *yaffs_internal_read_super(int yaffs_version,
 	if (yaffs_version == 2) {
 		param->write_chunk_tags_fn = nandmtd2_write_chunk_tags;
 		param->read_chunk_tags_fn = nandmtd2_read_chunk_tags;
+		param->read_chunks_tags_fn = nandmtd2_read_chunks_tags;
 		param->bad_block_fn = nandmtd2_mark_block_bad;
 		param->query_block_fn = nandmtd2_query_block;
 		yaffs_dev_to_lc(dev)->spare_buffer = 
@@ -2474,6 +2478,19 @@ static char *yaffs_dump_dev_part1(char *buf, struct yaffs_dev *dev)
 		    dev->oldest_dirty_gc_count);
 	buf += sprintf(buf, "n_gc_blocks........... %u\n", dev->n_gc_blocks);
 	buf += sprintf(buf, "bg_gcs................ %u\n", dev->bg_gcs);
+	buf +=
+	    sprintf(buf, "gc_scan_blocks........ %u\n", dev->gc_scan_blocks);
+	buf += sprintf(buf, "gc_stalls............. %u\n", dev->gc_stalls);
+	buf +=
+	    sprintf(buf, "gc_stall_us........... %llu\n",
+		    (unsigned long long)dev->gc_stall_us);
+	buf +=
+	    sprintf(buf, "gc_max_stall_us....... %u\n", dev->gc_max_stall_us);
+	buf += sprintf(buf, "bg_gc_slices.......... %u\n", dev->bg_gc_slices);
+	buf += sprintf(buf, "bg_gc_expired......... %u\n", dev->bg_gc_expired);
+	buf +=
+	    sprintf(buf, "n_batched_reads....... %u\n", dev->n_batched_reads);
+	buf += sprintf(buf, "mount_us.............. %u\n", dev->mount_us);
 	buf +=
 	    sprintf(buf, "n_retired_writes...... %u\n", dev->n_retired_writes);
 	buf +=
@@ -986,6 +986,8 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	struct yaffs_block_index *block_index = NULL;
 	int alt_block_index = 0;
+	struct yaffs_ext_tags *block_tags = NULL;
+	int have_block_tags;
 
 	yaffs_trace(YAFFS_TRACE_SCAN,
 		"yaffs2_scan_backwards starts  intstartblk %d intendblk %d...",
@@ -1013,6 +1015,11 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	chunk_data = yaffs_get_temp_buffer(dev, __LINE__);
 
+	/* Tags for a whole block, read in one go if the driver can */
+	if (dev->param.read_chunks_tags_fn)
+		block_tags = kmalloc(dev->param.chunks_per_block *
+				     sizeof(struct yaffs_ext_tags), GFP_NOFS);
+
 	/* Scan all the blocks to determine their state */
 	bi = dev->block_info;
 	for (blk = dev->internal_start_block; blk <= dev->internal_end_block;
@@ -1102,6 +1109,13 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 		deleted = 0;
 
+		have_block_tags = block_tags &&
+		    state == YAFFS_BLOCK_STATE_NEEDS_SCANNING &&
+		    yaffs_rd_chunks_tags_nand(dev,
+				blk * dev->param.chunks_per_block,
+				dev->param.chunks_per_block,
+				NULL, block_tags) == YAFFS_OK;
+
 		/* For each chunk in each block that needs scanning.... */
 		found_chunks = 0;
 		for (c = dev->param.chunks_per_block - 1;
@@ -1114,8 +1128,13 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 			chunk = blk * dev->param.chunks_per_block + c;
 
-			result = yaffs_rd_chunk_tags_nand(dev, chunk, NULL,
-							  &tags);
+			if (have_block_tags) {
+				tags = block_tags[c];
+				result = YAFFS_OK;
+			} else {
+				result = yaffs_rd_chunk_tags_nand(dev, chunk,
+								  NULL, &tags);
+			}
 
 			/* Let's have a good look at this chunk... */
 
@@ -1575,6 +1594,8 @@ int yaffs2_scan_backwards(struct yaffs_dev *dev)
 
 	yaffs_skip_rest_of_block(dev);
 
+	kfree(block_tags);
+
 	if (alt_block_index)
 		vfree(block_index);
 	else
@@ -208,6 +208,7 @@ struct dentry_operations {
 #define DCACHE_CANT_MOUNT	0x0100
 #define DCACHE_GENOCIDE		0x0200
 #define DCACHE_SHRINK_LIST	0x0400
+#define DCACHE_NEG_LRU		0x0800	/* Counted on sb->s_dentry_neg_lru */
 
 #define DCACHE_OP_HASH		0x1000
 #define DCACHE_OP_COMPARE	0x2000
@@ -423,5 +424,6 @@ static inline bool d_mountpoint(struct dentry *dentry)
 extern struct dentry *lookup_create(struct nameidata *nd, int is_dir);
 
 extern int sysctl_vfs_cache_pressure;
+extern int sysctl_dentry_neg_limit;
 
 #endif	/* __LINUX_DCACHE_H */
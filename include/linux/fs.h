@@ -1366,6 +1366,33 @@ extern int send_sigurg(struct fown_struct *fown);
 extern struct list_head super_blocks;
 extern spinlock_t sb_lock;
 
+/*
+ * Path lookup statistics, per superblock and per cpu, shown in
+ * /proc/fs/lookup_stats.  A walk that switches from rcu-walk to ref-walk
+ * in a directory on a superblock counts one fallback there.
+ */
+enum lookup_fallback {
+	LOOKUP_FB_MISS,		/* component not in the dcache */
+	LOOKUP_FB_REVALIDATE,	/* ->d_revalidate() can't do rcu-walk */
+	LOOKUP_FB_PERMISSION,	/* ->permission() can't do rcu-walk */
+	LOOKUP_FB_SEQ,		/* raced with rename, unlink or chdir */
+	LOOKUP_FB_MOUNT,	/* mount point or automount */
+	LOOKUP_FB_SYMLINK,	/* symlink to follow */
+	NR_LOOKUP_FB
+};
+
+struct lookup_stats {
+	unsigned long rcu_walks;	/* walks completed in rcu-walk */
+	unsigned long fallback[NR_LOOKUP_FB];
+	unsigned long d_hits;		/* components found in the dcache */
+	unsigned long d_neg_hits;	/* ... of those, negative */
+	unsigned long d_misses;		/* components looked up by the fs */
+	unsigned long neg_pruned;	/* negative dentries over the limit */
+};
+
+#define sb_lookup_stat_inc(sb, item) \
+	this_cpu_inc((sb)->s_lookup_stats->item)
+
 struct super_block {
 	struct list_head	s_list;		/* Keep this first */
 	dev_t			s_dev;		/* search index; _not_ kdev_t */
@@ -1400,6 +1427,11 @@ struct super_block {
 	/* s_dentry_lru, s_nr_dentry_unused protected by dcache.c lru locks */
 	struct list_head	s_dentry_lru;	/* unused dentry lru */
 	int			s_nr_dentry_unused;	/* # of dentry on lru */
+	/* negative dentries are kept apart, also counted in s_nr_dentry_unused */
+	struct list_head	s_dentry_neg_lru;	/* unused negative dentry lru */
+	int			s_nr_dentry_neg;	/* # of dentry on neg lru */
+
+	struct lookup_stats __percpu *s_lookup_stats;
 
 	struct block_device	*s_bdev;
 	struct backing_dev_info *s_bdi;
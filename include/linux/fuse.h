@@ -47,12 +47,17 @@
  *  - FUSE_IOCTL_UNRESTRICTED shall now return with array of 'struct
  *    fuse_ioctl_iovec' instead of ambiguous 'struct iovec'
  *  - add FUSE_IOCTL_32BIT flag
+ *
+ * Android extension, not part of any protocol version:
+ *  - add FUSE_DEV_IOC_PASSTHROUGH_OPEN ioctl on the fuse device
+ *  - replace padding in fuse_open_out with passthrough_id
  */
 
 #ifndef _LINUX_FUSE_H
 #define _LINUX_FUSE_H
 
 #include <linux/types.h>
+#include <linux/ioctl.h>
 
 /*
  * Version negotiation:
@@ -380,7 +385,7 @@ struct fuse_create_in {
 struct fuse_open_out {
 	__u64	fh;
 	__u32	open_flags;
-	__u32	padding;
+	__u32	passthrough_id;	/* Android extension, padding upstream */
 };
 
 struct fuse_release_in {
@@ -624,4 +629,24 @@ struct fuse_notify_retrieve_in {
 	__u64	dummy4;
 };
 
+/*
+ * Android extension: passthrough of read, write and mmap
+ *
+ * A filesystem daemon with CAP_SYS_ADMIN registers a file it has opened
+ * with the FUSE_DEV_IOC_PASSTHROUGH_OPEN ioctl on its fuse device.  The
+ * ioctl returns a positive id, which the daemon puts in passthrough_id of
+ * an OPEN or CREATE reply to have the kernel do reads, writes and mmaps
+ * of that file on the registered one.  An id is used up by the reply
+ * naming it.  Kernels without passthrough fail the ioctl with ENOTTY,
+ * which is how a daemon finds out; nothing is negotiated in INIT.
+ */
+struct fuse_passthrough_out {
+	__u32	fd;
+	__u32	flags;		/* must be zero */
+};
+
+#define FUSE_DEV_IOC_MAGIC		229
+#define FUSE_DEV_IOC_PASSTHROUGH_OPEN	_IOW(FUSE_DEV_IOC_MAGIC, 126, \
+					     struct fuse_passthrough_out)
+
 #endif /* _LINUX_FUSE_H */
@@ -654,6 +654,12 @@ struct transaction_s
 	 */
 	atomic_t		t_handle_count;
 
+	/*
+	 * How many synchronous operations waited for this transaction to
+	 * commit? [no locking]
+	 */
+	atomic_t		t_sync_waiters;
+
 	/*
 	 * This transaction is being forced and some process is
 	 * waiting for it to finish.
@@ -680,11 +686,21 @@ struct transaction_run_stats_s {
 	__u32			rs_handle_count;
 	__u32			rs_blocks;
 	__u32			rs_blocks_logged;
+	__u32			rs_sync_waiters;
 };
 
 struct transaction_stats_s {
 	unsigned long		ts_tid;
 	struct transaction_run_stats_s run;
+
+	/* Commits that had synchronous waiters */
+	unsigned long		ts_sync_commits;
+
+	/* Synchronous operations (fsync, sync handles) and their latency */
+	unsigned long		ts_sync_count;
+	u64			ts_sync_time;	/* in ns */
+	u64			ts_sync_max;	/* in ns */
+	u64			ts_sync_hold;	/* in ns spent batching */
 };
 
 static inline unsigned long
@@ -698,6 +714,15 @@ jbd2_time_diff(unsigned long start, unsigned long end)
 
 #define JBD2_NR_BATCH	64
 
+/*
+ * A synchronous operation holds the running transaction open for at most
+ * this many average sync arrival intervals, see jbd2_sync_batch().
+ */
+#define JBD2_SYNC_BATCH_INTERVALS	2
+
+/* Sync arrival intervals longer than this are counted as this */
+#define JBD2_SYNC_INTERVAL_MAX		NSEC_PER_SEC
+
 /**
  * struct journal_s - The journal_s type is the concrete type associated with
  *     journal_t.
@@ -759,6 +784,8 @@ jbd2_time_diff(unsigned long start, unsigned long end)
  * @j_wbufsize: maximum number of buffer_heads allowed in j_wbuf, the
  *	number that will fit in j_blocksize
  * @j_last_sync_writer: most recent pid which did a synchronous write
+ * @j_last_sync_time: when the most recent synchronous operation started
+ * @j_average_sync_interval: the average time between synchronous operations
  * @j_history: Buffer storing the transactions statistics history
  * @j_history_max: Maximum number of transactions in the statistics history
  * @j_history_cur: Current number of transactions in the statistics history
@@ -969,6 +996,13 @@ struct journal_s
 	 */
 	pid_t			j_last_sync_writer;
 
+	/*
+	 * when the last synchronous operation arrived, and the average
+	 * interval in nanoseconds between such arrivals. [j_history_lock]
+	 */
+	ktime_t			j_last_sync_time;
+	u64			j_average_sync_interval;
+
 	/*
 	 * the average amount of time in nanoseconds it takes to commit a
 	 * transaction to disk. [j_state_lock]
@@ -1228,6 +1262,9 @@ int __jbd2_log_start_commit(journal_t *journal, tid_t tid);
 int jbd2_journal_start_commit(journal_t *journal, tid_t *tid);
 int jbd2_journal_force_commit_nested(journal_t *journal);
 int jbd2_log_wait_commit(journal_t *journal, tid_t tid);
+int jbd2_complete_transaction(journal_t *journal, tid_t tid);
+void jbd2_sync_batch(journal_t *journal, ktime_t t_start_time);
+void jbd2_account_sync(journal_t *journal, ktime_t start);
 int jbd2_log_do_checkpoint(journal_t *journal);
 int jbd2_trans_will_send_data_barrier(journal_t *journal, tid_t tid);
 
@@ -15,6 +15,7 @@
 
 struct stable_node;
 struct mem_cgroup;
+struct seq_file;
 
 struct page *ksm_does_need_to_copy(struct page *page,
 			struct vm_area_struct *vma, unsigned long address);
@@ -89,6 +90,7 @@ int try_to_unmap_ksm(struct page *page, enum ttu_flags flags);
 int rmap_walk_ksm(struct page *page, int (*rmap_one)(struct page *,
 		  struct vm_area_struct *, unsigned long, void *), void *arg);
 void ksm_migrate_page(struct page *newpage, struct page *oldpage);
+int ksm_mm_stat(struct seq_file *m, struct mm_struct *mm);
 
 #else  /* !CONFIG_KSM */
 
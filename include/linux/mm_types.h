@@ -198,6 +198,10 @@ struct vm_area_struct {
 #ifdef CONFIG_NUMA
 	struct mempolicy *vm_policy;	/* NUMA policy for the VMA */
 #endif
+#ifdef CONFIG_SWAP
+	atomic_long_t swap_readahead_info; /* Last swap fault, readahead
+					      window and hits, swap_state.c */
+#endif
 };
 
 struct core_thread {
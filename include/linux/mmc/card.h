@@ -75,6 +75,9 @@ struct mmc_ext_csd {
 	unsigned int            data_tag_unit_size;     /* DATA TAG UNIT size */
 	unsigned int		boot_ro_lock;		/* ro lock support */
 	bool			boot_ro_lockable;
+	u8			max_packed_writes;	/* 500 */
+	u8			max_packed_reads;	/* 501 */
+	bool			packed_event_en;	/* packed event enabled */
 	u8			raw_partition_support;	/* 160 */
 	u8			raw_erased_mem_count;	/* 181 */
 	u8			raw_ext_csd_structure;	/* 194 */
@@ -370,6 +373,7 @@ static inline void __maybe_unused remove_quirk(struct mmc_card *card, int data)
 }
 
 #define mmc_card_mmc(c)		((c)->type == MMC_TYPE_MMC)
+#define mmc_large_sector(c)	((c)->ext_csd.data_sector_size == 4096)
 #define mmc_card_sd(c)		((c)->type == MMC_TYPE_SD)
 #define mmc_card_sdio(c)	((c)->type == MMC_TYPE_SDIO)
 
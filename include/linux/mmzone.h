@@ -106,6 +106,8 @@ enum zone_stat_item {
 	NR_SHMEM,		/* shmem pages (included tmpfs/GEM pages) */
 	NR_DIRTIED,		/* page dirtyings since bootup */
 	NR_WRITTEN,		/* page writings since bootup */
+	WORKINGSET_REFAULT,	/* evicted file pages faulted back in */
+	WORKINGSET_ACTIVATE,	/* ... and activated right away */
 #ifdef CONFIG_NUMA
 	NUMA_HIT,		/* allocated in intended node */
 	NUMA_MISS,		/* allocated in non intended node */
@@ -183,6 +185,12 @@ enum zone_watermarks {
 #define low_wmark_pages(z) (z->watermark[WMARK_LOW])
 #define high_wmark_pages(z) (z->watermark[WMARK_HIGH])
 
+/*
+ * Blocks of order 1 up to PCP_HIGH_ORDER, which kernel stacks and many
+ * drivers allocate all the time, are kept on per cpu lists as well.
+ */
+#define PCP_HIGH_ORDER		PAGE_ALLOC_COSTLY_ORDER
+
 struct per_cpu_pages {
 	int count;		/* number of pages in the list */
 	int high;		/* high watermark, emptying needed */
@@ -190,6 +198,13 @@ struct per_cpu_pages {
 
 	/* Lists of pages, one per migrate type stored on the pcp-lists */
 	struct list_head lists[MIGRATE_PCPTYPES];
+
+	/* The same for blocks of order 1 to PCP_HIGH_ORDER, in pages */
+	int high_order_count;
+	int high_order_high;
+	struct list_head high_order_lists[PCP_HIGH_ORDER][MIGRATE_PCPTYPES];
+	unsigned long high_order_hits;	/* allocations served by the lists */
+	unsigned long high_order_misses; /* allocations that refilled them */
 };
 
 struct per_cpu_pageset {
@@ -348,6 +363,9 @@ struct zone {
 	 */
 	unsigned int		compact_considered;
 	unsigned int		compact_defer_shift;
+	/* Where kcompactd's migrate and free scanners stopped last time */
+	unsigned long		compact_cached_migrate_pfn;
+	unsigned long		compact_cached_free_pfn;
 #endif
 
 	ZONE_PADDING(_pad1_)
@@ -372,6 +390,14 @@ struct zone {
 	 */
 	unsigned int inactive_ratio;
 
+	/*
+	 * Evictions and activations of file pages, the clock refault
+	 * distances are measured with, see mm/workingset.c.  And the
+	 * WORKINGSET_ACTIVATE count reclaim last looked at.
+	 */
+	atomic_long_t inactive_age;
+	unsigned long workingset_activate_seen;
+
 
 	ZONE_PADDING(_pad2_)
 	/* Rarely used or read-mostly fields */
@@ -650,6 +676,11 @@ typedef struct pglist_data {
 	struct task_struct *kswapd;	/* Protected by lock_memory_hotplug() */
 	int kswapd_max_order;
 	enum zone_type classzone_idx;
+#ifdef CONFIG_COMPACTION
+	wait_queue_head_t kcompactd_wait;
+	struct task_struct *kcompactd;	/* Protected by lock_memory_hotplug() */
+	int kcompactd_wake;
+#endif
 } pg_data_t;
 
 #define node_present_pages(nid)	(NODE_DATA(nid)->node_present_pages)
@@ -36,9 +36,18 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		KSWAPD_LOW_WMARK_HIT_QUICKLY, KSWAPD_HIGH_WMARK_HIT_QUICKLY,
 		KSWAPD_SKIP_CONGESTION_WAIT,
 		PAGEOUTRUN, ALLOCSTALL, PGROTATED,
+#ifdef CONFIG_MMU
+		VMAP_PURGE, VMAP_PURGE_PAGES, VMAP_PURGE_USECS,
+		VMAP_RESERVE_HIT, VMAP_RESERVE_REFILL,
+#endif
+#ifdef CONFIG_SWAP
+		SWAP_SLOTS_CACHED, PSWPOUT_MERGED,
+		SWAP_RA, SWAP_RA_HIT, SWAP_RA_MISS,
+#endif
 #ifdef CONFIG_COMPACTION
 		COMPACTBLOCKS, COMPACTPAGES, COMPACTPAGEFAILED,
-		COMPACTSTALL, COMPACTFAIL, COMPACTSUCCESS,
+		COMPACTSTALL, COMPACTFAIL, COMPACTSUCCESS, COMPACTSTALLUSECS,
+		KCOMPACTDWAKE, KCOMPACTDSUCCESS, KCOMPACTDFAIL,
 #endif
 #ifdef CONFIG_HUGETLB_PAGE
 		HTLB_BUDDY_PGALLOC, HTLB_BUDDY_PGALLOC_FAIL,
@@ -8,6 +8,7 @@
 #include <linux/fs.h>
 
 struct backing_dev_info;
+struct bio;
 
 extern spinlock_t inode_wb_list_lock;
 
@@ -51,6 +52,10 @@ struct writeback_control {
 	unsigned for_reclaim:1;		/* Invoked from the page allocator */
 	unsigned range_cyclic:1;	/* range_start is cyclic */
 	unsigned more_io:1;		/* more io to be dispatched */
+
+	struct bio **swap_bio;		/* For reclaim: swap_writepage() may
+					   add the page to this bio instead of
+					   submitting one, see page_io.c */
 };
 
 /*
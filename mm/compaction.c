@@ -14,6 +14,9 @@
 #include <linux/backing-dev.h>
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
+#include <linux/ktime.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -38,6 +41,8 @@ struct compact_control {
 	unsigned int order;		/* order a direct compactor needs */
 	int migratetype;		/* MOVABLE, RECLAIMABLE etc */
 	struct zone *zone;
+	unsigned long deadline;		/* kcompactd: jiffies to stop at */
+	bool resume;			/* Start from the cached scanner pfns */
 };
 
 static unsigned long release_freepages(struct list_head *freelist)
@@ -456,6 +461,10 @@ static int compact_finished(struct zone *zone,
 	if (fatal_signal_pending(current))
 		return COMPACT_PARTIAL;
 
+	/* kcompactd resumes from the cached scanner pfns in its next slice */
+	if (cc->deadline && time_after(jiffies, cc->deadline))
+		return COMPACT_PARTIAL;
+
 	/* Compaction run completes if the migrate and free scanner meet */
 	if (cc->free_pfn <= cc->migrate_pfn)
 		return COMPACT_COMPLETE;
@@ -538,8 +547,19 @@ unsigned long compaction_suitable(struct zone *zone, int order)
 	return COMPACT_CONTINUE;
 }
 
+/* Start kcompactd's scanners over at the ends of the zone */
+static void reset_cached_positions(struct zone *zone)
+{
+	zone->compact_cached_migrate_pfn = zone->zone_start_pfn;
+	zone->compact_cached_free_pfn = zone->zone_start_pfn +
+					zone->spanned_pages;
+	zone->compact_cached_free_pfn &= ~(pageblock_nr_pages-1);
+}
+
 static int compact_zone(struct zone *zone, struct compact_control *cc)
 {
+	unsigned long start_pfn = zone->zone_start_pfn;
+	unsigned long end_pfn = start_pfn + zone->spanned_pages;
 	int ret;
 
 	ret = compaction_suitable(zone, cc->order);
@@ -553,10 +573,20 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 		;
 	}
 
-	/* Setup to move all movable pages to the end of the zone */
-	cc->migrate_pfn = zone->zone_start_pfn;
-	cc->free_pfn = cc->migrate_pfn + zone->spanned_pages;
-	cc->free_pfn &= ~(pageblock_nr_pages-1);
+	if (cc->resume) {
+		/* Unset, or the zone was resized by memory hotplug */
+		if (zone->compact_cached_migrate_pfn < start_pfn ||
+		    zone->compact_cached_free_pfn > end_pfn ||
+		    zone->compact_cached_free_pfn <=
+					zone->compact_cached_migrate_pfn)
+			reset_cached_positions(zone);
+		cc->migrate_pfn = zone->compact_cached_migrate_pfn;
+		cc->free_pfn = zone->compact_cached_free_pfn;
+	} else {
+		/* Setup to move all movable pages to the end of the zone */
+		cc->migrate_pfn = start_pfn;
+		cc->free_pfn = end_pfn & ~(pageblock_nr_pages-1);
+	}
 
 	migrate_prep_local();
 
@@ -604,6 +634,16 @@ out:
 	cc->nr_freepages -= release_freepages(&cc->freepages);
 	VM_BUG_ON(cc->nr_freepages != 0);
 
+	if (cc->resume) {
+		/* Once the scanners met, the next pass starts over */
+		if (ret == COMPACT_COMPLETE) {
+			reset_cached_positions(zone);
+		} else {
+			zone->compact_cached_migrate_pfn = cc->migrate_pfn;
+			zone->compact_cached_free_pfn = cc->free_pfn;
+		}
+	}
+
 	return ret;
 }
 
@@ -647,6 +687,7 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 	struct zoneref *z;
 	struct zone *zone;
 	int rc = COMPACT_SKIPPED;
+	ktime_t start;
 
 	/*
 	 * Check whether it is worth even starting compaction. The order check is
@@ -657,6 +698,7 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 		return rc;
 
 	count_vm_event(COMPACTSTALL);
+	start = ktime_get();
 
 	/* Compact each zone in the list */
 	for_each_zone_zonelist_nodemask(zone, z, zonelist, high_zoneidx,
@@ -671,6 +713,9 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 			break;
 	}
 
+	count_vm_events(COMPACTSTALLUSECS,
+			ktime_us_delta(ktime_get(), start));
+
 	return rc;
 }
 
@@ -743,6 +788,214 @@ int sysctl_extfrag_handler(struct ctl_table *table, int write,
 	return 0;
 }
 
+/*
+ * kcompactd compacts a node in the background whenever one of the orders
+ * set in sysctl_kcompactd_orders would have to be compacted directly, that
+ * is whenever compaction_suitable() says so because the fragmentation index
+ * of the order is above sysctl_extfrag_threshold. It is woken by high-order
+ * allocations entering the slow path and by kswapd before it goes to sleep,
+ * and compacts in slices of KCOMPACTD_SLICE, sleeping after each slice so
+ * that it uses no more than sysctl_kcompactd_cpu_percent of a CPU.
+ */
+int sysctl_kcompactd_orders;
+int sysctl_kcompactd_cpu_percent = 10;
+
+#define KCOMPACTD_SLICE		(HZ / 10 ? HZ / 10 : 1)
+
+static bool kcompactd_node_suitable(pg_data_t *pgdat)
+{
+	int orders = sysctl_kcompactd_orders;
+	int zoneid, order;
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+
+		for (order = 1; order < MAX_ORDER; order++)
+			if ((orders & (1 << order)) &&
+			    compaction_suitable(zone, order) == COMPACT_CONTINUE)
+				return true;
+	}
+
+	return false;
+}
+
+/*
+ * Compact the zones of pgdat for every configured order until it is
+ * available, the zone has been gone through or the order's slice is used
+ * up. Every order gets a slice of its own, and the scanners carry on from
+ * where the previous slice left them. Returns true if a slice ran out.
+ */
+static bool kcompactd_do_work(pg_data_t *pgdat)
+{
+	int orders = sysctl_kcompactd_orders;
+	int zoneid, order;
+	bool more = false;
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+
+		if (!populated_zone(zone))
+			continue;
+
+		for (order = 1; order < MAX_ORDER; order++) {
+			struct compact_control cc = {
+				.nr_freepages = 0,
+				.nr_migratepages = 0,
+				.order = order,
+				.migratetype = MIGRATE_MOVABLE,
+				.zone = zone,
+				.sync = false,
+				.resume = true,
+			};
+			int ret;
+
+			if (!(orders & (1 << order)))
+				continue;
+			if (kthread_should_stop())
+				return false;
+			if (compaction_suitable(zone, order) != COMPACT_CONTINUE)
+				continue;
+
+			INIT_LIST_HEAD(&cc.freepages);
+			INIT_LIST_HEAD(&cc.migratepages);
+
+			cc.deadline = jiffies + KCOMPACTD_SLICE;
+			ret = compact_zone(zone, &cc);
+
+			/* Migration freed to this CPU's lists, let them merge */
+			get_cpu();
+			drain_local_pages(NULL);
+			put_cpu();
+
+			if (compaction_suitable(zone, order) == COMPACT_PARTIAL)
+				count_vm_event(KCOMPACTDSUCCESS);
+			else if (ret == COMPACT_COMPLETE)
+				count_vm_event(KCOMPACTDFAIL);
+
+			if (time_after(jiffies, cc.deadline))
+				more = true;
+		}
+	}
+
+	return more;
+}
+
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+	unsigned long start, ran;
+	bool more;
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(pgdat->kcompactd_wait,
+				     pgdat->kcompactd_wake ||
+				     kthread_should_stop());
+		if (kthread_should_stop())
+			break;
+		pgdat->kcompactd_wake = 0;
+		count_vm_event(KCOMPACTDWAKE);
+
+		do {
+			start = jiffies;
+			more = kcompactd_do_work(pgdat);
+			ran = max(jiffies - start, 1UL);
+
+			/* Stay within the CPU budget */
+			schedule_timeout_interruptible(ran *
+				(100 - sysctl_kcompactd_cpu_percent) /
+				sysctl_kcompactd_cpu_percent);
+			try_to_freeze();
+		} while (more && !kthread_should_stop() &&
+			 kcompactd_node_suitable(pgdat));
+	}
+
+	return 0;
+}
+
+/*
+ * Called by high-order allocations in the slow path and by kswapd; wakes
+ * kcompactd if it is idle and there is something for it to do.
+ */
+void wakeup_kcompactd(pg_data_t *pgdat)
+{
+	if (!sysctl_kcompactd_orders || !pgdat->kcompactd)
+		return;
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+	if (!kcompactd_node_suitable(pgdat))
+		return;
+
+	pgdat->kcompactd_wake = 1;
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+int sysctl_kcompactd_handler(struct ctl_table *table, int write,
+			void __user *buffer, size_t *length, loff_t *ppos)
+{
+	int nid, ret;
+
+	ret = proc_dointvec_minmax(table, write, buffer, length, ppos);
+	if (ret || !write)
+		return ret;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		wakeup_kcompactd(NODE_DATA(nid));
+
+	return 0;
+}
+
+/*
+ * This kcompactd start function will be called by init and node-hot-add.
+ */
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int ret = 0;
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		printk(KERN_ERR "Failed to start kcompactd on node %d\n", nid);
+		ret = PTR_ERR(pgdat->kcompactd);
+		pgdat->kcompactd = NULL;
+	}
+	return ret;
+}
+
+/*
+ * Called by memory hotplug when all memory in a node is offlined.  Caller must
+ * hold lock_memory_hotplug().
+ */
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		kcompactd_run(nid);
+	return 0;
+}
+module_init(kcompactd_init)
+
 #if defined(CONFIG_SYSFS) && defined(CONFIG_NUMA)
 ssize_t sysfs_compact_node(struct sys_device *dev,
 			struct sysdev_attribute *attr,
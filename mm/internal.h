@@ -295,6 +295,11 @@ static inline void mminit_validate_memmodel_limits(unsigned long *start_pfn,
 }
 #endif /* CONFIG_SPARSEMEM */
 
+/* Bulk slab operations done one object at a time, for allocators without their own */
+extern int __kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags,
+				   size_t nr, void **p);
+extern void __kmem_cache_free_bulk(struct kmem_cache *s, size_t nr, void **p);
+
 #define ZONE_RECLAIM_NOSCAN	-2
 #define ZONE_RECLAIM_FULL	-1
 #define ZONE_RECLAIM_SOME	0
@@ -36,6 +36,7 @@
 #include <linux/hash.h>
 #include <linux/freezer.h>
 #include <linux/oom.h>
+#include <linux/seq_file.h>
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -189,6 +190,35 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/* Whether ksmd adapts its batch and sleep to how much it is merging */
+static bool ksm_adaptive;
+
+/* Batch size and sleep currently used by the adaptive scan */
+static unsigned int ksm_adaptive_pages_to_scan = 100;
+static unsigned int ksm_adaptive_sleep_millisecs = 20;
+
+/*
+ * The adaptive scan stays between pages_to_scan and sleep_millisecs and
+ * KSM_ADAPTIVE_MAX_SCALE times them. A batch merging at least one page in
+ * every KSM_ADAPTIVE_MERGE_RATIO it scanned speeds the scan up.
+ */
+#define KSM_ADAPTIVE_MAX_SCALE		16
+#define KSM_ADAPTIVE_MERGE_RATIO	64
+
+/* Pages scanned and merged by ksmd, and the CPU time it spent on it */
+static unsigned long ksm_pages_scanned;
+static unsigned long ksm_pages_merged;
+static u64 ksm_scan_cpu_ns;
+
+/* Whether zero-filled pages are replaced by the shared zero page */
+static bool ksm_use_zero_pages = true;
+
+/* The number of zero-filled pages replaced by the shared zero page */
+static unsigned long ksm_zero_pages_merged;
+
+/* calc_checksum() of a zero-filled page */
+static u32 zero_checksum __read_mostly;
+
 /* Boolean to indicate whether to use deferred timer or not */
 static bool use_deferred_timer;
 
@@ -672,15 +702,47 @@ error:
 }
 #endif /* CONFIG_SYSFS */
 
+/*
+ * The checksum only tells whether a page changed since it was last
+ * scanned, pages are always compared in full before they are merged. So
+ * rather than hashing the whole page, hash KSM_CHECKSUM_LINES chunks of
+ * KSM_CHECKSUM_CHUNK bytes spread over it, each at a different offset
+ * within its part of the page.
+ */
+#define KSM_CHECKSUM_CHUNK	64
+#define KSM_CHECKSUM_LINES	8
+#define KSM_CHECKSUM_STRIDE	(PAGE_SIZE / KSM_CHECKSUM_LINES + \
+				 KSM_CHECKSUM_CHUNK)
+
 static u32 calc_checksum(struct page *page)
 {
-	u32 checksum;
-	void *addr = kmap_atomic(page, KM_USER0);
-	checksum = jhash2(addr, PAGE_SIZE / 4, 17);
+	u32 checksum = 17;
+	char *addr = kmap_atomic(page, KM_USER0);
+	int i;
+
+	for (i = 0; i < KSM_CHECKSUM_LINES; i++)
+		checksum = jhash2((u32 *)(addr + i * KSM_CHECKSUM_STRIDE),
+				  KSM_CHECKSUM_CHUNK / 4, checksum);
 	kunmap_atomic(addr, KM_USER0);
 	return checksum;
 }
 
+static bool page_is_zero(struct page *page)
+{
+	unsigned long *addr = kmap_atomic(page, KM_USER0);
+	unsigned int i;
+	bool ret = true;
+
+	for (i = 0; i < PAGE_SIZE / sizeof(*addr); i++) {
+		if (addr[i]) {
+			ret = false;
+			break;
+		}
+	}
+	kunmap_atomic(addr, KM_USER0);
+	return ret;
+}
+
 static int memcmp_pages(struct page *page1, struct page *page2)
 {
 	char *addr1, *addr2;
@@ -772,6 +834,7 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 	pud_t *pud;
 	pmd_t *pmd;
 	pte_t *ptep;
+	pte_t newpte;
 	spinlock_t *ptl;
 	unsigned long addr;
 	int err = -EFAULT;
@@ -799,12 +862,21 @@ static int replace_page(struct vm_area_struct *vma, struct page *page,
 		goto out;
 	}
 
-	get_page(kpage);
-	page_add_anon_rmap(kpage, vma, addr);
+	if (!is_zero_pfn(page_to_pfn(kpage))) {
+		get_page(kpage);
+		page_add_anon_rmap(kpage, vma, addr);
+		newpte = mk_pte(kpage, vma->vm_page_prot);
+	} else {
+		/* The zero page is mapped as in do_anonymous_page() */
+		newpte = pte_mkspecial(pfn_pte(page_to_pfn(kpage),
+					       vma->vm_page_prot));
+		/* and not counted, do_wp_page() counts its replacement */
+		dec_mm_counter(mm, MM_ANONPAGES);
+	}
 
 	flush_cache_page(vma, addr, pte_pfn(*ptep));
 	ptep_clear_flush(vma, addr, ptep);
-	set_pte_at_notify(mm, addr, ptep, mk_pte(kpage, vma->vm_page_prot));
+	set_pte_at_notify(mm, addr, ptep, newpte);
 
 	page_remove_rmap(page);
 	if (!page_mapped(page))
@@ -946,6 +1018,35 @@ out:
 	return err;
 }
 
+/*
+ * try_to_merge_zero_page - map the shared zero page in place of a
+ * zero-filled anonymous page. Mlocked areas are left alone, the zero page
+ * is not to be mlocked.
+ *
+ * This function returns 0 if the page was replaced, -EFAULT otherwise.
+ */
+static int try_to_merge_zero_page(struct rmap_item *rmap_item,
+				  struct page *page)
+{
+	struct mm_struct *mm = rmap_item->mm;
+	struct vm_area_struct *vma;
+	int err = -EFAULT;
+
+	down_read(&mm->mmap_sem);
+	if (ksm_test_exit(mm))
+		goto out;
+	vma = find_vma(mm, rmap_item->address);
+	if (!vma || vma->vm_start > rmap_item->address ||
+	    (vma->vm_flags & VM_LOCKED))
+		goto out;
+
+	err = try_to_merge_one_page(vma, page,
+				    ZERO_PAGE(rmap_item->address));
+out:
+	up_read(&mm->mmap_sem);
+	return err;
+}
+
 /*
  * try_to_merge_two_pages - take two identical pages and prepare them
  * to be merged into one page.
@@ -1182,6 +1283,20 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 
 	remove_rmap_item_from_tree(rmap_item);
 
+	/*
+	 * A zero-filled page that did not change since the last scan is
+	 * replaced by the zero page straight away, without looking through
+	 * the trees.
+	 */
+	checksum = calc_checksum(page);
+	if (ksm_use_zero_pages && checksum == zero_checksum &&
+	    rmap_item->oldchecksum == checksum && page_is_zero(page)) {
+		if (!try_to_merge_zero_page(rmap_item, page)) {
+			ksm_zero_pages_merged++;
+			return;
+		}
+	}
+
 	/* We first start with searching the page inside the stable tree */
 	kpage = stable_tree_search(page);
 	if (kpage) {
@@ -1194,6 +1309,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			lock_page(kpage);
 			stable_tree_append(rmap_item, page_stable_node(kpage));
 			unlock_page(kpage);
+			ksm_pages_merged++;
 		}
 		put_page(kpage);
 		return;
@@ -1205,7 +1321,6 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 	 * don't want to insert it in the unstable tree, and we don't want
 	 * to waste our time searching for something identical to it there.
 	 */
-	checksum = calc_checksum(page);
 	if (rmap_item->oldchecksum != checksum) {
 		rmap_item->oldchecksum = checksum;
 		return;
@@ -1230,6 +1345,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			if (stable_node) {
 				stable_tree_append(tree_rmap_item, stable_node);
 				stable_tree_append(rmap_item, stable_node);
+				ksm_pages_merged++;
 			}
 			unlock_page(kpage);
 
@@ -1406,6 +1522,36 @@ next_mm:
 	return NULL;
 }
 
+/*
+ * A batch that merged enough doubles the next one and ends any back off.
+ * A batch that merged nothing first shrinks the batch back down to
+ * pages_to_scan, and then doubles the sleep between batches.
+ */
+static void ksm_adapt_scan_rate(unsigned int scanned, unsigned long merged)
+{
+	unsigned long min_pages = max(ksm_thread_pages_to_scan, 1U);
+	unsigned long max_pages = min_t(unsigned long, UINT_MAX,
+				min_pages * KSM_ADAPTIVE_MAX_SCALE);
+	unsigned long min_sleep = ksm_thread_sleep_millisecs;
+	unsigned long max_sleep = min_t(unsigned long, UINT_MAX,
+				min_sleep * KSM_ADAPTIVE_MAX_SCALE);
+	unsigned long pages = ksm_adaptive_pages_to_scan;
+	unsigned long sleep = ksm_adaptive_sleep_millisecs;
+
+	if (merged && merged * KSM_ADAPTIVE_MERGE_RATIO >= scanned) {
+		pages *= 2;
+		sleep = min_sleep;
+	} else if (!merged) {
+		if (pages > min_pages)
+			pages /= 2;
+		else
+			sleep = max(sleep * 2, 1UL);
+	}
+
+	ksm_adaptive_pages_to_scan = clamp(pages, min_pages, max_pages);
+	ksm_adaptive_sleep_millisecs = clamp(sleep, min_sleep, max_sleep);
+}
+
 /**
  * ksm_do_scan  - the ksm scanner main worker function.
  * @scan_npages - number of pages we want to scan before we return.
@@ -1414,16 +1560,25 @@ static void ksm_do_scan(unsigned int scan_npages)
 {
 	struct rmap_item *rmap_item;
 	struct page *uninitialized_var(page);
+	unsigned long merged = ksm_pages_merged;
+	u64 runtime = task_sched_runtime(current);
+	unsigned int scanned = 0;
 
-	while (scan_npages-- && likely(!freezing(current))) {
+	while (scanned < scan_npages && likely(!freezing(current))) {
 		cond_resched();
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
-			return;
+			break;
 		if (!PageKsm(page) || !in_stable_tree(rmap_item))
 			cmp_and_merge_page(page, rmap_item);
 		put_page(page);
+		scanned++;
 	}
+
+	ksm_pages_scanned += scanned;
+	ksm_scan_cpu_ns += task_sched_runtime(current) - runtime;
+	if (ksm_adaptive)
+		ksm_adapt_scan_rate(scanned, ksm_pages_merged - merged);
 }
 
 static void process_timeout(unsigned long __data)
@@ -1468,13 +1623,18 @@ static int ksmd_should_run(void)
 
 static int ksm_scan_thread(void *nothing)
 {
+	unsigned int sleep_ms;
+
 	set_freezable();
 	set_user_nice(current, 5);
 
 	while (!kthread_should_stop()) {
 		mutex_lock(&ksm_thread_mutex);
 		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+			ksm_do_scan(ksm_adaptive ? ksm_adaptive_pages_to_scan :
+				    ksm_thread_pages_to_scan);
+		sleep_ms = ksm_adaptive ? ksm_adaptive_sleep_millisecs :
+			   ksm_thread_sleep_millisecs;
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
@@ -1482,10 +1642,10 @@ static int ksm_scan_thread(void *nothing)
 		if (ksmd_should_run()) {
 			if (use_deferred_timer)
 				deferred_schedule_timeout(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+				msecs_to_jiffies(sleep_ms));
 			else
 				schedule_timeout_interruptible(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+				msecs_to_jiffies(sleep_ms));
 		} else {
 			wait_event_freezable(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -1606,6 +1766,103 @@ void __ksm_exit(struct mm_struct *mm)
 	}
 }
 
+static int ksm_count_zero_pmd(pmd_t *pmd, unsigned long addr,
+			      unsigned long end, struct mm_walk *walk)
+{
+	unsigned long *zero_pages = walk->private;
+	spinlock_t *ptl;
+	pte_t *pte, *orig_pte;
+
+	/* Huge pmds are never the zero page here, and are left unsplit */
+	if (pmd_trans_unstable(pmd))
+		return 0;
+
+	orig_pte = pte = pte_offset_map_lock(walk->mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE)
+		if (pte_present(*pte) && is_zero_pfn(pte_pfn(*pte)))
+			(*zero_pages)++;
+	pte_unmap_unlock(orig_pte, ptl);
+
+	return 0;
+}
+
+/*
+ * ksm_mm_stat - show, for each mergeable vma of mm, how many of its pages
+ * ksmd is tracking and how many of those it has merged, as pages_shared
+ * and pages_sharing do for the whole system, and how many are mapped to
+ * the zero page.  Used for /proc/<pid>/ksm_stat.
+ */
+int ksm_mm_stat(struct seq_file *m, struct mm_struct *mm)
+{
+	struct mm_slot *mm_slot;
+	struct rmap_item *rmap_item = NULL;
+	struct vm_area_struct *vma;
+	unsigned long items, shared, sharing, zero;
+	unsigned long total_items = 0, total_shared = 0;
+	unsigned long total_sharing = 0, total_zero = 0;
+	struct mm_walk zero_walk = {
+		.pmd_entry = ksm_count_zero_pmd,
+		.mm = mm,
+		.private = &zero,
+	};
+
+	/* The rmap_list is only changed by ksmd, under ksm_thread_mutex */
+	mutex_lock(&ksm_thread_mutex);
+	down_read(&mm->mmap_sem);
+
+	spin_lock(&ksm_mmlist_lock);
+	mm_slot = get_mm_slot(mm);
+	if (mm_slot)
+		rmap_item = mm_slot->rmap_list;
+	spin_unlock(&ksm_mmlist_lock);
+
+	for (vma = mm->mmap; vma; vma = vma->vm_next) {
+		if (!(vma->vm_flags & VM_MERGEABLE))
+			continue;
+
+		/* rmap_list is sorted by address, like the vma list */
+		while (rmap_item &&
+		       (rmap_item->address & PAGE_MASK) < vma->vm_start)
+			rmap_item = rmap_item->rmap_list;
+
+		items = shared = sharing = 0;
+		for (; rmap_item &&
+		       (rmap_item->address & PAGE_MASK) < vma->vm_end;
+		     rmap_item = rmap_item->rmap_list) {
+			items++;
+			if (!(rmap_item->address & STABLE_FLAG))
+				continue;
+			if (rmap_item->hlist.next)
+				sharing++;
+			else
+				shared++;
+		}
+
+		zero = 0;
+		if (ksm_use_zero_pages || ksm_zero_pages_merged)
+			walk_page_range(vma->vm_start, vma->vm_end, &zero_walk);
+
+		seq_printf(m, "%08lx-%08lx rmap_items %lu pages_shared %lu "
+			   "pages_sharing %lu zero_pages %lu\n",
+			   vma->vm_start, vma->vm_end, items, shared,
+			   sharing, zero);
+
+		total_items += items;
+		total_shared += shared;
+		total_sharing += sharing;
+		total_zero += zero;
+	}
+
+	up_read(&mm->mmap_sem);
+	mutex_unlock(&ksm_thread_mutex);
+
+	seq_printf(m, "total rmap_items %lu pages_shared %lu "
+		   "pages_sharing %lu zero_pages %lu\n",
+		   total_items, total_shared, total_sharing, total_zero);
+
+	return 0;
+}
+
 struct page *ksm_does_need_to_copy(struct page *page,
 			struct vm_area_struct *vma, unsigned long address)
 {
@@ -2028,6 +2285,118 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t adaptive_show(struct kobject *kobj,
+			     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%d\n", ksm_adaptive);
+}
+
+static ssize_t adaptive_store(struct kobject *kobj,
+			      struct kobj_attribute *attr,
+			      const char *buf, size_t count)
+{
+	unsigned long enable;
+	int err;
+
+	err = kstrtoul(buf, 10, &enable);
+	if (err || enable > 1)
+		return -EINVAL;
+
+	mutex_lock(&ksm_thread_mutex);
+	if (enable && !ksm_adaptive) {
+		ksm_adaptive_pages_to_scan = ksm_thread_pages_to_scan;
+		ksm_adaptive_sleep_millisecs = ksm_thread_sleep_millisecs;
+	}
+	ksm_adaptive = enable;
+	mutex_unlock(&ksm_thread_mutex);
+
+	return count;
+}
+KSM_ATTR(adaptive);
+
+static ssize_t adaptive_pages_to_scan_show(struct kobject *kobj,
+					   struct kobj_attribute *attr,
+					   char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_adaptive ? ksm_adaptive_pages_to_scan :
+		       ksm_thread_pages_to_scan);
+}
+KSM_ATTR_RO(adaptive_pages_to_scan);
+
+static ssize_t adaptive_sleep_millisecs_show(struct kobject *kobj,
+					     struct kobj_attribute *attr,
+					     char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_adaptive ?
+		       ksm_adaptive_sleep_millisecs :
+		       ksm_thread_sleep_millisecs);
+}
+KSM_ATTR_RO(adaptive_sleep_millisecs);
+
+static ssize_t pages_scanned_show(struct kobject *kobj,
+				  struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_scanned);
+}
+KSM_ATTR_RO(pages_scanned);
+
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t scan_cpu_usecs_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		       div_u64(ksm_scan_cpu_ns, NSEC_PER_USEC));
+}
+KSM_ATTR_RO(scan_cpu_usecs);
+
+static ssize_t merge_cost_usecs_show(struct kobject *kobj,
+				     struct kobj_attribute *attr, char *buf)
+{
+	unsigned long merged = ksm_pages_merged;
+	u64 cost = 0;
+
+	if (merged)
+		cost = div64_u64(ksm_scan_cpu_ns, (u64)merged * NSEC_PER_USEC);
+	return sprintf(buf, "%llu\n", cost);
+}
+KSM_ATTR_RO(merge_cost_usecs);
+
+static ssize_t use_zero_pages_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_use_zero_pages);
+}
+
+static ssize_t use_zero_pages_store(struct kobject *kobj,
+				    struct kobj_attribute *attr,
+				    const char *buf, size_t count)
+{
+	unsigned long enable;
+	int err;
+
+	err = strict_strtoul(buf, 10, &enable);
+	if (err || enable > 1)
+		return -EINVAL;
+
+	ksm_use_zero_pages = enable;
+
+	return count;
+}
+KSM_ATTR(use_zero_pages);
+
+static ssize_t zero_pages_merged_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_zero_pages_merged);
+}
+KSM_ATTR_RO(zero_pages_merged);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
@@ -2038,6 +2407,15 @@ static struct attribute *ksm_attrs[] = {
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
 	&deferred_timer_attr.attr,
+	&adaptive_attr.attr,
+	&adaptive_pages_to_scan_attr.attr,
+	&adaptive_sleep_millisecs_attr.attr,
+	&pages_scanned_attr.attr,
+	&pages_merged_attr.attr,
+	&scan_cpu_usecs_attr.attr,
+	&merge_cost_usecs_attr.attr,
+	&use_zero_pages_attr.attr,
+	&zero_pages_merged_attr.attr,
 	NULL,
 };
 
@@ -2056,6 +2434,8 @@ static int __init ksm_init(void)
 	if (err)
 		goto out;
 
+	zero_checksum = calc_checksum(ZERO_PAGE(0));
+
 	ksm_thread = kthread_run(ksm_scan_thread, NULL, "ksmd");
 	if (IS_ERR(ksm_thread)) {
 		printk(KERN_ERR "ksm: creating kthread failed\n");
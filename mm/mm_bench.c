@@ -0,0 +1,122 @@
+/*
+ * mm/mm_bench.c
+ *
+ * Common part of the page_alloc_bench and vmalloc_bench modules: run
+ * batches of allocations and frees on all online CPUs at the same time,
+ * where the lock contention of the allocators shows, and time them with
+ * ktime_get().
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/percpu.h>
+#include <linux/cpu.h>
+#include <linux/sched.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
+#include "mm_bench.h"
+
+struct mm_bench_cpu {
+	struct work_struct work;
+	const struct mm_bench *b;
+	unsigned long nr;
+	u64 alloc_ns;
+	u64 free_ns;
+};
+
+static void mm_bench_cpu_run(struct work_struct *work)
+{
+	struct mm_bench_cpu *bc = container_of(work, struct mm_bench_cpu, work);
+	const struct mm_bench *b = bc->b;
+	void *objs[MM_BENCH_MAX_BATCH];
+	unsigned long done;
+	unsigned int i, n;
+	ktime_t t;
+
+	for (done = 0; done < b->count; done += n) {
+		n = min_t(unsigned long, b->batch, b->count - done);
+
+		t = ktime_get();
+		for (i = 0; i < n; i++) {
+			objs[i] = b->alloc(b->arg);
+			if (!objs[i])
+				break;
+		}
+		bc->alloc_ns += ktime_to_ns(ktime_sub(ktime_get(), t));
+		n = i;
+
+		t = ktime_get();
+		for (i = 0; i < n; i++)
+			b->free(objs[i], b->arg);
+		bc->free_ns += ktime_to_ns(ktime_sub(ktime_get(), t));
+
+		bc->nr += n;
+		if (!n)
+			break;
+		cond_resched();
+	}
+}
+
+/**
+ * mm_bench_run - run an allocator benchmark on all online CPUs
+ * @b: what to allocate and how much
+ * @res: filled in with the cost per object
+ *
+ * Returns 0, -EINVAL for a bad @b or -ENOMEM.
+ */
+int mm_bench_run(const struct mm_bench *b, struct mm_bench_result *res)
+{
+	struct mm_bench_cpu __percpu *bcs;
+	u64 alloc = 0, free = 0;
+	int cpu;
+
+	if (!b->count || !b->batch || b->batch > MM_BENCH_MAX_BATCH)
+		return -EINVAL;
+
+	bcs = alloc_percpu(struct mm_bench_cpu);
+	if (!bcs)
+		return -ENOMEM;
+
+	memset(res, 0, sizeof(*res));
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		struct mm_bench_cpu *bc = per_cpu_ptr(bcs, cpu);
+
+		bc->b = b;
+		INIT_WORK(&bc->work, mm_bench_cpu_run);
+		schedule_work_on(cpu, &bc->work);
+	}
+
+	for_each_online_cpu(cpu) {
+		struct mm_bench_cpu *bc = per_cpu_ptr(bcs, cpu);
+
+		flush_work(&bc->work);
+		if (!bc->nr)
+			continue;
+
+		alloc += bc->alloc_ns;
+		free += bc->free_ns;
+		res->nr += bc->nr;
+		res->alloc_max = max(res->alloc_max,
+				     div64_u64(bc->alloc_ns, bc->nr));
+		res->free_max = max(res->free_max,
+				    div64_u64(bc->free_ns, bc->nr));
+		res->cpus++;
+	}
+	put_online_cpus();
+	free_percpu(bcs);
+
+	if (res->nr) {
+		res->alloc_ns = div64_u64(alloc, res->nr);
+		res->free_ns = div64_u64(free, res->nr);
+	}
+	return 0;
+}
+EXPORT_SYMBOL_GPL(mm_bench_run);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Per-cpu allocator benchmark runner");
@@ -0,0 +1,38 @@
+/* mm_bench.h: per-cpu allocator benchmark runner
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __MM_BENCH_H
+#define __MM_BENCH_H
+
+#include <linux/types.h>
+
+#define MM_BENCH_MAX_BATCH	64
+
+/*
+ * Every online CPU allocates @count objects with ->alloc(@arg), holding
+ * @batch of them at a time before it frees them again with ->free().
+ */
+struct mm_bench {
+	void *(*alloc)(unsigned long arg);
+	void (*free)(void *obj, unsigned long arg);
+	unsigned long arg;
+	unsigned long count;
+	unsigned int batch;
+};
+
+/* Nanoseconds per object, averaged over all CPUs and for the slowest one */
+struct mm_bench_result {
+	int cpus;
+	unsigned long nr;
+	u64 alloc_ns;
+	u64 alloc_max;
+	u64 free_ns;
+	u64 free_max;
+};
+
+extern int mm_bench_run(const struct mm_bench *b, struct mm_bench_result *res);
+
+#endif /* __MM_BENCH_H */
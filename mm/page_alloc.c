@@ -666,6 +666,44 @@ static void free_pcppages_bulk(struct zone *zone, int count,
 	spin_unlock(&zone->lock);
 }
 
+/*
+ * Frees blocks from the high-order PCP lists until at least count pages
+ * went back to the buddy allocator, largest orders and oldest blocks
+ * first.  Unlike free_pcppages_bulk(), this updates pcp->high_order_count.
+ */
+static void free_pcppages_high_bulk(struct zone *zone, int count,
+					struct per_cpu_pages *pcp)
+{
+	int order, migratetype;
+	int freed = 0;
+
+	spin_lock(&zone->lock);
+	zone->all_unreclaimable = 0;
+	zone->pages_scanned = 0;
+
+	for (order = PCP_HIGH_ORDER; order > 0 && freed < count; order--) {
+		for (migratetype = 0; migratetype < MIGRATE_PCPTYPES;
+		     migratetype++) {
+			struct list_head *list;
+			struct page *page;
+
+			list = &pcp->high_order_lists[order - 1][migratetype];
+			while (freed < count && !list_empty(list)) {
+				page = list_entry(list->prev, struct page, lru);
+				list_del(&page->lru);
+				__free_one_page(page, zone, order,
+						page_private(page));
+				trace_mm_page_pcpu_drain(page, order,
+							 page_private(page));
+				freed += 1 << order;
+			}
+		}
+	}
+	pcp->high_order_count -= freed;
+	__mod_zone_page_state(zone, NR_FREE_PAGES, freed);
+	spin_unlock(&zone->lock);
+}
+
 static void free_one_page(struct zone *zone, struct page *page, int order,
 				int migratetype)
 {
@@ -704,9 +742,37 @@ static bool free_pages_prepare(struct page *page, unsigned int order)
 	return true;
 }
 
+/*
+ * Free a block of order 1 to PCP_HIGH_ORDER to the per-cpu lists, the
+ * high-order counterpart of free_hot_cold_page().  Called with interrupts
+ * disabled.
+ */
+static void free_pcp_high_order(struct zone *zone, struct page *page,
+				unsigned int order, int migratetype)
+{
+	struct per_cpu_pages *pcp;
+
+	/* The block may be handed out again without the compound head */
+	if (unlikely(PageCompound(page)))
+		if (unlikely(destroy_compound_page(page, order)))
+			return;
+
+	/* RESERVE blocks share the MOVABLE list, as in free_hot_cold_page */
+	set_page_private(page, migratetype);
+	if (migratetype >= MIGRATE_PCPTYPES)
+		migratetype = MIGRATE_MOVABLE;
+
+	pcp = &this_cpu_ptr(zone->pageset)->pcp;
+	list_add(&page->lru, &pcp->high_order_lists[order - 1][migratetype]);
+	pcp->high_order_count += 1 << order;
+	if (pcp->high_order_count > pcp->high_order_high)
+		free_pcppages_high_bulk(zone, pcp->batch, pcp);
+}
+
 static void __free_pages_ok(struct page *page, unsigned int order)
 {
 	unsigned long flags;
+	int migratetype;
 	int wasMlocked = __TestClearPageMlocked(page);
 
 	if (!free_pages_prepare(page, order))
@@ -716,8 +782,11 @@ static void __free_pages_ok(struct page *page, unsigned int order)
 	if (unlikely(wasMlocked))
 		free_page_mlock(page);
 	__count_vm_events(PGFREE, 1 << order);
-	free_one_page(page_zone(page), page, order,
-					get_pageblock_migratetype(page));
+	migratetype = get_pageblock_migratetype(page);
+	if (order && order <= PCP_HIGH_ORDER && migratetype != MIGRATE_ISOLATE)
+		free_pcp_high_order(page_zone(page), page, order, migratetype);
+	else
+		free_one_page(page_zone(page), page, order, migratetype);
 	local_irq_restore(flags);
 }
 
@@ -1106,6 +1175,8 @@ void drain_zone_pages(struct zone *zone, struct per_cpu_pages *pcp)
 		to_drain = pcp->count;
 	free_pcppages_bulk(zone, to_drain, pcp);
 	pcp->count -= to_drain;
+	if (pcp->high_order_count)
+		free_pcppages_high_bulk(zone, pcp->high_order_count, pcp);
 	local_irq_restore(flags);
 }
 #endif
@@ -1134,6 +1205,9 @@ static void drain_pages(unsigned int cpu)
 			free_pcppages_bulk(zone, pcp->count, pcp);
 			pcp->count = 0;
 		}
+		if (pcp->high_order_count)
+			free_pcppages_high_bulk(zone, pcp->high_order_count,
+						pcp);
 		local_irq_restore(flags);
 	}
 }
@@ -1331,6 +1405,20 @@ struct page *buffered_rmqueue(struct zone *preferred_zone,
 	struct page *page;
 	int cold = !!(gfp_flags & __GFP_COLD);
 
+	if (unlikely(order && (gfp_flags & __GFP_NOFAIL))) {
+		/*
+		 * __GFP_NOFAIL is not to be used in new code.
+		 *
+		 * All __GFP_NOFAIL callers should be fixed so that they
+		 * properly detect and handle allocation failures.
+		 *
+		 * We most definitely don't want callers attempting to
+		 * allocate greater than order-1 page units with
+		 * __GFP_NOFAIL.
+		 */
+		WARN_ON_ONCE(order > 1);
+	}
+
 again:
 	if (likely(order == 0)) {
 		struct per_cpu_pages *pcp;
@@ -1354,20 +1442,27 @@ again:
 
 		list_del(&page->lru);
 		pcp->count--;
+	} else if (order <= PCP_HIGH_ORDER) {
+		struct per_cpu_pages *pcp;
+		struct list_head *list;
+
+		local_irq_save(flags);
+		pcp = &this_cpu_ptr(zone->pageset)->pcp;
+		list = &pcp->high_order_lists[order - 1][migratetype];
+		if (list_empty(list)) {
+			pcp->high_order_misses++;
+			pcp->high_order_count += rmqueue_bulk(zone, order,
+					max(1, pcp->batch >> (order + 1)),
+					list, migratetype, 0) << order;
+			if (unlikely(list_empty(list)))
+				goto failed;
+		} else
+			pcp->high_order_hits++;
+
+		page = list_entry(list->next, struct page, lru);
+		list_del(&page->lru);
+		pcp->high_order_count -= 1 << order;
 	} else {
-		if (unlikely(gfp_flags & __GFP_NOFAIL)) {
-			/*
-			 * __GFP_NOFAIL is not to be used in new code.
-			 *
-			 * All __GFP_NOFAIL callers should be fixed so that they
-			 * properly detect and handle allocation failures.
-			 *
-			 * We most definitely don't want callers attempting to
-			 * allocate greater than order-1 page units with
-			 * __GFP_NOFAIL.
-			 */
-			WARN_ON_ONCE(order > 1);
-		}
 		spin_lock_irqsave(&zone->lock, flags);
 		page = __rmqueue(zone, order, migratetype);
 		spin_unlock(&zone->lock);
@@ -2172,6 +2267,10 @@ restart:
 		wake_all_kswapd(order, zonelist, high_zoneidx,
 						zone_idx(preferred_zone));
 
+	/* Let kcompactd catch up with fragmentation in the background */
+	if (order)
+		wakeup_kcompactd(preferred_zone->zone_pgdat);
+
 	/*
 	 * OK, we're below the kswapd watermark and have kicked background
 	 * reclaim. Now things get more complex, so set up alloc_flags according
@@ -3669,7 +3768,7 @@ static int zone_batchsize(struct zone *zone)
 static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 {
 	struct per_cpu_pages *pcp;
-	int migratetype;
+	int migratetype, order;
 
 	memset(p, 0, sizeof(*p));
 
@@ -3679,6 +3778,13 @@ static void setup_pageset(struct per_cpu_pageset *p, unsigned long batch)
 	pcp->batch = max(1UL, 1 * batch);
 	for (migratetype = 0; migratetype < MIGRATE_PCPTYPES; migratetype++)
 		INIT_LIST_HEAD(&pcp->lists[migratetype]);
+
+	/* The boot pagesets (batch 0) hand every high-order block back */
+	pcp->high_order_high = 2 * batch;
+	for (order = 0; order < PCP_HIGH_ORDER; order++)
+		for (migratetype = 0; migratetype < MIGRATE_PCPTYPES;
+		     migratetype++)
+			INIT_LIST_HEAD(&pcp->high_order_lists[order][migratetype]);
 }
 
 /*
@@ -3696,6 +3802,7 @@ static void setup_pagelist_highmark(struct per_cpu_pageset *p,
 	pcp->batch = max(1UL, high/4);
 	if ((high/4) > (PAGE_SHIFT * 8))
 		pcp->batch = PAGE_SHIFT * 8;
+	pcp->high_order_high = 2 * pcp->batch;
 }
 
 static void setup_zone_pageset(struct zone *zone)
@@ -3786,6 +3893,7 @@ static int __zone_pcp_update(void *data)
 
 		local_irq_save(flags);
 		free_pcppages_bulk(zone, pcp->count, pcp);
+		free_pcppages_high_bulk(zone, pcp->high_order_count, pcp);
 		setup_pageset(pset, batch);
 		local_irq_restore(flags);
 	}
@@ -4394,6 +4502,9 @@ static void __paginginit free_area_init_core(struct pglist_data *pgdat,
 	pgdat->nr_zones = 0;
 	init_waitqueue_head(&pgdat->kswapd_wait);
 	pgdat->kswapd_max_order = 0;
+#ifdef CONFIG_COMPACTION
+	init_waitqueue_head(&pgdat->kcompactd_wait);
+#endif
 	pgdat_page_cgroup_init(pgdat);
 	
 	for (j = 0; j < MAX_NR_ZONES; j++) {
@@ -0,0 +1,75 @@
+/*
+ * mm/page_alloc_bench.c
+ *
+ * Page allocator benchmark. Loading the module allocates and frees blocks
+ * of every order up to PCP_HIGH_ORDER + 1 on all online CPUs at the same
+ * time, which is where zone->lock contention shows, and prints the cost
+ * of alloc_pages() and __free_pages() per order, averaged over the CPUs
+ * and for the slowest CPU. The last order is not cached per cpu and so
+ * serves as the reference. The load then fails so that the module can
+ * simply be loaded again. The per-cpu runs are done by mm_bench.c.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/mm.h>
+#include <linux/gfp.h>
+#include "mm_bench.h"
+
+static unsigned long count = 20000;
+module_param(count, ulong, 0444);
+MODULE_PARM_DESC(count, "Number of blocks allocated per CPU and order");
+
+static unsigned int batch = 8;
+module_param(batch, uint, 0444);
+MODULE_PARM_DESC(batch, "Blocks held at once before they are freed");
+
+static void *bench_alloc_pages(unsigned long order)
+{
+	return alloc_pages(GFP_KERNEL, order);
+}
+
+static void bench_free_pages(void *page, unsigned long order)
+{
+	__free_pages(page, order);
+}
+
+static int __init page_alloc_bench_init(void)
+{
+	struct mm_bench b = {
+		.alloc	= bench_alloc_pages,
+		.free	= bench_free_pages,
+		.count	= count,
+		.batch	= batch,
+	};
+	struct mm_bench_result res;
+	unsigned int order;
+	int ret;
+
+	for (order = 0; order <= PCP_HIGH_ORDER + 1; order++) {
+		b.arg = order;
+		ret = mm_bench_run(&b, &res);
+		if (ret)
+			return ret;
+
+		printk(KERN_INFO "page_alloc_bench: order %u%s on %d cpus, "
+		       "%lu blocks: alloc %llu ns/block (slowest cpu %llu), "
+		       "free %llu ns/block (slowest cpu %llu)\n", order,
+		       order > PCP_HIGH_ORDER ? " (not cached)" : "", res.cpus,
+		       res.nr, res.alloc_ns, res.alloc_max, res.free_ns,
+		       res.free_max);
+	}
+
+	/* Nothing stays loaded, fail so the module can be loaded again */
+	return -EAGAIN;
+}
+module_init(page_alloc_bench_init);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Page allocator benchmark");
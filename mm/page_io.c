@@ -22,12 +22,12 @@
 #include <linux/blkdev.h>
 #include <asm/pgtable.h>
 
-static struct bio *get_swap_bio(gfp_t gfp_flags,
+static struct bio *get_swap_bio(gfp_t gfp_flags, int nr_vecs,
 				struct page *page, bio_end_io_t end_io)
 {
 	struct bio *bio;
 
-	bio = bio_alloc(gfp_flags, 1);
+	bio = bio_alloc(gfp_flags, nr_vecs);
 	if (bio) {
 		bio->bi_sector = map_swap_page(page, &bio->bi_bdev);
 		bio->bi_sector <<= PAGE_SHIFT - 9;
@@ -45,26 +45,35 @@ static struct bio *get_swap_bio(gfp_t gfp_flags,
 static void end_swap_bio_write(struct bio *bio, int err)
 {
 	const int uptodate = test_bit(BIO_UPTODATE, &bio->bi_flags);
-	struct page *page = bio->bi_io_vec[0].bv_page;
-
-	if (!uptodate) {
-		SetPageError(page);
-		/*
-		 * We failed to write the page out to swap-space.
-		 * Re-dirty the page in order to avoid it being reclaimed.
-		 * Also print a dire warning that things will go BAD (tm)
-		 * very quickly.
-		 *
-		 * Also clear PG_reclaim to avoid rotate_reclaimable_page()
-		 */
-		set_page_dirty(page);
-		printk(KERN_ALERT "Write-error on swap-device (%u:%u:%Lu)\n",
-				imajor(bio->bi_bdev->bd_inode),
-				iminor(bio->bi_bdev->bd_inode),
-				(unsigned long long)bio->bi_sector);
-		ClearPageReclaim(page);
+	struct bio_vec *bvec;
+	int i;
+
+	/* Reclaim may have batched several pages, see swap_write_batch() */
+	__bio_for_each_segment(bvec, bio, i, 0) {
+		struct page *page = bvec->bv_page;
+
+		if (!uptodate) {
+			SetPageError(page);
+			/*
+			 * We failed to write the page out to swap-space.
+			 * Re-dirty the page in order to avoid it being
+			 * reclaimed. Also print a dire warning that things
+			 * will go BAD (tm) very quickly.
+			 *
+			 * Also clear PG_reclaim to avoid
+			 * rotate_reclaimable_page()
+			 */
+			set_page_dirty(page);
+			printk(KERN_ALERT "Write-error on swap-device "
+					"(%u:%u:%Lu)\n",
+					imajor(bio->bi_bdev->bd_inode),
+					iminor(bio->bi_bdev->bd_inode),
+					(unsigned long long)bio->bi_sector +
+					(i << (PAGE_SHIFT - 9)));
+			ClearPageReclaim(page);
+		}
+		end_page_writeback(page);
 	}
-	end_page_writeback(page);
 	bio_put(bio);
 }
 
@@ -127,6 +136,47 @@ out:
 	bio_put(bio);
 }
 
+/*
+ * Reclaim writes the swap cache pages of one shrink_page_list() pass with
+ * as few bios as it can: when wbc->swap_bio is set, a page whose slot
+ * follows the last page of that bio is appended to it instead of being
+ * sent down on its own, which makes a run of pages that got consecutive
+ * slots from the per-cpu slot cache one request to the swap device.  The
+ * pending bio is submitted when a page does not fit, or by
+ * swap_write_flush(), which the owner of the bio has to call before it
+ * can wait on the writeback of any of these pages.
+ */
+void swap_write_flush(struct bio **biop)
+{
+	if (*biop) {
+		submit_bio(WRITE, *biop);
+		*biop = NULL;
+	}
+}
+
+static int swap_write_batch(struct page *page, struct bio **biop)
+{
+	struct block_device *bdev;
+	struct bio *bio = *biop;
+	sector_t sector;
+
+	sector = map_swap_page(page, &bdev) << (PAGE_SHIFT - 9);
+	if (bio && bio->bi_bdev == bdev &&
+	    bio->bi_sector + (bio->bi_size >> 9) == sector &&
+	    bio_add_page(bio, page, PAGE_SIZE, 0) == PAGE_SIZE) {
+		count_vm_event(PSWPOUT_MERGED);
+		return 0;
+	}
+
+	swap_write_flush(biop);
+	bio = get_swap_bio(GFP_NOIO, SWAP_CLUSTER_MAX, page,
+			   end_swap_bio_write);
+	if (bio == NULL)
+		return -ENOMEM;
+	*biop = bio;
+	return 0;
+}
+
 /*
  * We may have stale swap cache pages in memory: notice
  * them here and get rid of the unnecessary final write.
@@ -140,7 +190,19 @@ int swap_writepage(struct page *page, struct writeback_control *wbc)
 		unlock_page(page);
 		goto out;
 	}
-	bio = get_swap_bio(GFP_NOIO, page, end_swap_bio_write);
+	if (wbc->swap_bio) {
+		ret = swap_write_batch(page, wbc->swap_bio);
+		if (ret) {
+			set_page_dirty(page);
+			unlock_page(page);
+			goto out;
+		}
+		count_vm_event(PSWPOUT);
+		set_page_writeback(page);
+		unlock_page(page);
+		goto out;
+	}
+	bio = get_swap_bio(GFP_NOIO, 1, page, end_swap_bio_write);
 	if (bio == NULL) {
 		set_page_dirty(page);
 		unlock_page(page);
@@ -164,7 +226,7 @@ int swap_readpage(struct page *page)
 
 	VM_BUG_ON(!PageLocked(page));
 	VM_BUG_ON(PageUptodate(page));
-	bio = get_swap_bio(GFP_KERNEL, page, end_swap_bio_read);
+	bio = get_swap_bio(GFP_KERNEL, 1, page, end_swap_bio_read);
 	if (bio == NULL) {
 		unlock_page(page);
 		ret = -ENOMEM;
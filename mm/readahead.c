@@ -234,6 +234,7 @@ int force_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	}
 	return ret;
 }
+EXPORT_SYMBOL_GPL(force_page_cache_readahead);
 
 /*
  * Given a desired number of PAGE_CACHE_SIZE readahead pages, return a
@@ -0,0 +1,345 @@
+/*
+ * mm/slab_bench.c
+ *
+ * Slab allocator benchmark. Loading the module runs a fixed set of
+ * allocation patterns against a private kmem_cache and against kmalloc(),
+ * prints the cost of every pattern and how densely the live objects were
+ * packed into slab pages, and then fails the load so that it can simply be
+ * loaded again, with other parameters or on a kernel built with another
+ * allocator.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/cpu.h>
+#include <linux/sched.h>
+#include <linux/random.h>
+#include <linux/ktime.h>
+#include <linux/workqueue.h>
+
+#if defined(CONFIG_SLQB)
+#define BENCH_ALLOCATOR	"SLQB"
+#elif defined(CONFIG_SLUB)
+#define BENCH_ALLOCATOR	"SLUB"
+#elif defined(CONFIG_SLAB)
+#define BENCH_ALLOCATOR	"SLAB"
+#else
+#define BENCH_ALLOCATOR	"SLOB"
+#endif
+
+static unsigned int size = 256;
+module_param(size, uint, 0444);
+MODULE_PARM_DESC(size, "Object size of the benchmark cache");
+
+static unsigned int align;
+module_param(align, uint, 0444);
+MODULE_PARM_DESC(align, "Object alignment of the benchmark cache");
+
+static unsigned long count = 100000;
+module_param(count, ulong, 0444);
+MODULE_PARM_DESC(count, "Number of objects allocated by each pattern");
+
+static unsigned int batch = 16;
+module_param(batch, uint, 0444);
+MODULE_PARM_DESC(batch, "Objects allocated and freed together by the batch pattern");
+
+static int remote_cpu = -1;
+module_param(remote_cpu, int, 0444);
+MODULE_PARM_DESC(remote_cpu, "CPU doing the remote frees (default: next online CPU)");
+
+/* Sizes used by the mixed pattern, all served by kmalloc() */
+static const unsigned int mixed_sizes[] = {
+	8, 16, 32, 64, 96, 128, 192, 256, 512, 1024, 2048, 4096,
+};
+
+struct bench_stat {
+	unsigned long nr;
+	u64 ns;
+	u64 max;
+};
+
+struct bench_work {
+	struct bench_stat alloc;
+	struct bench_stat free;
+	unsigned long nr;
+	unsigned long live_bytes;
+	int mixed;
+};
+
+static struct kmem_cache *bench_cache;
+static void **bench_objs;
+
+static inline void bench_account(struct bench_stat *st, ktime_t start,
+				 unsigned long nr)
+{
+	u64 delta = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	st->nr += nr;
+	st->ns += delta;
+	if (delta > st->max)
+		st->max = delta;
+}
+
+/* What a ktime_get() pair costs, included in every measurement */
+static u64 bench_clock_overhead(void)
+{
+	ktime_t start = ktime_get();
+	int i;
+
+	for (i = 0; i < 1000; i++)
+		ktime_get();
+	return div_u64(ktime_to_ns(ktime_sub(ktime_get(), start)), 1000);
+}
+
+/*
+ * Pages held by the allocators. SLOB does not account its pages as slab,
+ * so fall back to everything that is not free; run the benchmark on an
+ * otherwise idle system in that case. Both are read from the global vm
+ * counters, whose per-cpu deltas make them approximate.
+ */
+static long bench_slab_pages(void)
+{
+#ifdef CONFIG_SLOB
+	return -(long)global_page_state(NR_FREE_PAGES);
+#else
+	return global_page_state(NR_SLAB_RECLAIMABLE) +
+		global_page_state(NR_SLAB_UNRECLAIMABLE);
+#endif
+}
+
+static void *bench_alloc_one(struct bench_work *w)
+{
+	unsigned int sz;
+	void *p;
+
+	if (!w->mixed) {
+		p = kmem_cache_alloc(bench_cache, GFP_KERNEL);
+		if (p)
+			w->live_bytes += size;
+		return p;
+	}
+
+	sz = mixed_sizes[random32() % ARRAY_SIZE(mixed_sizes)];
+	p = kmalloc(sz, GFP_KERNEL);
+	if (p)
+		w->live_bytes += sz;
+	return p;
+}
+
+static void bench_free_one(struct bench_work *w, void *p)
+{
+	if (w->mixed)
+		kfree(p);
+	else
+		kmem_cache_free(bench_cache, p);
+}
+
+/* Allocate count objects and keep them, one object per measurement */
+static long bench_fill(void *arg)
+{
+	struct bench_work *w = arg;
+	unsigned long i;
+	ktime_t t;
+
+	for (i = 0; i < count; i++) {
+		t = ktime_get();
+		bench_objs[i] = bench_alloc_one(w);
+		bench_account(&w->alloc, t, 1);
+		if (!bench_objs[i])
+			break;
+		if (!(i & 255))
+			cond_resched();
+	}
+	w->nr = i;
+
+	return 0;
+}
+
+/* Free what bench_fill() allocated, in allocation order */
+static long bench_drain(void *arg)
+{
+	struct bench_work *w = arg;
+	unsigned long i;
+	ktime_t t;
+
+	for (i = 0; i < w->nr; i++) {
+		t = ktime_get();
+		bench_free_one(w, bench_objs[i]);
+		bench_account(&w->free, t, 1);
+		if (!(i & 255))
+			cond_resched();
+	}
+	w->nr = 0;
+
+	return 0;
+}
+
+/* Allocate and free batch objects at a time, one measurement per batch */
+static long bench_batch(void *arg)
+{
+	struct bench_work *w = arg;
+	unsigned long done, i, n;
+	ktime_t t;
+
+	for (done = 0; done < count; done += n) {
+		n = min_t(unsigned long, batch, count - done);
+
+		t = ktime_get();
+		for (i = 0; i < n; i++) {
+			bench_objs[i] = kmem_cache_alloc(bench_cache, GFP_KERNEL);
+			if (!bench_objs[i])
+				break;
+		}
+		bench_account(&w->alloc, t, i);
+		n = i;
+
+		t = ktime_get();
+		for (i = 0; i < n; i++)
+			kmem_cache_free(bench_cache, bench_objs[i]);
+		bench_account(&w->free, t, n);
+
+		if (!n)
+			break;
+		cond_resched();
+	}
+
+	return 0;
+}
+
+/* Same as bench_batch() through the bulk interfaces */
+static long bench_bulk(void *arg)
+{
+	struct bench_work *w = arg;
+	unsigned long done, n;
+	ktime_t t;
+
+	for (done = 0; done < count; done += n) {
+		n = min_t(unsigned long, batch, count - done);
+
+		t = ktime_get();
+		n = kmem_cache_alloc_bulk(bench_cache, GFP_KERNEL, n,
+					  bench_objs);
+		bench_account(&w->alloc, t, n);
+		if (!n)
+			break;
+
+		t = ktime_get();
+		kmem_cache_free_bulk(bench_cache, n, bench_objs);
+		bench_account(&w->free, t, n);
+
+		cond_resched();
+	}
+
+	return 0;
+}
+
+static void bench_report(const char *name, struct bench_work *w)
+{
+	struct bench_stat *a = &w->alloc, *f = &w->free;
+
+	printk(KERN_INFO "slab_bench: %-7s %8lu objects: alloc %4llu ns/object "
+	       "(max %llu), free %4llu ns/object (max %llu)\n", name, a->nr,
+	       a->nr ? div64_u64(a->ns, a->nr) : 0ULL,
+	       (unsigned long long)a->max,
+	       f->nr ? div64_u64(f->ns, f->nr) : 0ULL,
+	       (unsigned long long)f->max);
+}
+
+static void bench_report_usage(const char *name, struct bench_work *w,
+			       long pages)
+{
+	unsigned long slab_kb = pages > 0 ? pages << (PAGE_SHIFT - 10) : 0;
+
+	printk(KERN_INFO "slab_bench: %-7s %8lu objects: %lu kB live in %lu kB "
+	       "of slab pages (%lu%% used)\n", name, w->nr, w->live_bytes >> 10,
+	       slab_kb, slab_kb ? (w->live_bytes >> 10) * 100 / slab_kb : 0);
+}
+
+/*
+ * Fill and drain on one CPU, measuring the packing of the filled cache on
+ * the way. With mixed set the objects come from the kmalloc caches.
+ */
+static void bench_local(const char *name, int cpu, int mixed)
+{
+	struct bench_work w = { .mixed = mixed };
+	long pages;
+
+	pages = bench_slab_pages();
+	work_on_cpu(cpu, bench_fill, &w);
+	pages = bench_slab_pages() - pages;
+	bench_report_usage(name, &w, pages);
+
+	work_on_cpu(cpu, bench_drain, &w);
+	bench_report(name, &w);
+}
+
+static void bench_remote(int cpu, int rcpu)
+{
+	struct bench_work w = { };
+
+	work_on_cpu(cpu, bench_fill, &w);
+	work_on_cpu(rcpu, bench_drain, &w);
+	bench_report("remote", &w);
+}
+
+static int __init slab_bench_init(void)
+{
+	struct bench_work w = { }, wb = { };
+	int cpu, rcpu;
+
+	if (!size || !count || !batch ||
+	    count > ULONG_MAX / sizeof(void *))
+		return -EINVAL;
+
+	bench_objs = vmalloc(count * sizeof(void *));
+	if (!bench_objs)
+		return -ENOMEM;
+
+	bench_cache = kmem_cache_create("slab_bench", size, align, 0, NULL);
+	if (!bench_cache) {
+		vfree(bench_objs);
+		return -ENOMEM;
+	}
+
+	get_online_cpus();
+	cpu = cpumask_first(cpu_online_mask);
+	rcpu = remote_cpu;
+	if (rcpu < 0 || rcpu >= nr_cpu_ids || !cpu_online(rcpu)) {
+		rcpu = cpumask_next(cpu, cpu_online_mask);
+		if (rcpu >= nr_cpu_ids)
+			rcpu = cpu;
+	}
+
+	printk(KERN_INFO "slab_bench: %s, object size %u, align %u, cpu %d, "
+	       "remote cpu %d, clock overhead %llu ns\n", BENCH_ALLOCATOR, size,
+	       align, cpu, rcpu, bench_clock_overhead());
+
+	bench_local("local", cpu, 0);
+	if (rcpu != cpu)
+		bench_remote(cpu, rcpu);
+	work_on_cpu(cpu, bench_batch, &w);
+	bench_report("batch", &w);
+	work_on_cpu(cpu, bench_bulk, &wb);
+	bench_report("bulk", &wb);
+	bench_local("mixed", cpu, 1);
+	put_online_cpus();
+
+	kmem_cache_destroy(bench_cache);
+	vfree(bench_objs);
+
+	/* Nothing stays loaded, fail so the module can be loaded again */
+	return -EAGAIN;
+}
+module_init(slab_bench_init);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Slab allocator benchmark");
@@ -21,6 +21,8 @@
 #include <linux/memory.h>
 #include <linux/fault-inject.h>
 
+#include "internal.h"
+
 /*
  * TODO
  * - fix up releasing of offlined data structures. Not a big deal because
@@ -1811,6 +1813,129 @@ void kmem_cache_free(struct kmem_cache *s, void *object)
 }
 EXPORT_SYMBOL(kmem_cache_free);
 
+/*
+ * Bulk allocation. Whole runs of objects are taken off the per-CPU LIFO
+ * freelist at once, with interrupts disabled once for the batch. When the
+ * freelist runs dry, the main allocation path refills it from remotely
+ * freed objects, partial pages or a new page.
+ *
+ * Debug caches and tasks with a memory policy go one object at a time.
+ */
+int kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t gfpflags, size_t nr,
+			  void **p)
+{
+	struct kmem_cache_list *l;
+	unsigned long flags;
+	void *object;
+	size_t i = 0;
+	size_t n;
+
+	if (unlikely(slab_debug(s)) || (NUMA_BUILD &&
+	    unlikely(current->flags & (PF_SPREAD_SLAB | PF_MEMPOLICY))))
+		return __kmem_cache_alloc_bulk(s, gfpflags, nr, p);
+
+	gfpflags &= gfp_allowed_mask;
+
+	lockdep_trace_alloc(gfpflags);
+	might_sleep_if(gfpflags & __GFP_WAIT);
+
+	if (should_failslab(s->objsize, gfpflags, s->flags))
+		return 0;
+
+	local_irq_save(flags);
+	while (i < nr) {
+		/* __slab_alloc() may have enabled interrupts and migrated us */
+		l = &get_cpu_slab(s, smp_processor_id())->list;
+
+		n = min_t(size_t, nr - i, l->freelist.nr);
+		if (!n) {
+			object = __slab_alloc(s, gfpflags, -1);
+			if (unlikely(!object))
+				break;
+			p[i++] = object;
+			continue;
+		}
+
+		object = l->freelist.head;
+		l->freelist.nr -= n;
+		slqb_stat_add(l, ALLOC, n);
+		do {
+			p[i++] = object;
+			object = get_freepointer(s, object);
+		} while (--n);
+		l->freelist.head = object;
+	}
+	local_irq_restore(flags);
+
+	if (unlikely(i < nr)) {
+		kmem_cache_free_bulk(s, i, p);
+		return 0;
+	}
+
+	if (unlikely(gfpflags & __GFP_ZERO)) {
+		for (i = 0; i < nr; i++)
+			memset(p[i], 0, s->objsize);
+	}
+
+	return nr;
+}
+EXPORT_SYMBOL(kmem_cache_alloc_bulk);
+
+/*
+ * Bulk freeing. Node-local objects are chained together and spliced onto
+ * the per-CPU LIFO freelist in one go, which is then flushed back down to
+ * its high watermark.
+ */
+void kmem_cache_free_bulk(struct kmem_cache *s, size_t nr, void **p)
+{
+	struct kmem_cache_list *l;
+	struct slqb_page *page;
+	void *head = NULL, *tail = NULL;
+	unsigned long flags;
+	void *object;
+	size_t i, n = 0;
+
+	if (unlikely(slab_debug(s))) {
+		__kmem_cache_free_bulk(s, nr, p);
+		return;
+	}
+
+	local_irq_save(flags);
+	l = &get_cpu_slab(s, smp_processor_id())->list;
+	for (i = 0; i < nr; i++) {
+		object = p[i];
+		debug_check_no_locks_freed(object, s->objsize);
+
+		if (NUMA_BUILD && slab_numa(s)) {
+			page = virt_to_head_slqb_page(object);
+			if (slqb_page_to_nid(page) != numa_node_id()) {
+				__slab_free(s, page, object);
+				continue;
+			}
+		}
+
+		set_freepointer(s, object, head);
+		head = object;
+		if (!tail)
+			tail = object;
+		n++;
+	}
+
+	if (n) {
+		set_freepointer(s, tail, l->freelist.head);
+		l->freelist.head = head;
+		if (!l->freelist.nr)
+			l->freelist.tail = tail;
+		l->freelist.nr += n;
+		slqb_stat_add(l, FREE, n);
+
+		while (unlikely(l->freelist.nr > slab_hiwater(s)))
+			flush_free_list(s, l);
+	}
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(kmem_cache_free_bulk);
+
 /*
  * Calculate the order of allocation given an slab object size.
  *
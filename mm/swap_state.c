@@ -19,6 +19,7 @@
 #include <linux/pagevec.h>
 #include <linux/migrate.h>
 #include <linux/page_cgroup.h>
+#include <linux/log2.h>
 
 #include <asm/pgtable.h>
 
@@ -254,20 +255,63 @@ void free_pages_and_swap_cache(struct page **pages, int nr)
 	}
 }
 
+/*
+ * Swap readahead by virtual address keeps its state in the vma: the page
+ * aligned address of the last swap fault, the readahead window chosen for
+ * it in the bits below PAGE_SHIFT, and below that the number of pages read
+ * ahead that were faulted on since.
+ */
+#define SWAP_RA_WIN_SHIFT	(PAGE_SHIFT / 2)
+#define SWAP_RA_HITS_MASK	((1UL << SWAP_RA_WIN_SHIFT) - 1)
+#define SWAP_RA_HITS_MAX	SWAP_RA_HITS_MASK
+#define SWAP_RA_WIN_MASK	(~PAGE_MASK & ~SWAP_RA_HITS_MASK)
+
+#define SWAP_RA_HITS(v)		((v) & SWAP_RA_HITS_MASK)
+#define SWAP_RA_WIN(v)		(((v) & SWAP_RA_WIN_MASK) >> SWAP_RA_WIN_SHIFT)
+#define SWAP_RA_ADDR(v)		((v) & PAGE_MASK)
+
+#define SWAP_RA_VAL(addr, win, hits)				\
+	(((addr) & PAGE_MASK) |					\
+	 (((win) << SWAP_RA_WIN_SHIFT) & SWAP_RA_WIN_MASK) |	\
+	 ((hits) & SWAP_RA_HITS_MASK))
+
+/* Upper bound of the window, whatever page_cluster says */
+#define SWAP_RA_ORDER_CEILING	5
+
 /*
  * Lookup a swap entry in the swap cache. A found page will be returned
  * unlocked and with its refcount incremented - we rely on the kernel
  * lock getting page table operations atomic even if we drop the page
  * lock before returning.
+ *
+ * A page that was read ahead counts as a readahead hit the first time it
+ * is looked up, and for the swap readahead window of @vma if given.
  */
-struct page * lookup_swap_cache(swp_entry_t entry)
+struct page *lookup_swap_cache(swp_entry_t entry, struct vm_area_struct *vma,
+			       unsigned long addr)
 {
 	struct page *page;
 
 	page = find_get_page(&swapper_space, entry.val);
 
-	if (page)
+	if (page) {
 		INC_CACHE_INFO(find_success);
+		if (TestClearPageReadahead(page)) {
+			count_vm_event(SWAP_RA_HIT);
+			if (vma) {
+				unsigned long ra_info, hits;
+
+				ra_info = atomic_long_read(
+						&vma->swap_readahead_info);
+				hits = min(SWAP_RA_HITS(ra_info) + 1,
+					   SWAP_RA_HITS_MAX);
+				atomic_long_set(&vma->swap_readahead_info,
+						SWAP_RA_VAL(addr,
+						SWAP_RA_WIN(ra_info), hits));
+			}
+		}
+	} else
+		count_vm_event(SWAP_RA_MISS);
 
 	INC_CACHE_INFO(find_total);
 	return page;
@@ -278,13 +322,17 @@ struct page * lookup_swap_cache(swp_entry_t entry)
  * and reading the disk if it is not already cached.
  * A failure return means that either the page allocation failed or that
  * the swap entry is no longer in use.
+ * *@new_page_read tells whether a read was started for the page.
  */
-struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
-			struct vm_area_struct *vma, unsigned long addr)
+static struct page *__read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr,
+			bool *new_page_read)
 {
 	struct page *found_page, *new_page = NULL;
 	int err;
 
+	*new_page_read = false;
+
 	do {
 		/*
 		 * First check the swap cache.  Since this is normally
@@ -351,6 +399,7 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 			 */
 			lru_cache_add_anon(new_page);
 			swap_readpage(new_page);
+			*new_page_read = true;
 			return new_page;
 		}
 		radix_tree_preload_end();
@@ -368,6 +417,38 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 	return found_page;
 }
 
+struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	bool new_page_read;
+
+	return __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &new_page_read);
+}
+
+/*
+ * Start reading a page ahead of a fault.  A page that was not in the swap
+ * cache yet is marked PG_readahead, so that lookup_swap_cache() can tell
+ * when the readahead paid off.
+ */
+static bool swap_readahead_page(swp_entry_t entry, gfp_t gfp_mask,
+			struct vm_area_struct *vma, unsigned long addr)
+{
+	struct page *page;
+	bool new_page_read;
+
+	page = __read_swap_cache_async(entry, gfp_mask, vma, addr,
+				       &new_page_read);
+	if (!page)
+		return false;
+	if (new_page_read) {
+		SetPageReadahead(page);
+		count_vm_event(SWAP_RA);
+	}
+	page_cache_release(page);
+	return true;
+}
+
 /**
  * swapin_readahead - swap in pages in hope we need them soon
  * @entry: swap entry of this memory
@@ -391,7 +472,6 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			struct vm_area_struct *vma, unsigned long addr)
 {
 	int nr_pages;
-	struct page *page;
 	unsigned long offset;
 	unsigned long end_offset;
 
@@ -405,12 +485,116 @@ struct page *swapin_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	nr_pages = valid_swaphandles(entry, &offset);
 	for (end_offset = offset + nr_pages; offset < end_offset; offset++) {
 		/* Ok, do the async read-ahead now */
-		page = read_swap_cache_async(swp_entry(swp_type(entry), offset),
-						gfp_mask, vma, addr);
-		if (!page)
+		if (offset == swp_offset(entry))
+			continue;
+		if (!swap_readahead_page(swp_entry(swp_type(entry), offset),
+					 gfp_mask, vma, addr))
 			break;
-		page_cache_release(page);
 	}
 	lru_add_drain();	/* Push any new pages onto the LRU now */
 	return read_swap_cache_async(entry, gfp_mask, vma, addr);
 }
+
+/*
+ * Size the readahead window for a fault at pfn, the last one having been
+ * at prev_pfn.  Every page read ahead that was used since the last fault
+ * grows the window, rounded up to a power of two; without hits it only
+ * reads one page ahead, and only if the faults are moving sequentially.
+ * The window never shrinks by more than half per fault.
+ */
+static unsigned int swap_ra_window(unsigned long prev_pfn, unsigned long pfn,
+				   unsigned int hits, unsigned int max_win,
+				   unsigned int prev_win)
+{
+	unsigned int win = hits + 2;
+
+	if (!hits) {
+		if (pfn != prev_pfn + 1 && pfn + 1 != prev_pfn)
+			win = 1;
+	} else
+		win = max_t(unsigned int, 4, roundup_pow_of_two(win));
+
+	win = min(win, max_win);
+	return max(win, prev_win / 2);
+}
+
+/**
+ * swap_vma_readahead - swap in pages around the faulting address
+ * @fentry: swap entry of the faulting pte
+ * @gfp_mask: memory allocation flags
+ * @vma: user vma the fault is in
+ * @addr: faulting address
+ * @pmd: pmd the faulting pte lives in
+ *
+ * Returns the struct page for @fentry, after queueing swapin.
+ *
+ * Unlike swapin_readahead(), which reads the swap slots next to the one
+ * faulted on, this reads the pages swapped out from the virtual addresses
+ * next to the faulting one, wherever they went in swap.  That is the page
+ * the task is likely to touch next even when reclaim wrote them out of
+ * order, or when the swap device has no notion of seeking, like zram.
+ *
+ * The window follows the direction of the faults: ahead of a fault that
+ * follows the previous one, behind one that precedes it, and around it
+ * otherwise.  Its size comes from swap_ra_window(), bounded by
+ * (1 << page_cluster), the vma, and the page table of the fault.
+ *
+ * Caller must hold down_read on the vma->vm_mm.
+ */
+struct page *swap_vma_readahead(swp_entry_t fentry, gfp_t gfp_mask,
+				struct vm_area_struct *vma, unsigned long addr,
+				pmd_t *pmd)
+{
+	pte_t ptes[1 << SWAP_RA_ORDER_CEILING], *pte;
+	unsigned long ra_info, fpfn, prev_pfn, start, end, lo, hi, pfn;
+	unsigned int max_win, win;
+	int i, nr;
+
+	max_win = 1 << min_t(int, page_cluster, SWAP_RA_ORDER_CEILING);
+	if (max_win == 1)
+		goto out;
+
+	fpfn = addr >> PAGE_SHIFT;
+	ra_info = atomic_long_read(&vma->swap_readahead_info);
+	prev_pfn = SWAP_RA_ADDR(ra_info) >> PAGE_SHIFT;
+	win = swap_ra_window(prev_pfn, fpfn, SWAP_RA_HITS(ra_info), max_win,
+			     SWAP_RA_WIN(ra_info));
+	atomic_long_set(&vma->swap_readahead_info, SWAP_RA_VAL(addr, win, 0));
+	if (win == 1)
+		goto out;
+
+	if (fpfn == prev_pfn + 1)
+		start = fpfn;
+	else if (fpfn + 1 == prev_pfn)
+		start = fpfn + 1 > win ? fpfn + 1 - win : 0;
+	else
+		start = fpfn > (win - 1) / 2 ? fpfn - (win - 1) / 2 : 0;
+	end = start + win;
+
+	lo = max(vma->vm_start, addr & PMD_MASK) >> PAGE_SHIFT;
+	hi = min(vma->vm_end, (addr & PMD_MASK) + PMD_SIZE) >> PAGE_SHIFT;
+	start = max(start, lo);
+	end = min(end, hi);
+
+	/* Copy the ptes, reading in pages may sleep */
+	pte = pte_offset_map(pmd, start << PAGE_SHIFT);
+	for (nr = 0; nr < end - start; nr++)
+		ptes[nr] = pte[nr];
+	pte_unmap(pte);
+
+	for (i = 0, pfn = start; i < nr; i++, pfn++) {
+		swp_entry_t entry;
+
+		if (pfn == fpfn || !is_swap_pte(ptes[i]))
+			continue;
+		entry = pte_to_swp_entry(ptes[i]);
+		if (unlikely(non_swap_entry(entry)))
+			continue;
+		if (!swap_readahead_page(entry, gfp_mask, vma,
+					 pfn << PAGE_SHIFT))
+			break;
+	}
+	lru_add_drain();	/* Push any new pages onto the LRU now */
+out:
+	return read_swap_cache_async(fentry, gfp_mask, vma, addr);
+}
@@ -409,17 +409,25 @@ no_page:
 	return 0;
 }
 
-swp_entry_t get_swap_page(void)
+/*
+ * Allocate up to n swap slots for the swap cache, all from the same device,
+ * with a single swap_lock hold.  Consecutive calls to scan_swap_map() hand
+ * out consecutive offsets within the current cluster, so the slots usually
+ * form one contiguous run.  Returns the number of slots allocated.
+ */
+static int get_swap_pages(int n, swp_entry_t slots[])
 {
 	struct swap_info_struct *si;
 	pgoff_t offset;
 	int type, next;
 	int wrapped = 0;
+	int nr = 0;
 
 	spin_lock(&swap_lock);
 	if (nr_swap_pages <= 0)
 		goto noswap;
-	nr_swap_pages--;
+	n = min_t(long, n, nr_swap_pages);
+	nr_swap_pages -= n;
 
 	for (type = swap_list.next; type >= 0 && wrapped < 2; type = next) {
 		si = swap_info[type];
@@ -437,20 +445,116 @@ swp_entry_t get_swap_page(void)
 
 		swap_list.next = next;
 		/* This is called for allocating swap entry for cache */
-		offset = scan_swap_map(si, SWAP_HAS_CACHE);
-		if (offset) {
-			spin_unlock(&swap_lock);
-			return swp_entry(type, offset);
+		while (nr < n) {
+			offset = scan_swap_map(si, SWAP_HAS_CACHE);
+			if (!offset)
+				break;
+			slots[nr++] = swp_entry(type, offset);
 		}
+		if (nr)
+			break;
 		next = swap_list.next;
 	}
 
-	nr_swap_pages++;
+	nr_swap_pages += n - nr;
 noswap:
 	spin_unlock(&swap_lock);
+	return nr;
+}
+
+/*
+ * Every CPU keeps a few swap slots allocated ahead of time, so that reclaim
+ * takes swap_lock once per SWAP_SLOTS_CACHE_SIZE pages instead of for every
+ * page, and the pages one CPU swaps out in a row get adjacent slots, which
+ * swap_writepage() can then write with one bio.  The cached slots are
+ * marked SWAP_HAS_CACHE and counted as used; they are given back when a
+ * swap device is turned off.  The cache is bypassed once swap space runs
+ * low, so that slots sitting in the caches cannot make allocations fail.
+ */
+#define SWAP_SLOTS_CACHE_SIZE	SWAP_CLUSTER_MAX
+
+struct swap_slots_cache {
+	/*
+	 * The task may be preempted or migrate after put_cpu_var() and
+	 * then share the cache with another task on that CPU; swapoff
+	 * drains the caches of all CPUs.
+	 */
+	struct mutex lock;
+	int nr;
+	int cur;
+	swp_entry_t slots[SWAP_SLOTS_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct swap_slots_cache, swp_slots);
+
+static bool swap_slots_cache_usable(void)
+{
+	return nr_swap_pages >
+		2L * SWAP_SLOTS_CACHE_SIZE * num_online_cpus();
+}
+
+swp_entry_t get_swap_page(void)
+{
+	struct swap_slots_cache *cache;
+	swp_entry_t entry;
+
+	if (!swap_slots_cache_usable())
+		goto direct;
+
+	cache = &get_cpu_var(swp_slots);
+	put_cpu_var(swp_slots);
+
+	mutex_lock(&cache->lock);
+	if (!cache->nr) {
+		cache->cur = 0;
+		cache->nr = get_swap_pages(SWAP_SLOTS_CACHE_SIZE, cache->slots);
+		if (cache->nr > 1)
+			count_vm_events(SWAP_SLOTS_CACHED, cache->nr - 1);
+	}
+	if (cache->nr) {
+		entry = cache->slots[cache->cur++];
+		cache->nr--;
+		mutex_unlock(&cache->lock);
+		return entry;
+	}
+	mutex_unlock(&cache->lock);
+
+direct:
+	if (get_swap_pages(1, &entry))
+		return entry;
 	return (swp_entry_t) {0};
 }
 
+/*
+ * Give all cached swap slots back, so that a device on its way out has no
+ * SWAP_HAS_CACHE entries left that nobody is going to add a page for.
+ */
+static void drain_swap_slots_caches(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct swap_slots_cache *cache = &per_cpu(swp_slots, cpu);
+
+		mutex_lock(&cache->lock);
+		while (cache->nr) {
+			swapcache_free(cache->slots[cache->cur++], NULL);
+			cache->nr--;
+		}
+		mutex_unlock(&cache->lock);
+	}
+}
+
+static int __init swap_slots_cache_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		mutex_init(&per_cpu(swp_slots, cpu).lock);
+	return 0;
+}
+__initcall(swap_slots_cache_init);
+
 /* The only caller of this function is now susupend routine */
 swp_entry_t get_swap_page_of_type(int type)
 {
@@ -1613,6 +1717,8 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 	p->flags &= ~SWP_WRITEOK;
 	spin_unlock(&swap_lock);
 
+	drain_swap_slots_caches();
+
 	oom_score_adj = test_set_oom_score_adj(OOM_SCORE_ADJ_MAX);
 	err = try_to_unuse(type);
 	test_set_oom_score_adj(oom_score_adj);
@@ -2115,6 +2221,8 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 		if (discard_swap(p) == 0 && (swap_flags & SWAP_FLAG_DISCARD))
 			p->flags |= SWP_DISCARDABLE;
 	}
+	if (swap_flags & SWAP_FLAG_READAHEAD_VMA)
+		p->flags |= SWP_VMA_READAHEAD;
 
 	mutex_lock(&swapon_mutex);
 	prio = -1;
@@ -2124,11 +2232,12 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 	enable_swap_info(p, prio, swap_map);
 
 	printk(KERN_INFO "Adding %uk swap on %s.  "
-			"Priority:%d extents:%d across:%lluk %s%s\n",
+			"Priority:%d extents:%d across:%lluk %s%s%s\n",
 		p->pages<<(PAGE_SHIFT-10), name, p->prio,
 		nr_extents, (unsigned long long)span<<(PAGE_SHIFT-10),
 		(p->flags & SWP_SOLIDSTATE) ? "SS" : "",
-		(p->flags & SWP_DISCARDABLE) ? "D" : "");
+		(p->flags & SWP_DISCARDABLE) ? "D" : "",
+		(p->flags & SWP_VMA_READAHEAD) ? "V" : "");
 
 	mutex_unlock(&swapon_mutex);
 	atomic_inc(&proc_poll_event);
@@ -2348,6 +2457,20 @@ int valid_swaphandles(swp_entry_t entry, unsigned long *offset)
 	return nr_pages? ++nr_pages: 0;
 }
 
+/**
+ * swap_use_vma_readahead - should a swap fault read ahead by address
+ * @entry: swap entry of the faulting pte
+ *
+ * Tells whether the swap device of @entry was enabled with
+ * SWAP_FLAG_READAHEAD_VMA, see swap_vma_readahead().
+ */
+bool swap_use_vma_readahead(swp_entry_t entry)
+{
+	struct swap_info_struct *si = swap_info[swp_type(entry)];
+
+	return si && (si->flags & SWP_VMA_READAHEAD);
+}
+
 /*
  * add_swap_count_continuation - called when a swap count is duplicated
  * beyond SWAP_MAP_MAX, it allocates a new page and links that to the entry's
@@ -188,6 +188,30 @@ void kzfree(const void *p)
 }
 EXPORT_SYMBOL(kzfree);
 
+int __kmem_cache_alloc_bulk(struct kmem_cache *s, gfp_t flags, size_t nr,
+			    void **p)
+{
+	size_t i;
+
+	for (i = 0; i < nr; i++) {
+		p[i] = kmem_cache_alloc(s, flags);
+		if (unlikely(!p[i])) {
+			__kmem_cache_free_bulk(s, i, p);
+			return 0;
+		}
+	}
+
+	return nr;
+}
+
+void __kmem_cache_free_bulk(struct kmem_cache *s, size_t nr, void **p)
+{
+	size_t i;
+
+	for (i = 0; i < nr; i++)
+		kmem_cache_free(s, p[i]);
+}
+
 /*
  * strndup_user - duplicate an existing string from user space
  * @s: The string to duplicate
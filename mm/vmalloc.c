@@ -26,6 +26,7 @@
 #include <linux/rcupdate.h>
 #include <linux/pfn.h>
 #include <linux/kmemleak.h>
+#include <linux/ktime.h>
 #include <asm/atomic.h>
 #include <asm/uaccess.h>
 #include <asm/tlbflush.h>
@@ -254,6 +255,7 @@ struct vmap_area {
 	unsigned long va_end;
 	unsigned long flags;
 	struct rb_node rb_node;		/* address sorted rbtree */
+	unsigned long subtree_max_hole;	/* largest va_hole() in subtree */
 	struct list_head list;		/* address sorted list */
 	struct list_head purge_list;	/* "lazy purge" list */
 	struct vm_struct *vm;
@@ -264,14 +266,63 @@ static DEFINE_SPINLOCK(vmap_area_lock);
 static LIST_HEAD(vmap_area_list);
 static struct rb_root vmap_area_root = RB_ROOT;
 
-/* The vmap cache globals are protected by vmap_area_lock */
-static struct rb_node *free_vmap_cache;
-static unsigned long cached_hole_size;
-static unsigned long cached_vstart;
-static unsigned long cached_align;
-
 static unsigned long vmap_area_pcpu_hole;
 
+/*
+ * The rbtree of busy areas is augmented with the free space between them:
+ * every area knows the size of the hole below it, down to the end of the
+ * previous area, and the largest such hole in its subtree. That lets
+ * __find_vmap_hole() skip whole subtrees that have no hole big enough and
+ * find the lowest fitting hole in O(log n), instead of walking the areas
+ * one by one.
+ */
+static unsigned long va_hole(struct vmap_area *va)
+{
+	struct vmap_area *prev;
+
+	if (va->list.prev == &vmap_area_list)
+		return va->va_start;
+	prev = list_entry(va->list.prev, struct vmap_area, list);
+	return va->va_start - prev->va_end;
+}
+
+static unsigned long va_subtree_max_hole(struct rb_node *node)
+{
+	if (!node)
+		return 0;
+	return rb_entry(node, struct vmap_area, rb_node)->subtree_max_hole;
+}
+
+static void vmap_area_augment_cb(struct rb_node *node, void *unused)
+{
+	struct vmap_area *va;
+
+	if (!node)
+		return;
+
+	va = rb_entry(node, struct vmap_area, rb_node);
+	va->subtree_max_hole = max3(va_hole(va),
+				    va_subtree_max_hole(node->rb_left),
+				    va_subtree_max_hole(node->rb_right));
+}
+
+/* The hole below va changed: update it and everything above it */
+static void vmap_area_hole_update(struct vmap_area *va)
+{
+	struct rb_node *node;
+
+	for (node = &va->rb_node; node; node = rb_parent(node))
+		vmap_area_augment_cb(node, NULL);
+}
+
+/* The area after va, whose hole va borders, or NULL */
+static struct vmap_area *va_next(struct vmap_area *va)
+{
+	if (va->list.next == &vmap_area_list)
+		return NULL;
+	return list_entry(va->list.next, struct vmap_area, list);
+}
+
 static struct vmap_area *__find_vmap_area(unsigned long addr)
 {
 	struct rb_node *n = vmap_area_root.rb_node;
@@ -296,6 +347,7 @@ static void __insert_vmap_area(struct vmap_area *va)
 	struct rb_node **p = &vmap_area_root.rb_node;
 	struct rb_node *parent = NULL;
 	struct rb_node *tmp;
+	struct vmap_area *next;
 
 	while (*p) {
 		struct vmap_area *tmp_va;
@@ -321,9 +373,201 @@ static void __insert_vmap_area(struct vmap_area *va)
 		list_add_rcu(&va->list, &prev->list);
 	} else
 		list_add_rcu(&va->list, &vmap_area_list);
+
+	/* va split a hole: the one below the next area shrank */
+	rb_augment_insert(&va->rb_node, vmap_area_augment_cb, NULL);
+	next = va_next(va);
+	if (next)
+		vmap_area_hole_update(next);
+}
+
+/*
+ * Find the lowest hole between vstart and vend where size bytes aligned
+ * to align fit. Returns its address, or vend if there is none. Areas and
+ * vstart are page aligned, so an alignment above a page costs at most
+ * align - PAGE_SIZE bytes of the hole.
+ */
+static unsigned long __find_vmap_hole(unsigned long size, unsigned long align,
+				unsigned long vstart, unsigned long vend)
+{
+	unsigned long length, low_limit, high_limit;
+	unsigned long hole_start, hole_end;
+	struct vmap_area *va;
+
+	length = size;
+	if (align > PAGE_SIZE)
+		length += align - PAGE_SIZE;
+	if (length < size || vend < vstart || vend - vstart < length)
+		return vend;
+
+	/* The hole has to end above low_limit and start below high_limit */
+	low_limit = vstart + length;
+	high_limit = vend - length;
+
+	if (va_subtree_max_hole(vmap_area_root.rb_node) < length)
+		goto check_highest;
+	va = rb_entry(vmap_area_root.rb_node, struct vmap_area, rb_node);
+
+	while (true) {
+		/* Lower addresses first: try the left subtree */
+		hole_end = va->va_start;
+		if (hole_end >= low_limit &&
+		    va_subtree_max_hole(va->rb_node.rb_left) >= length) {
+			va = rb_entry(va->rb_node.rb_left,
+				      struct vmap_area, rb_node);
+			continue;
+		}
+		hole_start = hole_end - va_hole(va);
+check_current:
+		/* Then the hole below this area */
+		if (hole_start > high_limit)
+			return vend;
+		if (hole_end >= low_limit && hole_end - hole_start >= length)
+			goto found;
+
+		/* Then the right subtree */
+		if (va_subtree_max_hole(va->rb_node.rb_right) >= length) {
+			va = rb_entry(va->rb_node.rb_right,
+				      struct vmap_area, rb_node);
+			continue;
+		}
+
+		/* Nothing below here, go up to the next area by address */
+		while (true) {
+			struct rb_node *prev = &va->rb_node;
+
+			if (!rb_parent(prev))
+				goto check_highest;
+			va = rb_entry(rb_parent(prev), struct vmap_area, rb_node);
+			if (prev == va->rb_node.rb_left) {
+				hole_end = va->va_start;
+				hole_start = hole_end - va_hole(va);
+				goto check_current;
+			}
+		}
+	}
+
+check_highest:
+	/* The hole above the last area */
+	hole_start = 0;
+	if (!list_empty(&vmap_area_list))
+		hole_start = list_entry(vmap_area_list.prev,
+					struct vmap_area, list)->va_end;
+	if (hole_start > high_limit)
+		return vend;
+
+found:
+	if (hole_start < vstart)
+		hole_start = vstart;
+	return ALIGN(hole_start, align);
 }
 
 static void purge_vmap_area_lazy(void);
+static void __free_vmap_area(struct vmap_area *va);
+
+/*
+ * Per-cpu reservations.
+ *
+ * Small vmalloc() areas are the most common kind. To keep them off
+ * vmap_area_lock, every CPU holds a few areas of each size up to
+ * VMAP_RESERVE_PAGES pages, guard page included. An allocation that finds
+ * one in its CPU's reserve takes it without touching the lock or the tree.
+ * One that does not carves VMAP_RESERVE_NR more areas out of the same hole
+ * as its own, with a single search. Reserved areas are in the tree like
+ * any busy area, but have never been mapped, so handing them out needs no
+ * flush. They go back to the tree when the address space runs out.
+ */
+#define VMAP_RESERVE_PAGES	8
+#define VMAP_RESERVE_NR		4
+
+struct vmap_reserve {
+	spinlock_t lock;
+	unsigned int nr[VMAP_RESERVE_PAGES];
+	struct vmap_area *va[VMAP_RESERVE_PAGES][VMAP_RESERVE_NR];
+};
+
+static DEFINE_PER_CPU(struct vmap_reserve, vmap_reserve) = {
+	.lock = __SPIN_LOCK_UNLOCKED(vmap_reserve.lock),
+};
+
+static bool vmap_reservable(unsigned long size, unsigned long align,
+			    unsigned long vstart, unsigned long vend)
+{
+	return size <= VMAP_RESERVE_PAGES * PAGE_SIZE && align <= PAGE_SIZE &&
+		vstart == VMALLOC_START && vend == VMALLOC_END;
+}
+
+static struct vmap_area *vmap_reserve_get(unsigned long size)
+{
+	struct vmap_reserve *vr = &get_cpu_var(vmap_reserve);
+	int class = (size >> PAGE_SHIFT) - 1;
+	struct vmap_area *va = NULL;
+
+	spin_lock(&vr->lock);
+	if (vr->nr[class])
+		va = vr->va[class][--vr->nr[class]];
+	spin_unlock(&vr->lock);
+	put_cpu_var(vmap_reserve);
+
+	return va;
+}
+
+/*
+ * Insert the areas of extra one after the other from addr on, and reserve
+ * them for this CPU. Called with vmap_area_lock held. Returns how many were
+ * used, the reserve may have been refilled concurrently.
+ */
+static int __vmap_reserve_fill(struct vmap_area **extra, int nr,
+			       unsigned long addr, unsigned long size)
+{
+	struct vmap_reserve *vr = &__get_cpu_var(vmap_reserve);
+	int class = (size >> PAGE_SHIFT) - 1;
+	int i;
+
+	spin_lock(&vr->lock);
+	nr = min_t(int, nr, VMAP_RESERVE_NR - vr->nr[class]);
+	for (i = 0; i < nr; i++, addr += size) {
+		struct vmap_area *va = extra[i];
+
+		va->va_start = addr;
+		va->va_end = addr + size;
+		va->flags = 0;
+		__insert_vmap_area(va);
+		vr->va[class][vr->nr[class]++] = va;
+	}
+	spin_unlock(&vr->lock);
+
+	return nr;
+}
+
+/* Give all reserved areas back to the tree */
+static void vmap_reserve_drain(void)
+{
+	LIST_HEAD(valist);
+	struct vmap_area *va, *n_va;
+	int cpu, class;
+
+	for_each_possible_cpu(cpu) {
+		struct vmap_reserve *vr = &per_cpu(vmap_reserve, cpu);
+
+		spin_lock(&vr->lock);
+		for (class = 0; class < VMAP_RESERVE_PAGES; class++) {
+			while (vr->nr[class]) {
+				va = vr->va[class][--vr->nr[class]];
+				list_add_tail(&va->purge_list, &valist);
+			}
+		}
+		spin_unlock(&vr->lock);
+	}
+
+	if (list_empty(&valist))
+		return;
+
+	spin_lock(&vmap_area_lock);
+	list_for_each_entry_safe(va, n_va, &valist, purge_list)
+		__free_vmap_area(va);
+	spin_unlock(&vmap_area_lock);
+}
 
 /*
  * Allocate a region of KVA of the specified size and alignment, within the
@@ -335,102 +579,68 @@ static struct vmap_area *alloc_vmap_area(unsigned long size,
 				int node, gfp_t gfp_mask)
 {
 	struct vmap_area *va;
-	struct rb_node *n;
+	struct vmap_area *extra[VMAP_RESERVE_NR];
 	unsigned long addr;
+	int nr_extra = 0, nr_fill, nr_reserved = 0;
 	int purged = 0;
-	struct vmap_area *first;
 
 	BUG_ON(!size);
 	BUG_ON(size & ~PAGE_MASK);
 	BUG_ON(!is_power_of_2(align));
 
+	if (vmap_reservable(size, align, vstart, vend)) {
+		va = vmap_reserve_get(size);
+		if (va) {
+			count_vm_event(VMAP_RESERVE_HIT);
+			return va;
+		}
+		while (nr_extra < VMAP_RESERVE_NR) {
+			extra[nr_extra] = kmalloc_node(sizeof(struct vmap_area),
+					(gfp_mask & GFP_RECLAIM_MASK) |
+					__GFP_NOWARN, node);
+			if (!extra[nr_extra])
+				break;
+			nr_extra++;
+		}
+	}
+
 	va = kmalloc_node(sizeof(struct vmap_area),
 			gfp_mask & GFP_RECLAIM_MASK, node);
-	if (unlikely(!va))
+	if (unlikely(!va)) {
+		while (nr_extra)
+			kfree(extra[--nr_extra]);
 		return ERR_PTR(-ENOMEM);
+	}
 
 retry:
 	spin_lock(&vmap_area_lock);
-	/*
-	 * Invalidate cache if we have more permissive parameters.
-	 * cached_hole_size notes the largest hole noticed _below_
-	 * the vmap_area cached in free_vmap_cache: if size fits
-	 * into that hole, we want to scan from vstart to reuse
-	 * the hole instead of allocating above free_vmap_cache.
-	 * Note that __free_vmap_area may update free_vmap_cache
-	 * without updating cached_hole_size or cached_align.
-	 */
-	if (!free_vmap_cache ||
-			size < cached_hole_size ||
-			vstart < cached_vstart ||
-			align < cached_align) {
-nocache:
-		cached_hole_size = 0;
-		free_vmap_cache = NULL;
-	}
-	/* record if we encounter less permissive parameters */
-	cached_vstart = vstart;
-	cached_align = align;
-
-	/* find starting point for our search */
-	if (free_vmap_cache) {
-		first = rb_entry(free_vmap_cache, struct vmap_area, rb_node);
-		addr = ALIGN(first->va_end, align);
-		if (addr < vstart)
-			goto nocache;
-		if (addr + size - 1 < addr)
-			goto overflow;
-
-	} else {
-		addr = ALIGN(vstart, align);
-		if (addr + size - 1 < addr)
-			goto overflow;
-
-		n = vmap_area_root.rb_node;
-		first = NULL;
-
-		while (n) {
-			struct vmap_area *tmp;
-			tmp = rb_entry(n, struct vmap_area, rb_node);
-			if (tmp->va_end >= addr) {
-				first = tmp;
-				if (tmp->va_start <= addr)
-					break;
-				n = n->rb_left;
-			} else
-				n = n->rb_right;
-		}
-
-		if (!first)
-			goto found;
+	nr_fill = 0;
+	if (nr_extra) {
+		addr = __find_vmap_hole(size * (nr_extra + 1), align,
+					vstart, vend);
+		if (addr != vend)
+			nr_fill = nr_extra;
 	}
-
-	/* from the starting point, walk areas until a suitable hole is found */
-	while (addr + size > first->va_start && addr + size <= vend) {
-		if (addr + cached_hole_size < first->va_start)
-			cached_hole_size = first->va_start - addr;
-		addr = ALIGN(first->va_end, align);
-		if (addr + size - 1 < addr)
+	if (!nr_fill) {
+		addr = __find_vmap_hole(size, align, vstart, vend);
+		if (addr == vend)
 			goto overflow;
-
-		n = rb_next(&first->rb_node);
-		if (n)
-			first = rb_entry(n, struct vmap_area, rb_node);
-		else
-			goto found;
 	}
 
-found:
-	if (addr + size > vend)
-		goto overflow;
-
 	va->va_start = addr;
 	va->va_end = addr + size;
 	va->flags = 0;
 	__insert_vmap_area(va);
-	free_vmap_cache = &va->rb_node;
+	if (nr_fill) {
+		nr_reserved = __vmap_reserve_fill(extra, nr_fill,
+						  addr + size, size);
+		count_vm_event(VMAP_RESERVE_REFILL);
+	}
 	spin_unlock(&vmap_area_lock);
 
+	while (nr_extra > nr_reserved)
+		kfree(extra[--nr_extra]);
+
 	BUG_ON(va->va_start & (align-1));
 	BUG_ON(va->va_start < vstart);
 	BUG_ON(va->va_end > vend);
@@ -441,6 +651,7 @@ overflow:
 	spin_unlock(&vmap_area_lock);
 	if (!purged) {
 		purge_vmap_area_lazy();
+		vmap_reserve_drain();
 		purged = 1;
 		goto retry;
 	}
@@ -448,6 +659,8 @@ overflow:
 		printk(KERN_WARNING
 			"vmap allocation for size %lu failed: "
 			"use vmalloc=<size> to increase size.\n", size);
+	while (nr_extra)
+		kfree(extra[--nr_extra]);
 	kfree(va);
 	return ERR_PTR(-EBUSY);
 }
@@ -461,27 +674,22 @@ static void rcu_free_va(struct rcu_head *head)
 
 static void __free_vmap_area(struct vmap_area *va)
 {
+	struct vmap_area *next;
+	struct rb_node *deepest;
+
 	BUG_ON(RB_EMPTY_NODE(&va->rb_node));
 
-	if (free_vmap_cache) {
-		if (va->va_end < cached_vstart) {
-			free_vmap_cache = NULL;
-		} else {
-			struct vmap_area *cache;
-			cache = rb_entry(free_vmap_cache, struct vmap_area, rb_node);
-			if (va->va_start <= cache->va_start) {
-				free_vmap_cache = rb_prev(&va->rb_node);
-				/*
-				 * We don't try to update cached_hole_size or
-				 * cached_align, but it won't go very wrong.
-				 */
-			}
-		}
-	}
+	next = va_next(va);
+	deepest = rb_augment_erase_begin(&va->rb_node);
 	rb_erase(&va->rb_node, &vmap_area_root);
 	RB_CLEAR_NODE(&va->rb_node);
 	list_del_rcu(&va->list);
 
+	/* The hole of va joins the one below the next area */
+	rb_augment_erase_end(deepest, vmap_area_augment_cb, NULL);
+	if (next)
+		vmap_area_hole_update(next);
+
 	/*
 	 * Track the highest possible candidate for pcpu area
 	 * allocation.  Areas outside of vmalloc area can be returned
@@ -589,6 +797,7 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 	LIST_HEAD(valist);
 	struct vmap_area *va;
 	struct vmap_area *n_va;
+	ktime_t begin;
 	int nr = 0;
 
 	/*
@@ -602,6 +811,7 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 	} else
 		spin_lock(&purge_lock);
 
+	begin = ktime_get();
 	if (sync)
 		purge_fragmented_blocks_allcpus();
 
@@ -632,6 +842,13 @@ static void __purge_vmap_area_lazy(unsigned long *start, unsigned long *end,
 			__free_vmap_area(va);
 		spin_unlock(&vmap_area_lock);
 	}
+
+	if (nr || force_flush) {
+		count_vm_event(VMAP_PURGE);
+		count_vm_events(VMAP_PURGE_PAGES, nr);
+		count_vm_events(VMAP_PURGE_USECS,
+				ktime_us_delta(ktime_get(), begin));
+	}
 	spin_unlock(&purge_lock);
 }
 
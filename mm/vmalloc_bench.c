@@ -0,0 +1,79 @@
+/*
+ * mm/vmalloc_bench.c
+ *
+ * vmalloc benchmark. Loading the module vmallocs and vfrees areas of a
+ * few sizes on all online CPUs at the same time, which is where
+ * vmap_area_lock contention and lazy purging show, and prints the cost of
+ * vmalloc() and vfree() per size, averaged over the CPUs and for the
+ * slowest CPU. The sizes up to 7 pages are served from the per-cpu
+ * reservations, the larger ones always search the tree. The vmap_purge
+ * and vmap_reserve counters in /proc/vmstat tell how often the lazily
+ * freed areas were purged and what that cost. The load then fails so that
+ * the module can simply be loaded again. The per-cpu runs are done by
+ * mm_bench.c.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include "mm_bench.h"
+
+static unsigned long count = 20000;
+module_param(count, ulong, 0444);
+MODULE_PARM_DESC(count, "Number of areas allocated per CPU and size");
+
+static unsigned int batch = 16;
+module_param(batch, uint, 0444);
+MODULE_PARM_DESC(batch, "Areas held at once before they are freed");
+
+/* In pages; one page less than the area, which includes a guard page */
+static const unsigned int bench_pages[] = { 1, 2, 4, 7, 16, 64 };
+
+static void *bench_vmalloc(unsigned long size)
+{
+	return vmalloc(size);
+}
+
+static void bench_vfree(void *addr, unsigned long size)
+{
+	vfree(addr);
+}
+
+static int __init vmalloc_bench_init(void)
+{
+	struct mm_bench b = {
+		.alloc	= bench_vmalloc,
+		.free	= bench_vfree,
+		.count	= count,
+		.batch	= batch,
+	};
+	struct mm_bench_result res;
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(bench_pages); i++) {
+		b.arg = bench_pages[i] * PAGE_SIZE;
+		ret = mm_bench_run(&b, &res);
+		if (ret)
+			return ret;
+
+		printk(KERN_INFO "vmalloc_bench: %u pages on %d cpus, "
+		       "%lu areas: vmalloc %llu ns/area (slowest cpu %llu), "
+		       "vfree %llu ns/area (slowest cpu %llu)\n",
+		       bench_pages[i], res.cpus, res.nr, res.alloc_ns,
+		       res.alloc_max, res.free_ns, res.free_max);
+	}
+
+	/* Nothing stays loaded, fail so the module can be loaded again */
+	return -EAGAIN;
+}
+module_init(vmalloc_bench_init);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("vmalloc benchmark");
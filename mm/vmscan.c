@@ -443,7 +443,7 @@ typedef enum {
  * Calls ->writepage().
  */
 static pageout_t pageout(struct page *page, struct address_space *mapping,
-			 struct scan_control *sc)
+			 struct scan_control *sc, struct bio **swap_bio)
 {
 	/*
 	 * If the page is dirty, only perform writeback if that write
@@ -492,6 +492,10 @@ static pageout_t pageout(struct page *page, struct address_space *mapping,
 			.for_reclaim = 1,
 		};
 
+		/* Batched swap writes are not waited on below */
+		if (!(sc->reclaim_mode & RECLAIM_MODE_SYNC))
+			wbc.swap_bio = swap_bio;
+
 		SetPageReclaim(page);
 		res = mapping->a_ops->writepage(page, &wbc);
 		if (res < 0)
@@ -527,7 +531,8 @@ static pageout_t pageout(struct page *page, struct address_space *mapping,
  * Same as remove_mapping, but if the page is removed from the mapping, it
  * gets returned with a refcount of 0.
  */
-static int __remove_mapping(struct address_space *mapping, struct page *page)
+static int __remove_mapping(struct address_space *mapping, struct page *page,
+			    bool reclaimed)
 {
 	BUG_ON(!PageLocked(page));
 	BUG_ON(mapping != page_mapping(page));
@@ -576,6 +581,8 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 
 		freepage = mapping->a_ops->freepage;
 
+		if (reclaimed && page_is_file_cache(page))
+			workingset_eviction(mapping, page);
 		__delete_from_page_cache(page);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
@@ -599,7 +606,7 @@ cannot_free:
  */
 int remove_mapping(struct address_space *mapping, struct page *page)
 {
-	if (__remove_mapping(mapping, page)) {
+	if (__remove_mapping(mapping, page, false)) {
 		/*
 		 * Unfreezing the refcount with 1 rather than 2 effectively
 		 * drops the pagecache ref for us without requiring another
@@ -779,6 +786,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 	unsigned long nr_dirty = 0;
 	unsigned long nr_congested = 0;
 	unsigned long nr_reclaimed = 0;
+	struct bio *swap_bio = NULL;
 
 	cond_resched();
 
@@ -824,9 +832,10 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			 * started.
 			 */
 			if ((sc->reclaim_mode & RECLAIM_MODE_SYNC) &&
-			    may_enter_fs)
+			    may_enter_fs) {
+				swap_write_flush(&swap_bio);
 				wait_on_page_writeback(page);
-			else {
+			} else {
 				unlock_page(page);
 				goto keep_lumpy;
 			}
@@ -884,8 +893,16 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			if (!sc->may_writepage)
 				goto keep_locked;
 
+			/*
+			 * Swap cache pages are collected in swap_bio, which
+			 * is sent down before writing any other page so that
+			 * a filesystem never waits on pages we still hold.
+			 */
+			if (!PageSwapCache(page))
+				swap_write_flush(&swap_bio);
+
 			/* Page is dirty, try to write it out here */
-			switch (pageout(page, mapping, sc)) {
+			switch (pageout(page, mapping, sc, &swap_bio)) {
 			case PAGE_KEEP:
 				nr_congested++;
 				goto keep_locked;
@@ -953,7 +970,7 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			}
 		}
 
-		if (!mapping || !__remove_mapping(mapping, page))
+		if (!mapping || !__remove_mapping(mapping, page, true))
 			goto keep_locked;
 
 		/*
@@ -998,6 +1015,8 @@ keep_lumpy:
 		VM_BUG_ON(PageLRU(page) || PageUnevictable(page));
 	}
 
+	swap_write_flush(&swap_bio);
+
 	/*
 	 * Tag a zone as congested if all the dirty pages encountered were
 	 * backed by a congested BDI. In this case, reclaimers should just
@@ -1782,6 +1801,15 @@ static int inactive_file_is_low_global(struct zone *zone)
 	active = zone_page_state(zone, NR_ACTIVE_FILE);
 	inactive = zone_page_state(zone, NR_INACTIVE_FILE);
 
+	/*
+	 * Refaults that were activated since the last reclaim pass mean a
+	 * new workingset is being established: stop protecting the active
+	 * list so that the stale workingset is aged out quickly.
+	 */
+	if (zone_page_state(zone, WORKINGSET_ACTIVATE) !=
+	    zone->workingset_activate_seen)
+		return active != 0;
+
 	return (active > inactive);
 }
 
@@ -2086,6 +2114,11 @@ restart:
 					sc->nr_scanned - nr_scanned, sc))
 		goto restart;
 
+	/* Refaults activated until now have been seen by this pass */
+	if (scanning_global_lru(sc))
+		zone->workingset_activate_seen =
+			zone_page_state(zone, WORKINGSET_ACTIVATE);
+
 	throttle_vm_writeout(sc->gfp_mask);
 
 	vmpressure(sc->gfp_mask, sc->mem_cgroup,
@@ -2871,6 +2904,9 @@ static void kswapd_try_to_sleep(pg_data_t *pgdat, int order, int classzone_idx)
 		 */
 		set_pgdat_percpu_threshold(pgdat, calculate_normal_threshold);
 
+		/* Reclaim is done, compaction may pick up from here */
+		wakeup_kcompactd(pgdat);
+
 		if (!kthread_should_stop())
 			schedule();
 
@@ -470,7 +470,7 @@ void refresh_cpu_vm_stats(int cpu)
 		 * Check if there are pages remaining in this pageset
 		 * if not then there is nothing to expire.
 		 */
-		if (!p->expire || !p->pcp.count)
+		if (!p->expire || (!p->pcp.count && !p->pcp.high_order_count))
 			continue;
 
 		/*
@@ -485,7 +485,7 @@ void refresh_cpu_vm_stats(int cpu)
 		if (p->expire)
 			continue;
 
-		if (p->pcp.count)
+		if (p->pcp.count || p->pcp.high_order_count)
 			drain_zone_pages(zone, &p->pcp);
 #endif
 	}
@@ -708,6 +708,8 @@ const char * const vmstat_text[] = {
 	"nr_shmem",
 	"nr_dirtied",
 	"nr_written",
+	"workingset_refault",
+	"workingset_activate",
 
 #ifdef CONFIG_NUMA
 	"numa_hit",
@@ -756,6 +758,22 @@ const char * const vmstat_text[] = {
 
 	"pgrotated",
 
+#ifdef CONFIG_MMU
+	"vmap_purge",
+	"vmap_purge_pages",
+	"vmap_purge_usecs",
+	"vmap_reserve_hit",
+	"vmap_reserve_refill",
+#endif
+
+#ifdef CONFIG_SWAP
+	"swap_slots_cached",
+	"pswpout_merged",
+	"swap_ra",
+	"swap_ra_hit",
+	"swap_ra_miss",
+#endif
+
 #ifdef CONFIG_COMPACTION
 	"compact_blocks_moved",
 	"compact_pages_moved",
@@ -763,6 +781,10 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_stall_usecs",
+	"compact_daemon_wake",
+	"compact_daemon_success",
+	"compact_daemon_fail",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -1004,11 +1026,19 @@ static void zoneinfo_show_print(struct seq_file *m, pg_data_t *pgdat,
 			   "\n    cpu: %i"
 			   "\n              count: %i"
 			   "\n              high:  %i"
-			   "\n              batch: %i",
+			   "\n              batch: %i"
+			   "\n   high-order count:  %i"
+			   "\n   high-order high:   %i"
+			   "\n   high-order hits:   %lu"
+			   "\n   high-order misses: %lu",
 			   i,
 			   pageset->pcp.count,
 			   pageset->pcp.high,
-			   pageset->pcp.batch);
+			   pageset->pcp.batch,
+			   pageset->pcp.high_order_count,
+			   pageset->pcp.high_order_high,
+			   pageset->pcp.high_order_hits,
+			   pageset->pcp.high_order_misses);
 #ifdef CONFIG_SMP
 		seq_printf(m, "\n  vm stats threshold: %d",
 				pageset->stat_threshold);
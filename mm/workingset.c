@@ -0,0 +1,184 @@
+/*
+ * mm/workingset.c
+ *
+ * Workingset detection for the page cache.
+ *
+ * Every zone has an "inactive age" clock that ticks whenever a page leaves
+ * the inactive file list, by being evicted or activated. When reclaim
+ * evicts a page cache page, the clock reading is recorded for the page's
+ * mapping and index. If the page is faulted back in later, the distance
+ * between the clock at eviction and the clock now is how many more slots
+ * the inactive list would have needed to keep the page in memory:
+ *
+ *   - a refault distance no larger than the active file list means that
+ *     the page would have stayed resident had it been competing with the
+ *     active pages, so it is put straight on the active list;
+ *   - anything further away is a page that is used less often than the
+ *     pages in memory, and starts out on the inactive list as usual.
+ *
+ * Activated refaults are also a sign that the set of pages in use has
+ * changed, and reclaim stops protecting the active list then, see
+ * inactive_file_is_low_global().
+ *
+ * The eviction records are kept in a hash table, one record per bucket,
+ * indexed by a hash of the mapping and the page index; a new record
+ * simply replaces whatever was in the bucket. The table is sized at one
+ * bucket for every two pages of memory, which covers refault distances of
+ * about the size of memory, beyond which a refault is not acted on
+ * anyway. Records are read and written without locking. A record torn by
+ * a concurrent update can only make one refault look closer or further
+ * than it was.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/swap.h>
+#include <linux/vmstat.h>
+#include <linux/bootmem.h>
+#include <linux/hash.h>
+#include <linux/jhash.h>
+#include <linux/init.h>
+
+/* A cookie holds the zone and the inactive age at the time of eviction */
+#define COOKIE_ZONE_SHIFT	(NODES_SHIFT + ZONES_SHIFT)
+#define COOKIE_ZONE_MASK	((1U << COOKIE_ZONE_SHIFT) - 1)
+#define COOKIE_AGE_MASK		(~0U >> COOKIE_ZONE_SHIFT)
+
+struct shadow_entry {
+	u32 key;		/* hash of mapping and index, 0 if unused */
+	u32 cookie;
+};
+
+static struct shadow_entry *shadow_table __read_mostly;
+static unsigned int shadow_mask __read_mostly;
+
+static u32 shadow_key(struct address_space *mapping, pgoff_t index)
+{
+	u32 key = jhash_2words(hash_ptr(mapping, 32), (u32)index, 0);
+
+	return key ? key : 1;
+}
+
+static struct shadow_entry *shadow_entry(u32 key)
+{
+	return &shadow_table[key & shadow_mask];
+}
+
+static u32 pack_cookie(struct zone *zone, unsigned long age)
+{
+	u32 zone_id = zone_to_nid(zone) * MAX_NR_ZONES + zone_idx(zone);
+
+	return ((u32)age << COOKIE_ZONE_SHIFT) | zone_id;
+}
+
+static struct zone *unpack_cookie(u32 cookie, unsigned long *age)
+{
+	u32 zone_id = cookie & COOKIE_ZONE_MASK;
+	int nid = zone_id / MAX_NR_ZONES;
+
+	if (nid >= MAX_NUMNODES || !node_online(nid))
+		return NULL;
+
+	*age = cookie >> COOKIE_ZONE_SHIFT;
+	return &NODE_DATA(nid)->node_zones[zone_id % MAX_NR_ZONES];
+}
+
+/**
+ * workingset_eviction - note the eviction of a page cache page
+ * @mapping: address space the page was mapped to
+ * @page: the page being evicted
+ *
+ * Called by reclaim with the page locked and mapping->tree_lock held,
+ * right before the page is removed from the page cache.
+ */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct shadow_entry *entry;
+	unsigned long age;
+	u32 key;
+
+	age = atomic_long_inc_return(&page_zone(page)->inactive_age);
+	if (!shadow_table)
+		return;
+
+	key = shadow_key(mapping, page->index);
+	entry = shadow_entry(key);
+	entry->cookie = pack_cookie(page_zone(page), age);
+	smp_wmb();
+	entry->key = key;
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @mapping: address space the page is added to
+ * @index: index of the page in @mapping
+ *
+ * Returns %true if the page was evicted recently enough that it should be
+ * activated right away, see the comment at the top of this file.
+ */
+bool workingset_refault(struct address_space *mapping, pgoff_t index)
+{
+	struct shadow_entry *entry;
+	unsigned long eviction, refault, distance;
+	struct zone *zone;
+	u32 key, cookie;
+
+	if (!shadow_table)
+		return false;
+
+	key = shadow_key(mapping, index);
+	entry = shadow_entry(key);
+	if (ACCESS_ONCE(entry->key) != key)
+		return false;
+	smp_rmb();
+	cookie = entry->cookie;
+
+	/* Consume the record, a refault is only acted on once */
+	if (cmpxchg(&entry->key, key, 0) != key)
+		return false;
+
+	zone = unpack_cookie(cookie, &eviction);
+	if (!zone)
+		return false;
+
+	refault = atomic_long_read(&zone->inactive_age);
+	distance = (refault - eviction) & COOKIE_AGE_MASK;
+
+	inc_zone_state(zone, WORKINGSET_REFAULT);
+	if (distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		inc_zone_state(zone, WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+static int __init workingset_init(void)
+{
+	struct shadow_entry *table;
+	unsigned int shift;
+
+	table = alloc_large_system_hash("Workingset shadow",
+					sizeof(struct shadow_entry),
+					max(totalram_pages / 2, 1UL), 0, 0,
+					&shift, &shadow_mask, 0);
+	memset(table, 0, sizeof(struct shadow_entry) << shift);
+
+	/* Reclaim may be running already */
+	smp_wmb();
+	shadow_table = table;
+	return 0;
+}
+module_init(workingset_init);
@@ -58,6 +58,7 @@
 #include <linux/scatterlist.h>
 #include <linux/errqueue.h>
 #include <linux/prefetch.h>
+#include <linux/cpu.h>
 
 #include <net/protocol.h>
 #include <net/dst.h>
@@ -74,6 +75,81 @@
 static struct kmem_cache *skbuff_head_cache __read_mostly;
 static struct kmem_cache *skbuff_fclone_cache __read_mostly;
 
+/*
+ * Heads allocated and freed in softirq context, i.e. by the RX and TX
+ * completion paths, go through a small per-CPU stack that is refilled
+ * and trimmed with the slab bulk interfaces.
+ */
+#define SKB_HEAD_CACHE_SIZE	64
+#define SKB_HEAD_CACHE_BULK	16
+
+struct skb_head_cache {
+	unsigned int	count;
+	void		*heads[SKB_HEAD_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct skb_head_cache, skb_head_cache);
+
+/* Softirqs do not nest, so nothing else touches the cache meanwhile */
+static inline bool skb_head_cache_usable(void)
+{
+	return in_softirq() && !in_irq();
+}
+
+static struct sk_buff *skb_head_alloc(gfp_t gfp_mask, int node)
+{
+	struct skb_head_cache *hc;
+
+	if (node != NUMA_NO_NODE || !skb_head_cache_usable())
+		return kmem_cache_alloc_node(skbuff_head_cache, gfp_mask, node);
+
+	hc = &__get_cpu_var(skb_head_cache);
+	if (unlikely(!hc->count)) {
+		hc->count = kmem_cache_alloc_bulk(skbuff_head_cache, gfp_mask,
+						  SKB_HEAD_CACHE_BULK,
+						  hc->heads);
+		/* The bulk refill is all or nothing, one head may still fit */
+		if (unlikely(!hc->count))
+			return kmem_cache_alloc_node(skbuff_head_cache,
+						     gfp_mask, node);
+	}
+
+	return hc->heads[--hc->count];
+}
+
+static void skb_head_free(struct sk_buff *skb)
+{
+	struct skb_head_cache *hc;
+
+	if (!skb_head_cache_usable()) {
+		kmem_cache_free(skbuff_head_cache, skb);
+		return;
+	}
+
+	hc = &__get_cpu_var(skb_head_cache);
+	if (unlikely(hc->count == SKB_HEAD_CACHE_SIZE)) {
+		hc->count -= SKB_HEAD_CACHE_SIZE / 2;
+		kmem_cache_free_bulk(skbuff_head_cache, SKB_HEAD_CACHE_SIZE / 2,
+				     hc->heads + hc->count);
+	}
+	hc->heads[hc->count++] = skb;
+}
+
+static int skb_cpu_callback(struct notifier_block *nfb,
+			    unsigned long action, void *hcpu)
+{
+	struct skb_head_cache *hc;
+
+	if (action != CPU_DEAD && action != CPU_DEAD_FROZEN)
+		return NOTIFY_OK;
+
+	hc = &per_cpu(skb_head_cache, (unsigned long)hcpu);
+	kmem_cache_free_bulk(skbuff_head_cache, hc->count, hc->heads);
+	hc->count = 0;
+
+	return NOTIFY_OK;
+}
+
 static void sock_pipe_buf_release(struct pipe_inode_info *pipe,
 				  struct pipe_buffer *buf)
 {
@@ -171,15 +247,16 @@ static void skb_under_panic(struct sk_buff *skb, int sz, void *here)
 struct sk_buff *__alloc_skb(unsigned int size, gfp_t gfp_mask,
 			    int fclone, int node)
 {
-	struct kmem_cache *cache;
 	struct skb_shared_info *shinfo;
 	struct sk_buff *skb;
 	u8 *data;
 
-	cache = fclone ? skbuff_fclone_cache : skbuff_head_cache;
-
 	/* Get the HEAD */
-	skb = kmem_cache_alloc_node(cache, gfp_mask & ~__GFP_DMA, node);
+	if (fclone)
+		skb = kmem_cache_alloc_node(skbuff_fclone_cache,
+					    gfp_mask & ~__GFP_DMA, node);
+	else
+		skb = skb_head_alloc(gfp_mask & ~__GFP_DMA, node);
 	if (!skb)
 		goto out;
 	prefetchw(skb);
@@ -227,7 +304,10 @@ struct sk_buff *__alloc_skb(unsigned int size, gfp_t gfp_mask,
 out:
 	return skb;
 nodata:
-	kmem_cache_free(cache, skb);
+	if (fclone)
+		kmem_cache_free(skbuff_fclone_cache, skb);
+	else
+		skb_head_free(skb);
 	skb = NULL;
 	goto out;
 }
@@ -346,7 +426,7 @@ static void kfree_skbmem(struct sk_buff *skb)
 
 	switch (skb->fclone) {
 	case SKB_FCLONE_UNAVAILABLE:
-		kmem_cache_free(skbuff_head_cache, skb);
+		skb_head_free(skb);
 		break;
 
 	case SKB_FCLONE_ORIG:
@@ -621,7 +701,7 @@ struct sk_buff *skb_clone(struct sk_buff *skb, gfp_t gfp_mask)
 		n->fclone = SKB_FCLONE_CLONE;
 		atomic_inc(fclone_ref);
 	} else {
-		n = kmem_cache_alloc(skbuff_head_cache, gfp_mask);
+		n = skb_head_alloc(gfp_mask, NUMA_NO_NODE);
 		if (!n)
 			return NULL;
 
@@ -2782,6 +2862,7 @@ void __init skb_init(void)
 						0,
 						SLAB_HWCACHE_ALIGN|SLAB_PANIC,
 						NULL);
+	hotcpu_notifier(skb_cpu_callback, 0);
 }
 
 /**